@@ -7,12 +7,484 @@
 #include <stdlib.h>
 #endif
 
+#ifndef _STRING_H
+#include <string.h>
+#endif
+
+#ifndef _STDINT_H
+#include <stdint.h>
+#endif
+
+#ifndef _LIMITS_H
+#include <limits.h>
+#endif
+
 #ifndef MEMORY_H
 #include "memory.h"
 #endif
 
+#if MEM_HAVE_PAGING
+
+#ifndef _SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+
+#ifndef _UNISTD_H
+#include <unistd.h>
+#endif
+
+#ifndef _STDATOMIC_H
+#include <stdatomic.h>
+#endif
+
+#endif
+
 #define MEM_SKIP_VAL 0x00
 
+/* Type: mem_block.
+ *
+ * Header kept in front of the memory units of paged memory, at the
+ * start of its mapping: the number of bytes reserved for them (units
+ * past the size memory was last allocated or extended to were never
+ * written, and so are 0), and the next paged memory (see mem_mapped).
+ *
+ * Note: memory on the heap has no header; it is a block returned by
+ * malloc() as it always was.
+ */
+typedef struct mem_block
+{
+    size_t bytes;
+    struct mem_block *next;
+} mem_block;
+
+#if MEM_HAVE_PAGING
+
+/* All paged memories, which are told apart from memory on the heap by
+ * being found here; guarded by mem_mapped_lock, so that memories can
+ * still be used from different threads.
+ */
+static mem_block *mem_mapped = NULL;
+static atomic_flag mem_mapped_lock = ATOMIC_FLAG_INIT;
+
+/* Take and release mem_mapped_lock.
+ */
+static void mem_lock(void)
+{
+    while (atomic_flag_test_and_set_explicit(&mem_mapped_lock,
+                memory_order_acquire))
+        ;
+    return;
+}
+
+static void mem_unlock(void)
+{
+    atomic_flag_clear_explicit(&mem_mapped_lock, memory_order_release);
+    return;
+}
+
+/* Add paged memory with specified header to mem_mapped; return the
+ * memory.
+ */
+static memory mem_map(mem_block *block)
+{
+    mem_lock();
+    block->next = mem_mapped;
+    mem_mapped = block;
+    mem_unlock();
+    return (memory) (block + 1);
+}
+
+#endif
+
+/* Return the header of memory if it is paged; NULL if it is on the
+ * heap.
+ */
+static mem_block *mem_mapping(const memory m)
+{
+#if MEM_HAVE_PAGING
+    mem_block *block;
+    mem_lock();
+    for (block = mem_mapped; (block != NULL) &&
+            ((memory) (block + 1) != m); block = block->next)
+        ;
+    mem_unlock();
+    return block;
+#else
+    (void) m;
+    return NULL;
+#endif
+}
+
+/* Return memory with room for the specified number of bytes, mapped
+ * if there are enough of them; NULL on failure.
+ */
+static memory mem_reserve(const size_t bytes)
+{
+#if MEM_HAVE_PAGING
+    if (bytes >= MEM_MAP_THRESHOLD)
+    {
+        mem_block *block = mmap(NULL, sizeof(mem_block) + bytes,
+                PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (block == MAP_FAILED) return NULL;
+        block->bytes = bytes;
+        return mem_map(block);
+    }
+#endif
+    return malloc(bytes);
+}
+
+/* Release memory reserved with mem_reserve().
+ */
+static void mem_release(const memory m)
+{
+#if MEM_HAVE_PAGING
+    mem_block *block = mem_mapping(m),
+              **link;
+    if (block != NULL)
+    {
+        mem_lock();
+        for (link = &mem_mapped; *link != block; link = &(*link)->next)
+            ;
+        *link = block->next;
+        mem_unlock();
+        munmap(block, sizeof(mem_block) + block->bytes);
+        return;
+    }
+#endif
+    free(m);
+    return;
+}
+
+/* MEM_HAVE_SIMD: whether the SSE4.2 and AVX2 kernels are built; which
+ * of them run is decided at run time, from what the CPU supports.
+ */
+#if (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define MEM_HAVE_SIMD 1
+#else
+#define MEM_HAVE_SIMD 0
+#endif
+
+#if MEM_HAVE_SIMD
+
+#ifndef _IMMINTRIN_H_INCLUDED
+#include <immintrin.h>
+#endif
+
+#endif
+
+/* Type: mem_kernels.
+ *
+ * Loops over memory units that bulk operations are made of, one set
+ * per instruction set:
+ *
+ * # fill: set count units to value.
+ * # copy: copy count units from source to destination, in order (the
+ * destination must not start within the source).
+ * # mismatch: return the offset of the first of count units that
+ * differ between two arrays (count if none).
+ * # find: return the offset of the first of count units holding value
+ * (count if none).
+ * # skip: return the offset of the first of count units not holding
+ * value (count if none).
+ */
+typedef struct
+{
+    void (*fill)(int*, size_t, int);
+    void (*copy)(int*, const int*, size_t);
+    size_t (*mismatch)(const int*, const int*, size_t);
+    size_t (*find)(const int*, size_t, int);
+    size_t (*skip)(const int*, size_t, int);
+} mem_kernels;
+
+/* Scalar kernels, for any CPU.
+ */
+static void mem_fill(
+        int *d,
+        const size_t count,
+        const int value)
+{
+    size_t i;
+    for (i = 0; i < count; i++) d[i] = value;
+    return;
+}
+
+static void mem_copy(
+        int *d,
+        const int *s,
+        const size_t count)
+{
+    size_t i;
+    for (i = 0; i < count; i++) d[i] = s[i];
+    return;
+}
+
+static size_t mem_mismatch(
+        const int *a,
+        const int *b,
+        const size_t count)
+{
+    size_t i;
+    for (i = 0; (i < count) && (a[i] == b[i]); i++);
+    return i;
+}
+
+static size_t mem_find(
+        const int *a,
+        const size_t count,
+        const int value)
+{
+    size_t i;
+    for (i = 0; (i < count) && (a[i] != value); i++);
+    return i;
+}
+
+static size_t mem_skip(
+        const int *a,
+        const size_t count,
+        const int value)
+{
+    size_t i;
+    for (i = 0; (i < count) && (a[i] == value); i++);
+    return i;
+}
+
+static const mem_kernels mem_scalar_kernels =
+{
+    mem_fill,
+    mem_copy,
+    mem_mismatch,
+    mem_find,
+    mem_skip
+};
+
+#if MEM_HAVE_SIMD
+
+/* SSE4.2 and AVX2 kernels, four and eight units at a time; lane-wise
+ * comparisons are turned into byte masks, four bits per unit, and the
+ * units left over go through the scalar kernels.
+ */
+__attribute__((target("sse4.2")))
+static void mem_fill_sse(
+        int *d,
+        const size_t count,
+        const int value)
+{
+    const __m128i v = _mm_set1_epi32(value);
+    size_t i;
+    for (i = 0; i + 4 <= count; i += 4)
+        _mm_storeu_si128((__m128i*) (d + i), v);
+    for (; i < count; i++) d[i] = value;
+    return;
+}
+
+__attribute__((target("sse4.2")))
+static void mem_copy_sse(
+        int *d,
+        const int *s,
+        const size_t count)
+{
+    size_t i;
+    for (i = 0; i + 4 <= count; i += 4)
+        _mm_storeu_si128((__m128i*) (d + i),
+                _mm_loadu_si128((const __m128i*) (s + i)));
+    for (; i < count; i++) d[i] = s[i];
+    return;
+}
+
+__attribute__((target("sse4.2")))
+static size_t mem_mismatch_sse(
+        const int *a,
+        const int *b,
+        const size_t count)
+{
+    size_t i;
+    unsigned int mask;
+    for (i = 0; i + 4 <= count; i += 4)
+        if ((mask = _mm_movemask_epi8(_mm_cmpeq_epi32(
+                            _mm_loadu_si128((const __m128i*) (a + i)),
+                            _mm_loadu_si128((const __m128i*) (b + i)))))
+                != 0xFFFF)
+            return i + __builtin_ctz(~mask) / 4;
+    return i + mem_mismatch(a + i, b + i, count - i);
+}
+
+__attribute__((target("sse4.2")))
+static size_t mem_find_sse(
+        const int *a,
+        const size_t count,
+        const int value)
+{
+    const __m128i v = _mm_set1_epi32(value);
+    size_t i;
+    unsigned int mask;
+    for (i = 0; i + 4 <= count; i += 4)
+        if ((mask = _mm_movemask_epi8(_mm_cmpeq_epi32(v,
+                            _mm_loadu_si128((const __m128i*) (a + i)))))
+                != 0)
+            return i + __builtin_ctz(mask) / 4;
+    return i + mem_find(a + i, count - i, value);
+}
+
+__attribute__((target("sse4.2")))
+static size_t mem_skip_sse(
+        const int *a,
+        const size_t count,
+        const int value)
+{
+    const __m128i v = _mm_set1_epi32(value);
+    size_t i;
+    unsigned int mask;
+    for (i = 0; i + 4 <= count; i += 4)
+        if ((mask = _mm_movemask_epi8(_mm_cmpeq_epi32(v,
+                            _mm_loadu_si128((const __m128i*) (a + i)))))
+                != 0xFFFF)
+            return i + __builtin_ctz(~mask) / 4;
+    return i + mem_skip(a + i, count - i, value);
+}
+
+static const mem_kernels mem_sse_kernels =
+{
+    mem_fill_sse,
+    mem_copy_sse,
+    mem_mismatch_sse,
+    mem_find_sse,
+    mem_skip_sse
+};
+
+__attribute__((target("avx2")))
+static void mem_fill_avx2(
+        int *d,
+        const size_t count,
+        const int value)
+{
+    const __m256i v = _mm256_set1_epi32(value);
+    size_t i;
+    for (i = 0; i + 8 <= count; i += 8)
+        _mm256_storeu_si256((__m256i*) (d + i), v);
+    for (; i < count; i++) d[i] = value;
+    return;
+}
+
+__attribute__((target("avx2")))
+static void mem_copy_avx2(
+        int *d,
+        const int *s,
+        const size_t count)
+{
+    size_t i;
+    for (i = 0; i + 8 <= count; i += 8)
+        _mm256_storeu_si256((__m256i*) (d + i),
+                _mm256_loadu_si256((const __m256i*) (s + i)));
+    for (; i < count; i++) d[i] = s[i];
+    return;
+}
+
+__attribute__((target("avx2")))
+static size_t mem_mismatch_avx2(
+        const int *a,
+        const int *b,
+        const size_t count)
+{
+    size_t i;
+    unsigned int mask;
+    for (i = 0; i + 8 <= count; i += 8)
+        if ((mask = _mm256_movemask_epi8(_mm256_cmpeq_epi32(
+                            _mm256_loadu_si256(
+                                (const __m256i*) (a + i)),
+                            _mm256_loadu_si256(
+                                (const __m256i*) (b + i)))))
+                != 0xFFFFFFFF)
+            return i + __builtin_ctz(~mask) / 4;
+    return i + mem_mismatch(a + i, b + i, count - i);
+}
+
+__attribute__((target("avx2")))
+static size_t mem_find_avx2(
+        const int *a,
+        const size_t count,
+        const int value)
+{
+    const __m256i v = _mm256_set1_epi32(value);
+    size_t i;
+    unsigned int mask;
+    for (i = 0; i + 8 <= count; i += 8)
+        if ((mask = _mm256_movemask_epi8(_mm256_cmpeq_epi32(v,
+                            _mm256_loadu_si256(
+                                (const __m256i*) (a + i))))) != 0)
+            return i + __builtin_ctz(mask) / 4;
+    return i + mem_find(a + i, count - i, value);
+}
+
+__attribute__((target("avx2")))
+static size_t mem_skip_avx2(
+        const int *a,
+        const size_t count,
+        const int value)
+{
+    const __m256i v = _mm256_set1_epi32(value);
+    size_t i;
+    unsigned int mask;
+    for (i = 0; i + 8 <= count; i += 8)
+        if ((mask = _mm256_movemask_epi8(_mm256_cmpeq_epi32(v,
+                            _mm256_loadu_si256(
+                                (const __m256i*) (a + i)))))
+                != 0xFFFFFFFF)
+            return i + __builtin_ctz(~mask) / 4;
+    return i + mem_skip(a + i, count - i, value);
+}
+
+static const mem_kernels mem_avx2_kernels =
+{
+    mem_fill_avx2,
+    mem_copy_avx2,
+    mem_mismatch_avx2,
+    mem_find_avx2,
+    mem_skip_avx2
+};
+
+#endif
+
+/* Return the kernels for the instruction sets the CPU supports; the
+ * MEM_KERNELS environment variable ("scalar", "sse4.2" or "avx2")
+ * restricts them, e.g., to compare them with one another.
+ */
+static const mem_kernels *mem_kernels_in_use(void)
+{
+    static const mem_kernels *kernels = NULL;
+    if (kernels != NULL) return kernels;
+    const char *only = getenv("MEM_KERNELS");
+    kernels = &mem_scalar_kernels;
+#if MEM_HAVE_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") &&
+            ((only == NULL) || (strcmp(only, "avx2") == 0)))
+        kernels = &mem_avx2_kernels;
+    else if (__builtin_cpu_supports("sse4.2") &&
+            ((only == NULL) || (strcmp(only, "sse4.2") == 0)))
+        kernels = &mem_sse_kernels;
+#else
+    (void) only;
+#endif
+    return kernels;
+}
+
+/* Copy count units from s to d, in order, as copying them one at a
+ * time would (i.e., repeating the source if d starts within it).
+ */
+static void mem_copy_units(
+        int *d,
+        const int *s,
+        const size_t count)
+{
+    if (((uintptr_t) d > (uintptr_t) s) &&
+            ((uintptr_t) d < (uintptr_t) (s + count)))
+        mem_copy(d, s, count);
+    else mem_kernels_in_use()->copy(d, s, count);
+    return;
+}
+
 /* m_allocate: allocate memory of specified size.
  *
  * Parameters (in order):
@@ -23,6 +495,10 @@
  * Note: initial value of memory units is undefined. Use
  * m_allocate_init() if setting initial values is prioritized.
  *
+ * Note: memory should be deallocated with m_deallocate(). Unless it is
+ * paged (see memory), it is a block returned by malloc(), which may
+ * also be passed to free() and realloc(); paged memory must not.
+ *
  * Returns: bool value to indicate status of allocation; true =
  * success, false = failure.
  */
@@ -30,14 +506,15 @@ bool m_allocate(
         memory *m,
         const unsigned int size)
 {
-    return ((*m = malloc(size * sizeof(int))) != NULL);
+    return ((*m = mem_reserve((size_t) size * sizeof(int))) != NULL);
 }
 
 /* m_allocate_init: allocate memory of specified size and having
  * specified inital values.
  *
  * Note: setting values for all memory units is a linear time
- * operation; use m_allocate() if efficiency is prioritized.
+ * operation; use m_allocate() if efficiency is prioritized. Setting
+ * them to 0 is free if memory is paged, though.
  *
  * Parameters (in order):
  *
@@ -53,9 +530,9 @@ bool m_allocate_init(
         const unsigned int size,
         const int init_val)
 {
-    *m = malloc(size * sizeof(int));
-    if (*m == NULL) return false;
-    m_set_values(m, 0, size, init_val);
+    if (!m_allocate(m, size)) return false;
+    if ((mem_mapping(*m) == NULL) || (init_val != 0))
+        m_set_values(m, 0, size, init_val);
     return true;
 }
 
@@ -73,8 +550,8 @@ bool m_allocate_init(
  */
 void m_deallocate(memory *m)
 {
-    if (m == NULL) return;
-    free(*m);
+    if ((m == NULL) || (*m == NULL)) return;
+    mem_release(*m);
     return;
 }
 
@@ -159,8 +636,8 @@ void m_set_values(
         const int value)
 {
     if (m == NULL) return;
-    unsigned int i;
-    for (i = start; i < end; i++) *((*m) + i) = value;
+    if (start < end)
+        mem_kernels_in_use()->fill(*m + start, end - start, value);
     return;
 }
 
@@ -217,6 +694,12 @@ void m_clear(
  * undefined. Use m_extend_init() if setting initial values is
  * prioritized.
  *
+ * Note: memory is resized in place where possible (see realloc()) or
+ * reserved ahead of its size if paged, so that repeated extensions do
+ * not copy it every time; it may move nonetheless, in which case
+ * pointers into the original memory are no longer valid. On failure,
+ * the original memory is left untouched.
+ *
  * Returns: bool value indicating status of extension; true = success,
  * false = failure.
  */
@@ -226,9 +709,28 @@ bool m_extend(
         const unsigned int e_size)
 {
     if (m == NULL) return false;
+    const mem_block *block = mem_mapping(*m);
+    const size_t bytes = (size_t) (size + e_size) * sizeof(int),
+          held = (block != NULL) ? block->bytes :
+              (size_t) size * sizeof(int);
     memory temp;
-    if (!m_allocate(&temp, size + e_size)) return false;
-    m_copy_mem(*m, 0, size, &temp, 0, size);
+    if (bytes <= held) return true;
+    if ((block == NULL) &&
+            (!MEM_HAVE_PAGING || (bytes < MEM_MAP_THRESHOLD)))
+    {
+        if ((temp = realloc(*m, bytes)) == NULL) return false;
+        *m = temp;
+        return true;
+    }
+    /* Reserve twice as much as the memory held so far, which costs
+     * nothing until it is touched if mapped, so that later extensions
+     * need not copy it again. */
+    if (((temp = mem_reserve(bytes > 2 * held ?
+                        bytes : 2 * held)) == NULL) &&
+            ((temp = mem_reserve(bytes)) == NULL))
+        return false;
+    m_copy_arr(*m, 0, size, &temp, 0, size);
+    mem_release(*m);
     *m = temp;
     return true;
 }
@@ -237,7 +739,8 @@ bool m_extend(
  * specified initial values.
  *
  * Note: setting values for added memory units is a linear time
- * operation; use m_extend() if efficiency is prioritized.
+ * operation; use m_extend() if efficiency is prioritized. Setting
+ * them to 0 is free if memory is paged, though.
  *
  * Parameters (in order):
  *
@@ -266,7 +769,8 @@ bool m_extend_init(
         const int init_val)
 {
     if ((m == NULL) || (!m_extend(m, size, e_size))) return false;
-    m_set_values(m, size, size + e_size, init_val);
+    if ((mem_mapping(*m) == NULL) || (init_val != 0))
+        m_set_values(m, size, size + e_size, init_val);
     return true;
 }
 
@@ -301,6 +805,10 @@ bool m_extend_init(
  * larger, copying is finished with remaining memory within its range
  * left untouched.
  *
+ * Note: if memory is paged, units already holding the values copied
+ * are not written to, so that copying 0s into pages never written to
+ * does not allocate them.
+ *
  * Returns: N/A.
  */
 void m_copy_arr(
@@ -312,9 +820,29 @@ void m_copy_arr(
         const unsigned int end2)
 {
     if (arr == NULL || m == NULL) return;
-    unsigned int i, j;
-    for (i = start2, j = start1; ((i < end2) && (j < end1)); i++, j++)
-        *((*m) + i) = *(arr + j);
+    if ((start1 >= end1) || (start2 >= end2)) return;
+    size_t count = ((end1 - start1) < (end2 - start2)) ?
+        end1 - start1 : end2 - start2;
+    int *d = *m + start2;
+    const int *s = arr + start1;
+#if MEM_HAVE_PAGING
+    if (mem_mapping(*m) != NULL)
+    {
+        /* Pages whose units already hold the values (e.g., 0s in pages
+         * never written to) are left alone, so as not to touch them. */
+        const size_t page = sysconf(_SC_PAGESIZE) / sizeof(int);
+        size_t chunk;
+        for (; count > 0; d += chunk, s += chunk, count -= chunk)
+        {
+            chunk = page - ((uintptr_t) d / sizeof(int)) % page;
+            if (chunk > count) chunk = count;
+            if (mem_kernels_in_use()->mismatch(d, s, chunk) < chunk)
+                mem_copy_units(d, s, chunk);
+        }
+        return;
+    }
+#endif
+    mem_copy_units(d, s, count);
     return;
 }
 
@@ -351,6 +879,9 @@ void m_copy_arr(
  * copying is finished with remaining memory within its range left
  * untouched.
  *
+ * Note: if destination memory is paged, units already holding the
+ * values copied are not written to (see m_copy_arr()).
+ *
  * Returns: N/A.
  */
 void m_copy_mem(
@@ -454,10 +985,10 @@ bool m_eq_check(
     else if ((m1 == NULL) && (m2 != NULL)) return false;
     else if ((m1 != NULL) && (m2 == NULL)) return false;
     else if ((end1 - start1) != (end2 - start2)) return false;
-    unsigned int i, j;
-    for (i = start2, j = start1; ((i < end2) && (j < end1)); i++, j++)
-        if (*(m1 + i) != *(m2 + j)) return false;
-    return true;
+    if ((start1 >= end1) || (start2 >= end2)) return true;
+    size_t count = end1 - start1;
+    return (mem_kernels_in_use()->mismatch(m1 + start2, m2 + start1,
+                count) == count);
 }
 
 /* m_search: return first position of key in specified unsorted range
@@ -492,9 +1023,9 @@ int m_search(
         const unsigned int end,
         int key)
 {
-    unsigned int i;
-    for (i = start; i < end; i++) if (*(m + i) == key) return i;
-    return -1;
+    if (start >= end) return -1;
+    size_t i = mem_kernels_in_use()->find(m + start, end - start, key);
+    return (i < end - start) ? (int) (start + i) : -1;
 }
 
 /* m_search_s: return first position of key in specified sorted range
@@ -502,7 +1033,8 @@ int m_search(
  *
  * Note: specified range of memory is assumed to be sorted and
  * searching is done in logarithmic time. If memory cannot be assumed
- * to be sorted, use m_search() instead.
+ * to be sorted, use m_search() instead; if the range is searched many
+ * times, build an index over it with m_index() and use m_search_i().
  *
  * Parameters (in order):
  *
@@ -583,8 +1115,11 @@ void m_print_memory(
             skip_lines++;
             if ((skip_lines > 1) && (i < (end - 1)))
             {
-                i++;
                 if (skip_lines == 2) fprintf(stream, ". . . . .\n");
+                /* Skip to the end of the run, but for its last unit if
+                 * it ends memory. */
+                i += mem_kernels_in_use()->skip(m + i, end - 1 - i,
+                        MEM_SKIP_VAL);
                 continue;
             }
         } else skip_lines = 0;
@@ -594,4 +1129,337 @@ void m_print_memory(
     return;
 }
 
+/* m_snapshot: take a snapshot of memory.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to mem_snapshot variable.
+ * # memory variable.
+ * # unsigned value for memory size.
+ *
+ * Note: if memory is paged, only its pages that do not hold 0s only
+ * are copied (into the image of the snapshot), so that a snapshot
+ * costs in proportion to what memory touched rather than to its size
+ * (reading pages never written to costs nothing); otherwise memory is
+ * copied as a whole.
+ *
+ * Note: memory can be modified or deallocated once the snapshot is
+ * taken. To avoid resource leaks, m_drop_snapshot() should be called
+ * once the snapshot is no longer needed, provided that this function
+ * succeeded.
+ *
+ * Returns: bool value to indicate status of snapshot; true = success,
+ * false = failure.
+ */
+bool m_snapshot(
+        mem_snapshot *s,
+        const memory m,
+        const unsigned int size)
+{
+    if ((s == NULL) || (m == NULL)) return false;
+    s->image = NULL;
+    s->units = NULL;
+    s->size = size;
+#if MEM_HAVE_PAGING
+    mem_block *block = mem_mapping(m),
+              header = { (size_t) size * sizeof(int), NULL };
+    const size_t length = sizeof(mem_block) + header.bytes;
+    const long page = sysconf(_SC_PAGESIZE);
+    size_t offset, count;
+    const int *words;
+    bool saved;
+    if ((block != NULL) && (page > 0) &&
+            ((s->image = tmpfile()) != NULL))
+    {
+        /* The image reads back 0s but where written to. */
+        saved = (ftruncate(fileno(s->image), length) == 0);
+        for (offset = 0; saved && (offset < length); offset += page)
+        {
+            count = (length - offset < (size_t) page) ?
+                length - offset : (size_t) page;
+            words = (const int*) ((const char*) block + offset);
+            if (mem_kernels_in_use()->skip(words, count / sizeof(int),
+                        0) < count / sizeof(int))
+                saved = (pwrite(fileno(s->image), words, count,
+                            offset) == (ssize_t) count);
+        }
+        saved = saved && (pwrite(fileno(s->image), &header,
+                    sizeof(header), 0) == (ssize_t) sizeof(header));
+        if (saved) return true;
+        fclose(s->image);
+        s->image = NULL;
+    }
+#endif
+    return m_get_copy(m, &s->units, 0, size);
+}
+
+/* m_branch: allocate memory holding the contents of a snapshot.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to mem_snapshot variable.
+ * # pointer to memory variable.
+ *
+ * Note: if the snapshot is of paged memory, the memory allocated maps
+ * its image copy-on-write: it is allocated in constant time, shares
+ * the pages of the image with the snapshot and all other branches, and
+ * only pays for the pages it writes to. It is paged memory in all
+ * other respects.
+ *
+ * Note: memory must be deallocated with m_deallocate(); it does not
+ * depend on the snapshot being kept.
+ *
+ * Returns: bool value to indicate status of allocation; true =
+ * success, false = failure.
+ */
+bool m_branch(
+        const mem_snapshot *s,
+        memory *m)
+{
+    if ((s == NULL) || (m == NULL)) return false;
+#if MEM_HAVE_PAGING
+    if (s->image != NULL)
+    {
+        mem_block *block = mmap(NULL,
+                sizeof(mem_block) + (size_t) s->size * sizeof(int),
+                PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                fileno(s->image), 0);
+        if (block == MAP_FAILED) return false;
+        *m = mem_map(block);
+        return true;
+    }
+#endif
+    *m = NULL;
+    return m_get_copy(s->units, m, 0, s->size);
+}
+
+/* m_drop_snapshot: release resources held by a snapshot of memory.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to mem_snapshot variable.
+ *
+ * Note: memory allocated from the snapshot with m_branch() remains
+ * valid. Passing NULL results in no operation being performed.
+ *
+ * Returns: N/A.
+ */
+void m_drop_snapshot(mem_snapshot *s)
+{
+    if (s == NULL) return;
+    if (s->image != NULL) fclose(s->image);
+    m_deallocate(&s->units);
+    s->image = NULL;
+    s->units = NULL;
+    return;
+}
+
+/* MEM_CACHE_LINE: size in bytes of cache lines, which index keys are
+ * aligned on.
+ */
+#define MEM_CACHE_LINE 64
+
+/* MEM_PREFETCH_LEVELS: number of levels below a node of an index
+ * whose nodes fit in one cache line (i.e., 2 to that power times the
+ * size of a key is MEM_CACHE_LINE).
+ */
+#define MEM_PREFETCH_LEVELS 4
+
+/* Fetch the cache line holding a memory address in advance, where
+ * supported.
+ */
+#if defined(__GNUC__) || defined(__clang__)
+#define MEM_PREFETCH(p) __builtin_prefetch(p)
+#else
+#define MEM_PREFETCH(p) ((void) (p))
+#endif
+
+/* Lay out units (count of them, from position start of memory) in
+ * index in Eytzinger order, from node k of the tree, i being the
+ * number of units laid out so far; return that number afterwards.
+ */
+static size_t mem_lay_out(
+        mem_index *x,
+        const int *units,
+        const size_t count,
+        const unsigned int start,
+        size_t i,
+        const size_t k)
+{
+    if (k >= ((size_t) 1 << x->depth)) return i;
+    i = mem_lay_out(x, units, count, start, i, 2 * k);
+    x->keys[k] = (i < count) ? units[i] : INT_MAX;
+    x->positions[k] = (i < count) ? (int) (start + i) : -1;
+    return mem_lay_out(x, units, count, start, i + 1, 2 * k + 1);
+}
+
+/* Return the position found for key by a search of index that
+ * descended to node k past the bottom of the tree.
+ */
+static int mem_found(
+        const mem_index *x,
+        size_t k,
+        const int key)
+{
+    /* Going right took the path past nodes less than key; the last
+     * node it went left at is the first one that is not. */
+#if defined(__GNUC__) || defined(__clang__)
+    k >>= __builtin_ffsll((long long) ~k);
+#else
+    while (k & 1) k >>= 1;
+    k >>= 1;
+#endif
+    return (x->keys[k] == key) ? x->positions[k] : -1;
+}
+
+/* m_index: build an index over specified sorted range of memory.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to mem_index variable.
+ * # memory variable.
+ * # unsigned value indicating starting position of range.
+ * # unsigned value indicating ending position of range.
+ *
+ * Note: memory must have been allocated beforehand. Passing variables
+ * containing unallocated memory results in undefined behavior.
+ *
+ * Note: range must be within bounds of memory with starting position
+ * being less than or equal to ending position, and sorted in
+ * ascending order. Passing values not meeting these requirements
+ * results in undefined behavior.
+ *
+ * Note: building an index is a linear time operation, and the index
+ * holds a copy of the range: it is meant to be searched many times,
+ * and has to be built again once the range is modified. To avoid
+ * memory leaks, m_drop_index() should be called once the index is no
+ * longer needed, provided that this function succeeded.
+ *
+ * Returns: bool value to indicate status of building; true = success,
+ * false = failure.
+ */
+bool m_index(
+        mem_index *x,
+        const memory m,
+        const unsigned int start,
+        const unsigned int end)
+{
+    if ((x == NULL) || (m == NULL)) return false;
+    const size_t count = (start < end) ? end - start : 0;
+    size_t nodes;
+    x->depth = 0;
+    while ((((size_t) 1 << x->depth) - 1) < count) x->depth++;
+    nodes = (size_t) 1 << x->depth;
+    x->block = malloc(nodes * sizeof(int) + MEM_CACHE_LINE);
+    x->positions = malloc(nodes * sizeof(int));
+    if ((x->block == NULL) || (x->positions == NULL))
+    {
+        free(x->block);
+        free(x->positions);
+        return false;
+    }
+    x->keys = (int*) (((uintptr_t) x->block + MEM_CACHE_LINE - 1) /
+            MEM_CACHE_LINE * MEM_CACHE_LINE);
+    x->keys[0] = INT_MAX;
+    x->positions[0] = -1;
+    mem_lay_out(x, m + start, count, start, 0, 1);
+    return true;
+}
+
+/* m_search_i: return first position of key in the range of memory an
+ * index was built over if found; otherwise, return -1.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to mem_index variable.
+ * # key to search for.
+ *
+ * Note: searching is done in logarithmic time, always going through
+ * every level of the index; use m_search_i_batch() to search for many
+ * keys at once.
+ *
+ * Returns: first position of key if found within the range, -1
+ * otherwise.
+ */
+int m_search_i(
+        const mem_index *x,
+        const int key)
+{
+    size_t k = 1;
+    unsigned int level;
+    for (level = 0; level < x->depth; level++)
+    {
+        if (level + MEM_PREFETCH_LEVELS < x->depth)
+            MEM_PREFETCH(x->keys + (k << MEM_PREFETCH_LEVELS));
+        k = 2 * k + (x->keys[k] < key);
+    }
+    return mem_found(x, k, key);
+}
+
+/* m_search_i_batch: search the range of memory an index was built
+ * over for each of specified keys (see m_search_i()).
+ *
+ * Parameters (in order):
+ *
+ * # pointer to mem_index variable.
+ * # integer array of keys to search for.
+ * # integer array to save positions in (one per key, -1 if not
+ * found).
+ * # unsigned value for number of keys.
+ *
+ * Note: keys are searched for MEM_INDEX_BATCH at a time, a level of
+ * the index for all of them after another, so that the cache misses
+ * of one search overlap with those of the others.
+ *
+ * Returns: N/A.
+ */
+void m_search_i_batch(
+        const mem_index *x,
+        const int keys[],
+        int positions[],
+        const unsigned int count)
+{
+    size_t k[MEM_INDEX_BATCH];
+    unsigned int i,
+                 j,
+                 n,
+                 level;
+    for (i = 0; i < count; i += n)
+    {
+        n = (count - i < MEM_INDEX_BATCH) ? count - i : MEM_INDEX_BATCH;
+        for (j = 0; j < n; j++) k[j] = 1;
+        for (level = 0; level < x->depth; level++)
+            for (j = 0; j < n; j++)
+            {
+                if (level + MEM_PREFETCH_LEVELS < x->depth)
+                    MEM_PREFETCH(x->keys +
+                            (k[j] << MEM_PREFETCH_LEVELS));
+                k[j] = 2 * k[j] + (x->keys[k[j]] < keys[i + j]);
+            }
+        for (j = 0; j < n; j++)
+            positions[i + j] = mem_found(x, k[j], keys[i + j]);
+    }
+    return;
+}
+
+/* m_drop_index: release resources held by an index.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to mem_index variable.
+ *
+ * Note: passing NULL results in no operation being performed.
+ *
+ * Returns: N/A.
+ */
+void m_drop_index(mem_index *x)
+{
+    if (x == NULL) return;
+    free(x->block);
+    free(x->positions);
+    x->block = NULL;
+    x->keys = x->positions = NULL;
+    return;
+}
+
 /* EOF. */
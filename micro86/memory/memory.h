@@ -14,6 +14,21 @@
 #ifndef MEMORY_H
 #define MEMORY_H
 
+/* MEM_HAVE_PAGING: whether large memories can be paged (i.e., kept in
+ * anonymous mappings; see memory).
+ */
+#if defined(__unix__) || defined(__APPLE__)
+#define MEM_HAVE_PAGING 1
+#else
+#define MEM_HAVE_PAGING 0
+#endif
+
+/* MEM_MAP_THRESHOLD: size in bytes from which memories are paged (if
+ * MEM_HAVE_PAGING); below it, a mostly untouched mapping would cost
+ * more than the heap.
+ */
+#define MEM_MAP_THRESHOLD (64 * 1024)
+
 /* Type: memory.
  *
  * A simple, extensible memory model consisting of a pointer to
@@ -22,6 +37,20 @@
  * Note: memory unit positions start at 0 and end at size of memory
  * minus 1.
  *
+ * Note: memories of at least MEM_MAP_THRESHOLD bytes are paged if
+ * MEM_HAVE_PAGING: their units are kept in an anonymous mapping,
+ * whose pages are only allocated once written to (reading a page
+ * never written to reads a page of zeros shared by all memories). A
+ * memory then costs in proportion to the pages it touches rather than
+ * to its size, as long as it is set up with initial values of 0.
+ * Smaller memories are blocks returned by malloc().
+ *
+ * Note: operations on ranges of memory (e.g., m_set_values(),
+ * m_copy_mem(), m_eq_check() and m_search()) run AVX2 or SSE4.2 loops
+ * on CPUs that support them, chosen at run time, with the same results
+ * as scalar ones; the MEM_KERNELS environment variable ("scalar",
+ * "sse4.2" or "avx2") restricts the choice.
+ *
  * # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # #
  * WARNING: memory is simply an integer pointer but it should not be
  * accessed or modified directly. The functions declared below are to
@@ -40,6 +69,10 @@ typedef int* memory;
  * Note: initial value of memory units is undefined. Use
  * m_allocate_init() if setting initial values is prioritized.
  *
+ * Note: memory should be deallocated with m_deallocate(). Unless it is
+ * paged (see memory), it is a block returned by malloc(), which may
+ * also be passed to free() and realloc(); paged memory must not.
+ *
  * Returns: bool value to indicate status of allocation; true =
  * success, false = failure.
  */
@@ -57,7 +90,8 @@ bool m_allocate(
  * # initial value for all memory units allocated.
  *
  * Note: setting values for all memory units is a linear time
- * operation; use m_allocate() if efficiency is prioritized.
+ * operation; use m_allocate() if efficiency is prioritized. Setting
+ * them to 0 is free if memory is paged, though.
  *
  * Returns: bool value to indicate status of allocation; true =
  * success, false = failure.
@@ -196,6 +230,12 @@ void m_clear(
  * undefined. Use m_extend_init() if setting initial values is
  * prioritized.
  *
+ * Note: memory is resized in place where possible (see realloc()) or
+ * reserved ahead of its size if paged, so that repeated extensions do
+ * not copy it every time; it may move nonetheless, in which case
+ * pointers into the original memory are no longer valid. On failure,
+ * the original memory is left untouched.
+ *
  * Returns: bool value indicating status of extension; true = success,
  * false = failure.
  */
@@ -225,7 +265,8 @@ bool m_extend(
  * extension size).
  *
  * Note: setting values for added memory units is a linear time
- * operation; use m_extend() if efficiency is prioritized.
+ * operation; use m_extend() if efficiency is prioritized. Setting
+ * them to 0 is free if memory is paged, though.
  *
  * Returns: bool value indicating status of extension; true = success,
  * false = failure.
@@ -267,6 +308,10 @@ bool m_extend_init(
  * larger, copying is finished with remaining memory within its range
  * left untouched.
  *
+ * Note: if memory is paged, units already holding the values copied
+ * are not written to, so that copying 0s into pages never written to
+ * does not allocate them.
+ *
  * Returns: N/A.
  */
 void m_copy_arr(
@@ -310,6 +355,9 @@ void m_copy_arr(
  * copying is finished with remaining memory within its range left
  * untouched.
  *
+ * Note: if destination memory is paged, units already holding the
+ * values copied are not written to (see m_copy_arr()).
+ *
  * Returns: N/A.
  */
 void m_copy_mem(
@@ -433,7 +481,8 @@ int m_search(
  *
  * Note: specified range of memory is assumed to be sorted and
  * searching is done in logarithmic time. If memory cannot be assumed
- * to be sorted, use m_search() instead.
+ * to be sorted, use m_search() instead; if the range is searched many
+ * times, build an index over it with m_index() and use m_search_i().
  *
  * Parameters (in order):
  *
@@ -489,6 +538,214 @@ void m_print_memory(
         const unsigned int,
         FILE*);
 
+/* Type: mem_snapshot.
+ *
+ * A snapshot of memory consisting of the following:
+ *
+ * # image: temporary file holding an image of memory, if paged (NULL
+ * otherwise); branches map it so that they share its pages until they
+ * write to them.
+ * # units: copy of memory, if not paged (NULL otherwise).
+ * # size: memory size.
+ *
+ * # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # #
+ * WARNING: mem_snapshot fields should not be modified directly. The
+ * functions declared below are to be used for such purposes.
+ * # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # #
+ */
+typedef struct
+{
+    FILE *image;
+    memory units;
+    unsigned int size;
+} mem_snapshot;
+
+/* m_snapshot: take a snapshot of memory.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to mem_snapshot variable.
+ * # memory variable.
+ * # unsigned value for memory size.
+ *
+ * Note: if memory is paged, only its pages that do not hold 0s only
+ * are copied (into the image of the snapshot), so that a snapshot
+ * costs in proportion to what memory touched rather than to its size
+ * (reading pages never written to costs nothing); otherwise memory is
+ * copied as a whole.
+ *
+ * Note: memory can be modified or deallocated once the snapshot is
+ * taken. To avoid resource leaks, m_drop_snapshot() should be called
+ * once the snapshot is no longer needed, provided that this function
+ * succeeded.
+ *
+ * Returns: bool value to indicate status of snapshot; true = success,
+ * false = failure.
+ */
+bool m_snapshot(
+        mem_snapshot*,
+        const memory,
+        const unsigned int);
+
+/* m_branch: allocate memory holding the contents of a snapshot.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to mem_snapshot variable.
+ * # pointer to memory variable.
+ *
+ * Note: if the snapshot is of paged memory, the memory allocated maps
+ * its image copy-on-write: it is allocated in constant time, shares
+ * the pages of the image with the snapshot and all other branches, and
+ * only pays for the pages it writes to. It is paged memory in all
+ * other respects.
+ *
+ * Note: memory must be deallocated with m_deallocate(); it does not
+ * depend on the snapshot being kept.
+ *
+ * Returns: bool value to indicate status of allocation; true =
+ * success, false = failure.
+ */
+bool m_branch(
+        const mem_snapshot*,
+        memory*);
+
+/* m_drop_snapshot: release resources held by a snapshot of memory.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to mem_snapshot variable.
+ *
+ * Note: memory allocated from the snapshot with m_branch() remains
+ * valid. Passing NULL results in no operation being performed.
+ *
+ * Returns: N/A.
+ */
+void m_drop_snapshot(mem_snapshot*);
+
+/* MEM_INDEX_BATCH: number of keys m_search_i_batch() searches for at a
+ * time.
+ */
+#define MEM_INDEX_BATCH 8
+
+/* Type: mem_index.
+ *
+ * An index over a sorted range of memory consisting of the following:
+ *
+ * # keys: values of the range in Eytzinger order (i.e., laid out as
+ * the levels of a complete binary search tree, from its root at index
+ * 1, each node k having children at indices 2k and 2k + 1), padded
+ * with INT_MAX up to a complete tree and aligned on cache lines.
+ * # positions: position in memory of the value at each index of keys
+ * (-1 for padding and for index 0).
+ * # depth: number of levels of the tree.
+ * # block: memory block holding keys.
+ *
+ * Note: searching the index descends the tree level by level without
+ * branching on comparisons, and fetches in advance the cache line
+ * holding the nodes four levels below (all 16 of them fall within
+ * one), so that searching large ranges waits on memory far less often
+ * than binary searching them does (see m_search_s()).
+ *
+ * # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # #
+ * WARNING: mem_index fields should not be modified directly. The
+ * functions declared below are to be used for such purposes.
+ * # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # #
+ */
+typedef struct
+{
+    int *keys,
+        *positions;
+    unsigned int depth;
+    void *block;
+} mem_index;
+
+/* m_index: build an index over specified sorted range of memory.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to mem_index variable.
+ * # memory variable.
+ * # unsigned value indicating starting position of range.
+ * # unsigned value indicating ending position of range.
+ *
+ * Note: memory must have been allocated beforehand. Passing variables
+ * containing unallocated memory results in undefined behavior.
+ *
+ * Note: range must be within bounds of memory with starting position
+ * being less than or equal to ending position, and sorted in
+ * ascending order. Passing values not meeting these requirements
+ * results in undefined behavior.
+ *
+ * Note: building an index is a linear time operation, and the index
+ * holds a copy of the range: it is meant to be searched many times,
+ * and has to be built again once the range is modified. To avoid
+ * memory leaks, m_drop_index() should be called once the index is no
+ * longer needed, provided that this function succeeded.
+ *
+ * Returns: bool value to indicate status of building; true = success,
+ * false = failure.
+ */
+bool m_index(
+        mem_index*,
+        const memory,
+        const unsigned int,
+        const unsigned int);
+
+/* m_search_i: return first position of key in the range of memory an
+ * index was built over if found; otherwise, return -1.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to mem_index variable.
+ * # key to search for.
+ *
+ * Note: searching is done in logarithmic time, always going through
+ * every level of the index; use m_search_i_batch() to search for many
+ * keys at once.
+ *
+ * Returns: first position of key if found within the range, -1
+ * otherwise.
+ */
+int m_search_i(
+        const mem_index*,
+        const int);
+
+/* m_search_i_batch: search the range of memory an index was built
+ * over for each of specified keys (see m_search_i()).
+ *
+ * Parameters (in order):
+ *
+ * # pointer to mem_index variable.
+ * # integer array of keys to search for.
+ * # integer array to save positions in (one per key, -1 if not
+ * found).
+ * # unsigned value for number of keys.
+ *
+ * Note: keys are searched for MEM_INDEX_BATCH at a time, a level of
+ * the index for all of them after another, so that the cache misses
+ * of one search overlap with those of the others.
+ *
+ * Returns: N/A.
+ */
+void m_search_i_batch(
+        const mem_index*,
+        const int[],
+        int[],
+        const unsigned int);
+
+/* m_drop_index: release resources held by an index.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to mem_index variable.
+ *
+ * Note: passing NULL results in no operation being performed.
+ *
+ * Returns: N/A.
+ */
+void m_drop_index(mem_index*);
+
 #endif
 
 /* EOF. */
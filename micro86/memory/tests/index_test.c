@@ -0,0 +1,240 @@
+/* index_test:
+ *
+ * Checks of m_index(), m_search_i() and m_search_i_batch() against a
+ * linear search for the first position of each key, over sorted ranges
+ * of every size up to a few levels of the index and some larger ones,
+ * with and without duplicates, holding INT_MIN and INT_MAX or not, and
+ * starting at position 0 or further into memory. Empty ranges must
+ * find nothing, and batches of any number of keys (not only multiples
+ * of MEM_INDEX_BATCH) must find what single searches do.
+ *
+ * Built with the memory library only (see README). Exits with
+ * EXIT_SUCCESS if all checks pass.
+ */
+
+#ifndef _STDIO_H
+#include <stdio.h>
+#endif
+
+#ifndef _STDLIB_H
+#include <stdlib.h>
+#endif
+
+#ifndef _LIMITS_H
+#include <limits.h>
+#endif
+
+#ifndef MEMORY_H
+#include "../memory.h"
+#endif
+
+/* Largest range checked for every size up to it.
+ */
+#define MAX_SMALL_RANGE 70
+
+/* Sizes of the larger ranges checked.
+ */
+#define LARGE_RANGES 1000, 4096, 4097
+
+/* Positions of memory before the range in offset checks.
+ */
+#define RANGE_OFFSET 5
+
+/* Number of keys searched for per range (other than the values of the
+ * range and their neighbours).
+ */
+#define RANDOM_KEYS 200
+
+/* Number of failed checks.
+ */
+static unsigned int failures = 0;
+
+/* Report a failed search unless position is the one expected.
+ */
+static void check(
+        const int position,
+        const int expected,
+        const char *what,
+        const unsigned int size,
+        const int key)
+{
+    if (position == expected) return;
+    fprintf(stderr, "FAILED (range of %u, key %d): %s returned %d,"
+            " expected %d\n", size, key, what, position, expected);
+    failures++;
+    return;
+}
+
+/* Return the first position of key in range of memory from start up to
+ * (excluding) end, or -1.
+ */
+static int linear_search(
+        const memory m,
+        const unsigned int start,
+        const unsigned int end,
+        const int key)
+{
+    unsigned int i;
+    for (i = start; i < end; i++)
+        if (m_get_value(m, i) == key) return (int) i;
+    return -1;
+}
+
+/* Return a pseudo-random value spread over the whole range of int.
+ */
+static int random_value(void)
+{
+    return (int) (((unsigned int) rand() << 16) ^
+            (unsigned int) rand());
+}
+
+/* Fill memory from start up to end with sorted values: a run of
+ * duplicates every dup_every values (0 = none), and INT_MIN and INT_MAX
+ * at both ends if extremes is set.
+ */
+static void fill_sorted(
+        memory *m,
+        const unsigned int start,
+        const unsigned int end,
+        const unsigned int dup_every,
+        const bool extremes)
+{
+    unsigned int i;
+    int value = -3 * (int) (end - start);
+    for (i = start; i < end; i++)
+    {
+        if ((dup_every == 0) || ((i - start) % dup_every != 0))
+            value += 1 + rand() % 3;
+        m_set_value(m, i, value);
+    }
+    if (!extremes || (end == start)) return;
+    m_set_value(m, start, INT_MIN);
+    m_set_value(m, end - 1, INT_MAX);
+    if (end - start > 3)
+    {
+        m_set_value(m, start + 1, INT_MIN);
+        m_set_value(m, end - 2, INT_MAX);
+    }
+    return;
+}
+
+/* Search index over range of memory from start up to end for keys,
+ * one at a time and in batches of every count up to count, checking
+ * each against linear_search().
+ */
+static void check_keys(
+        const mem_index *x,
+        const memory m,
+        const unsigned int start,
+        const unsigned int end,
+        const int keys[],
+        const unsigned int count)
+{
+    int *positions = malloc(count * sizeof(int)),
+        *expected = malloc(count * sizeof(int));
+    unsigned int i, batch, done;
+    if ((positions == NULL) || (expected == NULL))
+    {
+        fprintf(stderr, "FAILED: out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    for (i = 0; i < count; i++)
+    {
+        expected[i] = linear_search(m, start, end, keys[i]);
+        check(m_search_i(x, keys[i]), expected[i], "m_search_i()",
+                end - start, keys[i]);
+    }
+    for (batch = 1; batch <= 2 * MEM_INDEX_BATCH + 1; batch++)
+        for (done = 0; done < count; done += batch)
+        {
+            const unsigned int n = (count - done < batch) ?
+                count - done : batch;
+            m_search_i_batch(x, keys + done, positions + done, n);
+            for (i = done; i < done + n; i++)
+                check(positions[i], expected[i],
+                        "m_search_i_batch()", end - start, keys[i]);
+        }
+    m_search_i_batch(x, keys, positions, count);
+    for (i = 0; i < count; i++)
+        check(positions[i], expected[i], "m_search_i_batch()",
+                end - start, keys[i]);
+    m_search_i_batch(x, keys, positions, 0);
+    free(positions);
+    free(expected);
+    return;
+}
+
+/* Index range of memory from start up to end and search it for every
+ * value it holds, their neighbours, INT_MIN, INT_MAX and random keys.
+ */
+static void check_range(
+        const memory m,
+        const unsigned int start,
+        const unsigned int end)
+{
+    const unsigned int count = 3 * (end - start) + 2 + RANDOM_KEYS;
+    int *keys = malloc(count * sizeof(int));
+    unsigned int i, n = 0;
+    mem_index x;
+    if ((keys == NULL) || !m_index(&x, m, start, end))
+    {
+        fprintf(stderr, "FAILED: out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    for (i = start; i < end; i++)
+    {
+        const int value = m_get_value(m, i);
+        keys[n++] = value;
+        keys[n++] = (value > INT_MIN) ? value - 1 : value;
+        keys[n++] = (value < INT_MAX) ? value + 1 : value;
+    }
+    keys[n++] = INT_MIN;
+    keys[n++] = INT_MAX;
+    while (n < count) keys[n++] = random_value();
+    check_keys(&x, m, start, end, keys, count);
+    m_drop_index(&x);
+    free(keys);
+    return;
+}
+
+/* Check ranges of specified size, at position 0 and at RANGE_OFFSET,
+ * with every kind of contents fill_sorted() produces.
+ */
+static void check_size(const unsigned int size)
+{
+    const unsigned int dup_every[] = { 0, 1, 2, 5 };
+    unsigned int d, e, offset;
+    memory m;
+    if (!m_allocate(&m, size + 2 * RANGE_OFFSET))
+    {
+        fprintf(stderr, "FAILED: out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    for (offset = 0; offset <= RANGE_OFFSET; offset += RANGE_OFFSET)
+        for (d = 0; d < sizeof(dup_every) / sizeof(dup_every[0]); d++)
+            for (e = 0; e < 2; e++)
+            {
+                /* Values outside the range must not be found. */
+                m_clear(&m, 0, size + 2 * RANGE_OFFSET);
+                fill_sorted(&m, offset, offset + size, dup_every[d],
+                        e == 1);
+                check_range(m, offset, offset + size);
+            }
+    m_deallocate(&m);
+    return;
+}
+
+int main(void)
+{
+    const unsigned int large[] = { LARGE_RANGES };
+    unsigned int i;
+    srand(86);
+    for (i = 0; i <= MAX_SMALL_RANGE; i++) check_size(i);
+    for (i = 0; i < sizeof(large) / sizeof(large[0]); i++)
+        check_size(large[i]);
+    if (failures > 0) return EXIT_FAILURE;
+    printf("index_test: all checks passed\n");
+    return EXIT_SUCCESS;
+}
+
+/* EOF. */
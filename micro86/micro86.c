@@ -7,6 +7,18 @@
 #include <stdlib.h>
 #endif
 
+#ifndef _CTYPE_H
+#include <ctype.h>
+#endif
+
+#ifndef _TIME_H
+#include <time.h>
+#endif
+
+#ifndef _SIGNAL_H
+#include <signal.h>
+#endif
+
 #ifndef MICRO86PROC_H
 #include "micro86_proc.h"
 #endif
@@ -35,481 +47,201 @@
 #include "micro86_dataset.h"
 #endif
 
+#ifndef MICRO86MACHINE_H
+#include "micro86_machine.h"
+#endif
+
 #ifndef MICRO86_H
 #include "micro86.h"
 #endif
 
-/* Print out contents of memory.
+/* Return the number of seconds elapsed since specified time.
  */
-static void m86_print_memory(
-        const memory micro86_memory,
-        const unsigned int size,
-        FILE *stream)
+static double m86_elapsed(const struct timespec *start)
 {
-    if (stream == NULL) return;
-    fprintf(stream, "\nMEMORY:\n\n");
-    m_print_memory(micro86_memory, 0, size, stream);
-    return;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec)
+        + (now.tv_nsec - start->tv_nsec) / 1e9;
 }
 
-/* Print out contents of cpu.
+/* Whether the execution trace was toggled with M86_TRACE_SIGNAL since
+ * last checked.
  */
-static void m86_print_cpu(
-        const micro86_proc micro86_cpu,
-        FILE *stream)
-{
-    if (stream == NULL) return;
-    fprintf(stream, "\nCPU:\n\n");
-    m86_print_proc(micro86_cpu, stream);
-    return;
-}
+static volatile sig_atomic_t m86_trace_toggled = 0;
 
-/* Print out contents of cpu and memory.
- */
-static void m86_postmortem_dump(
-        const micro86_proc micro86_cpu,
-        const memory micro86_memory,
-        const unsigned int size,
-        FILE *stream)
-{
-    fprintf(stream, "\n=== POST-MORTEM DUMP ===\n");
-    m86_print_cpu(micro86_cpu, stream);
-    m86_print_memory(micro86_memory, size, stream);
-    return;
-}
+#ifdef SIGUSR1
 
-/* Print out error message parameter, post-mortem dump and exit.
+/* Handle M86_TRACE_SIGNAL.
  */
-static void m86_error(
-        FILE *stream,
-        const char *message,
-        const int error_code,
-        const micro86_proc micro86_cpu,
-        const memory micro86_memory,
-        const unsigned int mem_size)
+static void m86_toggle_trace(int signum)
 {
-    fprintf(stream, "%s\n", message);
-    m86_postmortem_dump(micro86_cpu,
-            micro86_memory, mem_size, stream);
-    exit_on_exit_fail(error_code, error_code);
+    (void) signum;
+    m86_trace_toggled = 1;
     return;
 }
 
-/* Check if divisor is zero and cause a fatal error if it is.
- */
-static void m86_check_zero_div_error(
-        int divisor,
-        FILE *stream,
-        const int error_code,
-        const micro86_proc micro86_cpu,
-        const memory micro86_memory,
-        const unsigned int mem_size)
-{
-    if (divisor == 0)
-        m86_error(stream, "Micro86 ERROR: division by zero!",
-                error_code, micro86_cpu, micro86_memory, mem_size);
-    return;
-}
+#endif
 
-/* Check if there is a program in memory and cause a fatal error if
- * there isn't.
+/* Switch the execution trace of the machine on or off, printing a
+ * heading to stream if it changes.
  */
-static void m86_check_no_prgm_error(
-        const unsigned int program_size,
+static void m86_switch_trace(
         FILE *stream,
-        const int error_code,
-        const micro86_proc micro86_cpu,
-        const memory micro86_memory,
-        const unsigned int mem_size)
+        micro86_machine *machine,
+        const bool on)
 {
-    if (program_size == 0)
-        m86_error(stream, "Micro86 ERROR: no program in memory!",
-                error_code, micro86_cpu, micro86_memory, mem_size);
+    if ((machine->trace != NULL) == on) return;
+    machine->trace = on ? stream : NULL;
+    fprintf(stream, on ? "\n=== EXECUTION TRACE ===\n\n"
+            : "\n=== EXECUTION TRACE PAUSED ===\n");
     return;
 }
 
-/* Check memory bounds and cause a fatal error if violated.
+/* Run the machine until it stops, or until it has executed the
+ * maximum number of instructions or run for the maximum number of
+ * seconds (0 = no limit), in which case print out an error message and
+ * post-mortem dump and exit with M86_LIMIT_EXIT_CODE. The execution
+ * trace is switched on once trace_from instructions were executed (0 =
+ * never) or the breakpoint of the machine is reached, and toggled with
+ * M86_TRACE_SIGNAL if watch is set; either way, it is only switched
+ * between runs of the machine, so that the engines never test for it.
  */
-static void m86_check_memory_bounds(
-        const int position,
+static void m86_run_limited(
         FILE *stream,
-        const int error_code,
-        const micro86_proc micro86_cpu,
-        const memory micro86_memory,
-        const unsigned int mem_size)
-{
-    if ((position < 0) || ((unsigned) position > mem_size))
-    {
-        memory_bounds_error(STD_ERR_DEST, position, 0);
-        m86_error(stream, "Micro86 ERROR: memory violation!",
-                error_code, micro86_cpu, micro86_memory, mem_size);
-    }
-    return;
-}
-
-/* Set the zero and sign bits of the flag register of the cpu.
- */
-static void m86_set_flag_reg(
-        micro86_proc *micro86_cpu,
-        const int value)
+        micro86_machine *machine,
+        const unsigned long max_instructs,
+        const double max_seconds,
+        const unsigned long trace_from,
+        const bool watch)
 {
-    if (value == 0)
+    unsigned long done = 0,
+                  slice;
+    unsigned int stop;
+    const char *message = NULL;
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    while (true)
     {
-        m86_set_flags_zb(micro86_cpu, true);
-        m86_set_flags_sb(micro86_cpu, false);
-    } else if (value < 0)
-    {
-        m86_set_flags_sb(micro86_cpu, true);
-        m86_set_flags_zb(micro86_cpu, false);
-    } else
-    {
-        m86_set_flags_zb(micro86_cpu, false);
-        m86_set_flags_sb(micro86_cpu, false);
+        slice = ((max_seconds > 0) || watch) ? M86_WATCHDOG_SLICE : 0;
+        if ((max_instructs > 0) &&
+                ((slice == 0) || (max_instructs - done < slice)))
+            slice = max_instructs - done;
+        if ((machine->trace == NULL) && (trace_from > done) &&
+                ((slice == 0) || (trace_from - done < slice)))
+            slice = trace_from - done;
+        stop = m86_run(machine, slice);
+        done += machine->executed;
+        if (stop == M86_STOP_BREAK)
+        {
+            m86_switch_trace(stream, machine, true);
+            continue;
+        }
+        if (stop != M86_STOP_BUDGET) break;
+        if ((max_instructs > 0) && (done == max_instructs))
+        {
+            message = "Micro86 ERROR: instruction limit reached!";
+            break;
+        }
+        if ((trace_from > 0) && (done == trace_from))
+            m86_switch_trace(stream, machine, true);
+        if (m86_trace_toggled)
+        {
+            m86_trace_toggled = 0;
+            m86_switch_trace(stream, machine, machine->trace == NULL);
+        }
+        if ((max_seconds > 0) && (m86_elapsed(&start) >= max_seconds))
+        {
+            message = "Micro86 ERROR: time limit reached!";
+            break;
+        }
     }
-    return;
+    if (message == NULL) return;
+    m86_error(STD_ERR_DEST, message, 0,
+            machine->cpu, machine->mem, machine->mem_size);
+    exit(M86_LIMIT_EXIT_CODE);
 }
 
-/* Return true if instruction argument is a jump instruction;
- * otherwise, return false.
+/* Boot up the emulator and run the FDE cycle.
  */
-static bool is_jmp_instruct(const m86_decoded_instruct di)
-{
-    switch (di.opcode)
-    {
-        case JMPI:
-        case JEI:
-        case JNEI:
-        case JLI:
-        case JLEI:
-        case JGI:
-        case JGEI:  return true;
-        default:    break;
-    }
-    return false;
-}
-
-/* Print out disassembled instruction. */
-static void m86_disassemble(
+static void m86_boot_up(
         FILE *stream,
-        const micro86_proc micro86_cpu,
-        const memory micro86_memory,
-        const unsigned int mem_size,
-        const int word)
+        const char *file_name,
+        micro86_machine *machine,
+        const bool dump,
+        const bool report,
+        const unsigned long max_instructs,
+        const double max_seconds,
+        const unsigned long trace_from,
+        const bool watch)
 {
-    bool has_operand = false,
-         nonjmp_immediate = false;
-    const m86_decoded_instruct di = m86_ei_decoded(word);
-    char *output = malloc(sizeof(char) * M86_PRINT_FORMAT_SIZE);
-    if (m86_di_is_valid_instruct(di))
-    {
-        output = m86ds_get_mnemonic(di.opcode);
-        if (m86_di_instruct_has_operand(di)) has_operand = true;
-        if (m86_di_instruct_is_immediate(di) &&
-                !(is_jmp_instruct(di))) nonjmp_immediate = true;
-    } else sprintf(output, M86_PRINT_FORMAT, word);
-    if (has_operand)
-    {
-        m86_check_memory_bounds(di.operand, STD_ERR_DEST,
-                EXIT_FAILURE, micro86_cpu, micro86_memory, mem_size);
-        if (nonjmp_immediate)
-            fprintf(stream, "%s\t\t"
-                    M86_PRINT_FORMAT "\n", output, di.operand);
-        else
-            fprintf(stream, "%s\t\t" M86_PRINT_FORMAT "\t\t|"
-                    M86_PRINT_FORMAT ": " M86_PRINT_FORMAT "|\n",
-                    output, di.operand, di.operand,
-                    m_get_value(micro86_memory, di.operand));
-    } else fprintf(stream, "%s\n", output);
+    fprintf(stream, "*** Micro86 Emulator V. " M86_VERSION_NUM
+            " BOOTING ***\n\n" "Program file: %s\n", file_name); 
+    if (machine->trace != NULL)
+        fprintf(stream, "\n=== EXECUTION TRACE ===\n\n");
+    m86_run_limited(stream, machine, max_instructs, max_seconds,
+            trace_from, watch);
+    if (dump)
+        m86_disassembly(stream, machine->cpu, machine->mem,
+                machine->mem_size, machine->program_size,
+                machine->error_code);
+    m86_postmortem_dump(machine->cpu,
+            machine->mem, machine->mem_size, stream);
+    if (report) m86_tier_report(machine, stream);
+    fprintf(stream, "\n*** Micro86 Emulator V. " M86_VERSION_NUM
+            " HALTED ***\n");
     return;
 }
 
-/* Print out disassembled code in memory.
+/* Return true if line of program file holds an instruction (i.e., it
+ * is neither empty nor a comment), copying the instruction, without
+ * any comment, into instruct.
  */
-static void m86_disassembly(
-        FILE *stream,
-        const micro86_proc micro86_cpu,
-        const memory micro86_memory,
-        const unsigned int mem_size,
-        const unsigned int program_size)
+static bool m86_instruct_line(
+        const char *line,
+        char *instruct)
 {
-    m86_check_no_prgm_error(program_size, STD_ERR_DEST,
-            EXIT_FAILURE, micro86_cpu, micro86_memory, mem_size);
-    unsigned int i;
-    fprintf(stream, "\n=== DISASSEMBLED CODE ===\n\n");
-    for (i = 0; i < program_size; i++)
+    long comment_pos;
+    if (is_empty_line(line)) return false;
+    if ((comment_pos = char_pos_str(line, M86_PRGM_FILE_COMMENT)) != -1)
     {
-        m86_check_memory_bounds(i, STD_ERR_DEST,
-                EXIT_FAILURE, micro86_cpu, micro86_memory, mem_size);
-        fprintf(stream, M86_PRINT_FORMAT ":\t", i);
-        m86_disassemble(stream, micro86_cpu,
-                micro86_memory, mem_size,
-                m_get_value(micro86_memory, i));
-    }
-    return;
+        if ((unsigned long) comment_pos ==
+                strspn(line, M86_PRGM_FILE_DELIM))
+            return false;
+        strncpy(instruct, line, comment_pos);
+        instruct[comment_pos] = '\0';
+    } else strcpy(instruct, line);
+    return true;
 }
 
-/* Execute the decoded instruction.
+/* Return the number of instructions in program file, which is read
+ * from its current position and then rewound to it; 0 if it cannot be
+ * rewound (e.g., it is a pipe).
  */
-static void execute(
-        FILE *stream,
-        bool *running,
-        const bool trace,
-        micro86_proc *micro86_cpu,
-        memory *micro86_memory,
-        const unsigned int mem_size,
-        const m86_decoded_instruct di)
+static unsigned int m86_count_instructs(FILE *file)
 {
-    if (trace)
-    {
-        fprintf(stream, M86_PRINT_FORMAT ":\t",
-                m86_get_ip_reg(*micro86_cpu) - 1);
-        m86_disassemble(stream, *micro86_cpu,
-                *micro86_memory, mem_size,
-                m86_get_ir_reg(*micro86_cpu));
-        fprintf(stream, "\t\t");
-        m86_print_proc(*micro86_cpu, stream);
-    }
-    switch (di.opcode)
-    {
-        case HALT:  *running = false;
-                    break;
-        case LOAD:  m86_check_memory_bounds(di.operand, STD_ERR_DEST,
-                            EXIT_FAILURE,
-                            *micro86_cpu, *micro86_memory, mem_size);
-                    m86_set_acc_reg(micro86_cpu,
-                            m_get_value(*micro86_memory, di.operand));
-                    break;
-        case LOADI: m86_set_acc_reg(micro86_cpu, di.operand);
-                    break;
-        case STORE: m86_check_memory_bounds(di.operand, STD_ERR_DEST,
-                            EXIT_FAILURE,
-                            *micro86_cpu, *micro86_memory, mem_size);
-                    m_set_value(micro86_memory, di.operand,
-                            m86_get_acc_reg(*micro86_cpu));
-                    break;
-        case ADD:   m86_check_memory_bounds(di.operand, STD_ERR_DEST,
-                            EXIT_FAILURE,
-                            *micro86_cpu, *micro86_memory, mem_size);
-                    m86_set_acc_reg(micro86_cpu,
-                            m86_get_acc_reg(*micro86_cpu)
-                            + m_get_value(*micro86_memory,
-                                di.operand));
-                    break;
-        case ADDI:  m86_set_acc_reg(micro86_cpu,
-                            m86_get_acc_reg(*micro86_cpu)
-                            + di.operand);
-                    break;
-        case SUB:   m86_check_memory_bounds(di.operand, STD_ERR_DEST,
-                            EXIT_FAILURE,
-                            *micro86_cpu, *micro86_memory, mem_size);
-                    m86_set_acc_reg(micro86_cpu,
-                            m86_get_acc_reg(*micro86_cpu)
-                            - m_get_value(*micro86_memory,
-                                di.operand));
-                    break;
-        case SUBI:  m86_set_acc_reg(micro86_cpu,
-                            m86_get_acc_reg(*micro86_cpu)
-                            - di.operand);
-                    break;
-        case MUL:   m86_check_memory_bounds(di.operand, STD_ERR_DEST,
-                            EXIT_FAILURE,
-                            *micro86_cpu, *micro86_memory, mem_size);
-                    m86_set_acc_reg(micro86_cpu,
-                            m86_get_acc_reg(*micro86_cpu)
-                            * m_get_value(*micro86_memory,
-                                di.operand));
-                    break;
-        case MULI:  m86_set_acc_reg(micro86_cpu,
-                            m86_get_acc_reg(*micro86_cpu)
-                            * di.operand);
-                    break;
-        case DIV:   m86_check_memory_bounds(di.operand, STD_ERR_DEST,
-                            EXIT_FAILURE,
-                            *micro86_cpu, *micro86_memory, mem_size);
-                    {
-                        int divisor =
-                            m_get_value(*micro86_memory, di.operand);
-                        m86_check_zero_div_error(divisor,
-                                STD_ERR_DEST, EXIT_FAILURE,
-                                *micro86_cpu, *micro86_memory,
-                                mem_size);
-                        m86_set_acc_reg(micro86_cpu,
-                                m86_get_acc_reg(*micro86_cpu)
-                                / divisor);
-                    }
-                    break;
-        case DIVI:  m86_check_zero_div_error(di.operand, STD_ERR_DEST,
-                            EXIT_FAILURE, *micro86_cpu,
-                            *micro86_memory, mem_size);
-                    m86_set_acc_reg(micro86_cpu,
-                            m86_get_acc_reg(*micro86_cpu)
-                            / di.operand);
-                    break;
-        case MOD:   m86_check_memory_bounds(di.operand, STD_ERR_DEST,
-                            EXIT_FAILURE,
-                            *micro86_cpu, *micro86_memory, mem_size);
-                    {
-                        int divisor =
-                            m_get_value(*micro86_memory, di.operand);
-                        m86_check_zero_div_error(divisor,
-                                STD_ERR_DEST, EXIT_FAILURE,
-                                *micro86_cpu, *micro86_memory,
-                                mem_size);
-                        m86_set_acc_reg(micro86_cpu,
-                                m86_get_acc_reg(*micro86_cpu)
-                                % divisor);
-                    }
-                    break;
-        case MODI:  m86_check_zero_div_error(di.operand, STD_ERR_DEST,
-                            EXIT_FAILURE, *micro86_cpu,
-                            *micro86_memory, mem_size);
-                    m86_set_acc_reg(micro86_cpu,
-                            m86_get_acc_reg(*micro86_cpu)
-                            % di.operand);
-                    break;
-        case CMP:   m86_check_memory_bounds(di.operand, STD_ERR_DEST,
-                            EXIT_FAILURE,
-                            *micro86_cpu, *micro86_memory, mem_size);
-                    m86_set_flag_reg(micro86_cpu,
-                            m86_get_acc_reg(*micro86_cpu)
-                            - m_get_value(*micro86_memory,
-                                di.operand));
-                    break;
-        case CMPI:  m86_set_flag_reg(micro86_cpu,
-                        m86_get_acc_reg(*micro86_cpu) - di.operand);
-                    break;
-        case JMPI:  m86_set_ip_reg(micro86_cpu, di.operand);
-                    break;
-        case JEI:   if (m86_get_flags_zb(*micro86_cpu) ==
-                            ZERO_BIT_TRUE)
-                        m86_set_ip_reg(micro86_cpu, di.operand);
-                    break;
-        case JNEI:  if (m86_get_flags_zb(*micro86_cpu) ==
-                            ZERO_BIT_FALSE)
-                        m86_set_ip_reg(micro86_cpu, di.operand);
-                    break;
-        case JLI:   if (m86_get_flags_sb(*micro86_cpu) ==
-                            SIGN_BIT_TRUE)
-                        m86_set_ip_reg(micro86_cpu, di.operand);
-                    break;
-        case JLEI:  if ((m86_get_flags_sb(*micro86_cpu) ==
-                                SIGN_BIT_TRUE) ||
-                            (m86_get_flags_zb(*micro86_cpu) ==
-                             ZERO_BIT_TRUE))
-                        m86_set_ip_reg(micro86_cpu, di.operand);
-                    break;
-        case JGI:   if ((m86_get_flags_zb(*micro86_cpu) ==
-                                ZERO_BIT_FALSE) &&
-                            (m86_get_flags_sb(*micro86_cpu) ==
-                             SIGN_BIT_FALSE))
-                        m86_set_ip_reg(micro86_cpu, di.operand);
-                    break;
-        case JGEI:  {
-                        unsigned int zero_bit =
-                            m86_get_flags_zb(*micro86_cpu);
-                        if (((zero_bit == ZERO_BIT_FALSE) &&
-                                    (m86_get_flags_sb(*micro86_cpu) ==
-                                     SIGN_BIT_FALSE)) || (zero_bit ==
-                                     ZERO_BIT_TRUE))
-                            m86_set_ip_reg(micro86_cpu, di.operand);
-                    }
-                    break;
-        case IN:    {
-                        int input = fgetc(STD_IN_SRC);
-                        if (input == EOF)
-                        {
-                            file_read_error(STD_ERR_DEST,
-                                    "'STD_IN_SRC'", 0);
-                            m86_error(STD_ERR_DEST,
-                                    "Micro86 ERROR:"
-                                    " cannot read input!",
-                                    EXIT_FAILURE, *micro86_cpu,
-                                    *micro86_memory, mem_size);
-                        }
-                        m86_set_acc_reg(micro86_cpu,
-                                (unsigned char) input);
-                    }
-                    break;
-        case OUT:   fprintf(STD_OUT_DEST, "%c\n",
-                            (unsigned char)
-                            m86_get_acc_reg(*micro86_cpu));
-                    break;
-        default:    m86_invalid_opcode_error(STD_ERR_DEST, di.opcode,
-                            0);
-                    m86_error(STD_ERR_DEST,
-                            "Micro86 ERROR: invalid instruction!",
-                            EXIT_FAILURE, *micro86_cpu,
-                            *micro86_memory, mem_size);
-                    break;
-    }
-    return;
+    long start = ftell(file);
+    unsigned int count = 0;
+    char line[M86_PRGM_FILE_LINE_SIZE + 1],
+         instruct[M86_PRGM_FILE_LINE_SIZE + 1];
+    if (start < 0) return 0;
+    while (fgets(line, M86_PRGM_FILE_LINE_SIZE + 1, file) != NULL)
+        if (m86_instruct_line(line, instruct)) count++;
+    if (fseek(file, start, SEEK_SET) != 0) return 0;
+    return count;
 }
 
-/* Fetch the instruction from memory and return a decoded version.
+/* Report that memory cannot be extended to hold the program.
  */
-static m86_decoded_instruct fetch(
-        micro86_proc *micro86_cpu,
+static void m86_load_alloc_error(
+        const micro86_proc micro86_cpu,
         const memory micro86_memory,
-        const unsigned int mem_size,
-        const unsigned int program_size)
-{
-    m86_check_no_prgm_error(program_size, STD_ERR_DEST,
-            EXIT_FAILURE, *micro86_cpu, micro86_memory, mem_size);
-    unsigned int ip = m86_get_ip_reg(*micro86_cpu);
-    if (ip >= mem_size)
-    {
-        memory_bounds_error(STD_ERR_DEST, ip, 0);
-        m86_error(STD_ERR_DEST, "Micro86 ERROR: memory violation!",
-                EXIT_FAILURE, *micro86_cpu, micro86_memory, mem_size);
-    }
-    m86_set_ip_reg(micro86_cpu, (ip + 1));
-    if (m86_get_ip_reg(*micro86_cpu) > program_size)
-        m86_error(STD_ERR_DEST,
-                "Micro86 ERROR: program end reached!",
-                EXIT_FAILURE, *micro86_cpu, micro86_memory, mem_size);
-    m86_set_ir_reg(micro86_cpu, m_get_value(micro86_memory, ip));
-    return m86_ei_decoded(m86_get_ir_reg(*micro86_cpu));
-}
-
-/* Boot up the emulator and run the FDE cycle.
- */
-static void m86_boot_up(
-        FILE *stream,
-        const char *file_name,
-        micro86_proc *micro86_cpu,
-        memory *micro86_memory,
-        const unsigned int mem_size,
-        const unsigned int program_size,
-        const bool dump,
-        const bool trace,
-        bool *running)
+        const unsigned int mem_size)
 {
-    *running = true;
-    fprintf(stream, "*** Micro86 Emulator V. " M86_VERSION_NUM
-            " BOOTING ***\n\n" "Program file: %s\n", file_name); 
-    if (trace) fprintf(stream, "\n=== EXECUTION TRACE ===\n\n");
-    while (*running)
-    {
-        execute(
-                stream,
-                running,
-                trace,
-                micro86_cpu,
-                micro86_memory,
-                mem_size,
-                fetch(
-                    micro86_cpu,
-                    *micro86_memory,
-                    mem_size,
-                    program_size));
-    }
-    if (dump)
-        m86_disassembly(stream, *micro86_cpu,
-                *micro86_memory, mem_size, program_size);
-    m86_postmortem_dump(*micro86_cpu,
-            *micro86_memory, mem_size, stream);
-    fprintf(stream, "\n*** Micro86 Emulator V. " M86_VERSION_NUM
-            " HALTED ***\n");
+    memory_alloc_error(STD_ERR_DEST, 0);
+    m86_error(STD_ERR_DEST, "Micro86 ERROR:"
+            " unable to set up environment!",
+            EXIT_FAILURE, micro86_cpu, micro86_memory, mem_size);
     return;
 }
 
@@ -534,31 +266,27 @@ static void m86_loader(
                 EXIT_FAILURE, micro86_cpu,
                 *micro86_memory, *mem_size);
     }
-    long comment_pos;
-    bool found_instruct = false;
-    unsigned int line_count = 0, instruct_count = 0;
+    unsigned int line_count = 0, instruct_count = 0,
+                 allocated = *mem_size;
     char line[M86_PRGM_FILE_LINE_SIZE + 1],
          instruct[M86_PRGM_FILE_LINE_SIZE + 1];
+    if (mem_resize)
+    {
+        /* Allocate memory for the whole program at once; it is still
+         * extended M86_MEM_EXT_SIZE units at a time below, but within
+         * what is allocated. */
+        unsigned int count = m86_count_instructs(file);
+        while (allocated < count) allocated += M86_MEM_EXT_SIZE;
+        if ((allocated > *mem_size) &&
+                !m_extend_init(micro86_memory, *mem_size,
+                    allocated - *mem_size, M86_INIT_MEM_VAL))
+            m86_load_alloc_error(micro86_cpu, *micro86_memory,
+                    *mem_size);
+    }
     while (fgets(line, M86_PRGM_FILE_LINE_SIZE + 1, file) != NULL)
     {
         line_count++;
-        if (is_empty_line(line)) continue;
-        if ((comment_pos =
-                    char_pos_str(line, M86_PRGM_FILE_COMMENT)) != -1)
-        {
-            if ((unsigned long) comment_pos !=
-                    strspn(line, M86_PRGM_FILE_DELIM))
-            {
-                found_instruct = true;
-                strncpy(instruct, line, comment_pos);
-                instruct[comment_pos] = '\0';
-            } else found_instruct = false;
-        } else
-        {
-            found_instruct = true;
-            strcpy(instruct, line);
-        }
-        if (found_instruct)
+        if (m86_instruct_line(line, instruct))
         {
             instruct_count++;
             if (M86_DEBUG)
@@ -593,9 +321,13 @@ static void m86_loader(
                             *micro86_memory, *mem_size);
                 } else
                 {
-                    m_extend_init(micro86_memory, *mem_size,
-                            M86_MEM_EXT_SIZE, M86_INIT_MEM_VAL);
+                    if ((*mem_size + M86_MEM_EXT_SIZE > allocated) &&
+                            !m_extend_init(micro86_memory, *mem_size,
+                                M86_MEM_EXT_SIZE, M86_INIT_MEM_VAL))
+                        m86_load_alloc_error(micro86_cpu,
+                                *micro86_memory, *mem_size);
                     *mem_size += M86_MEM_EXT_SIZE;
+                    if (*mem_size > allocated) allocated = *mem_size;
                 }
             }
             m_set_value(micro86_memory,
@@ -615,11 +347,23 @@ static const char *m86_process_cmd_line(
         char *argv[],
         bool *dump,
         bool *trace,
-        bool *mem_resize)
+        bool *mem_resize,
+        unsigned long *mem_units,
+        bool *threaded,
+        bool *jit,
+        bool *aot,
+        bool *tiered,
+        bool *replay,
+        bool *report,
+        unsigned long *max_instructs,
+        double *max_seconds,
+        unsigned long *trace_from,
+        long *trace_at)
 {
-    if ((argc < 2) || (argc > 5)) return NULL;
+    if ((argc < 2) || (argc > 21)) return NULL;
     int i;
-    char *file_name = NULL;
+    char *file_name = NULL,
+         *end;
     bool file_found = false;
     for (i = 1; i < argc; i++)
     {
@@ -630,7 +374,50 @@ static const char *m86_process_cmd_line(
             else if (!(strcmp(opt, M86_MEM_RESIZE_OPT)))
                 *mem_resize = true;
             else if (!(strcmp(opt, M86_TRACE_OPT))) *trace = true;
-            else return NULL;
+            else if (!(strcmp(opt, M86_THREADED_OPT))) *threaded = true;
+            else if (!(strcmp(opt, M86_JIT_OPT))) *jit = true;
+            else if (!(strcmp(opt, M86_AOT_OPT))) *aot = true;
+            else if (!(strcmp(opt, M86_TIERED_OPT))) *tiered = true;
+            else if (!(strcmp(opt, M86_REPLAY_OPT))) *replay = true;
+            else if (!(strcmp(opt, M86_TIER_REPORT_OPT)))
+                *tiered = *report = true;
+            else if (!(strcmp(opt, M86_MEM_SIZE_OPT)))
+            {
+                if (++i >= argc) return NULL;
+                *mem_units = strtoul(argv[i], &end, 0);
+                if (!isdigit((unsigned char) argv[i][0]) ||
+                        (*end != '\0') || (*mem_units == 0) ||
+                        (*mem_units > M86_MAX_MEM_SIZE))
+                    return NULL;
+            } else if (!(strcmp(opt, M86_LIMIT_OPT)))
+            {
+                if (++i >= argc) return NULL;
+                *max_instructs = strtoul(argv[i], &end, 10);
+                if (!isdigit((unsigned char) argv[i][0]) ||
+                        (*end != '\0') || (*max_instructs == 0))
+                    return NULL;
+            } else if (!(strcmp(opt, M86_TIMEOUT_OPT)))
+            {
+                if (++i >= argc) return NULL;
+                *max_seconds = strtod(argv[i], &end);
+                if (!isdigit((unsigned char) argv[i][0]) ||
+                        (*end != '\0') || (*max_seconds <= 0))
+                    return NULL;
+            } else if (!(strcmp(opt, M86_TRACE_FROM_OPT)))
+            {
+                if (++i >= argc) return NULL;
+                *trace_from = strtoul(argv[i], &end, 10);
+                if (!isdigit((unsigned char) argv[i][0]) ||
+                        (*end != '\0') || (*trace_from == 0))
+                    return NULL;
+            } else if (!(strcmp(opt, M86_TRACE_AT_OPT)))
+            {
+                if (++i >= argc) return NULL;
+                *trace_at = (long) strtoul(argv[i], &end, 0);
+                if (!isdigit((unsigned char) argv[i][0]) ||
+                        (*end != '\0') || (*trace_at < 0))
+                    return NULL;
+            } else return NULL;
         } else
         {
             if (file_found) return NULL;
@@ -646,7 +433,17 @@ int main(int argc, char *argv[])
     bool dump = false,
          trace = false,
          mem_resize = false,
-         running = false;
+         threaded = false,
+         jit = false,
+         aot = false,
+         tiered = false,
+         replay = false,
+         report = false;
+    unsigned long mem_units = M86_DEF_MEM_SIZE,
+                  max_instructs = 0,
+                  trace_from = 0;
+    long trace_at = -1;
+    double max_seconds = 0;
     micro86_proc micro86_cpu;
     m86_proc_init(&micro86_cpu);
     memory micro86_memory;
@@ -654,26 +451,77 @@ int main(int argc, char *argv[])
     m_allocate_init(&micro86_memory, mem_size, M86_INIT_MEM_VAL);
     const char *file_name;
     if ((file_name = m86_process_cmd_line(argc, argv,
-                    &dump, &trace, &mem_resize)) == NULL)
+                    &dump, &trace, &mem_resize, &mem_units,
+                    &threaded, &jit, &aot, &tiered, &replay, &report,
+                    &max_instructs, &max_seconds,
+                    &trace_from, &trace_at)) == NULL)
     {
         fprintf(STD_ERR_DEST,
                 "Usage: %s <program_file> [-"
                 M86_DUMP_OPT " (dump)] [-"
                 M86_MEM_RESIZE_OPT " (memory resize)] [-"
-                M86_TRACE_OPT " (trace)]\n", argv[0]);
+                M86_MEM_SIZE_OPT " <units> (memory size)] [-"
+                M86_TRACE_OPT " (trace)] [-"
+                M86_THREADED_OPT " (threaded dispatch)] [-"
+                M86_JIT_OPT " (native translation)] [-"
+                M86_AOT_OPT " (ahead-of-time compilation)] [-"
+                M86_TIERED_OPT " (tiered execution)] [-"
+                M86_TIER_REPORT_OPT " (tier residency report)] [-"
+                M86_REPLAY_OPT " (cached result)] [-"
+                M86_LIMIT_OPT " <count> (instruction limit)] [-"
+                M86_TIMEOUT_OPT " <seconds> (time limit)] [-"
+                M86_TRACE_FROM_OPT " <count> (trace after count)] [-"
+                M86_TRACE_AT_OPT " <address> (trace from address)]\n",
+                argv[0]);
         m86_error(STD_ERR_DEST, "Micro86 ERROR:"
                 " unable to set up environment!",
                 EXIT_FAILURE, micro86_cpu, micro86_memory, mem_size);
     }
+    if ((mem_units > mem_size) && !m_extend_init(&micro86_memory,
+                mem_size, mem_units - mem_size, M86_INIT_MEM_VAL))
+    {
+        memory_alloc_error(STD_ERR_DEST, 0);
+        m86_error(STD_ERR_DEST, "Micro86 ERROR:"
+                " unable to set up environment!",
+                EXIT_FAILURE, micro86_cpu, micro86_memory, mem_size);
+    }
+    mem_size = mem_units;
     unsigned int program_size;
     m86_loader(file_name, micro86_cpu,
             &micro86_memory, &mem_size, mem_resize, &program_size);
+    micro86_machine machine;
+    if (!m86_machine_init(&machine,
+                micro86_memory, mem_size, program_size))
+    {
+        memory_alloc_error(STD_ERR_DEST, 0);
+        m86_error(STD_ERR_DEST, "Micro86 ERROR:"
+                " unable to set up environment!",
+                EXIT_FAILURE, micro86_cpu, micro86_memory, mem_size);
+    }
+    machine.trace = trace ? STD_OUT_DEST : NULL;
+    machine.threaded = threaded;
+    machine.jit = jit;
+    machine.aot = aot;
+    machine.tiered = tiered;
+    machine.replay = replay;
+    machine.error_code = EXIT_FAILURE;
+    if ((trace_at >= 0) && (((unsigned long) trace_at >= program_size)
+                || !m86_set_breakpoint(&machine,
+                    (unsigned int) trace_at)))
+    {
+        m86_error(STD_ERR_DEST, "Micro86 ERROR:"
+                " trace address outside program!",
+                EXIT_FAILURE, micro86_cpu, micro86_memory, mem_size);
+    }
+    const bool watch = trace || (trace_from > 0) || (trace_at >= 0);
+#ifdef SIGUSR1
+    if (watch) signal(M86_TRACE_SIGNAL, m86_toggle_trace);
+#endif
     m86ds_init();
-    m86_boot_up(STD_OUT_DEST, file_name, &micro86_cpu,
-            &micro86_memory, mem_size, program_size,
-            dump, trace, &running);
+    m86_boot_up(STD_OUT_DEST, file_name, &machine, dump, report,
+            max_instructs, max_seconds, trace_from, watch);
     m86ds_kill();
-    m_deallocate(&micro86_memory);
+    m86_machine_kill(&machine);
     return EXIT_SUCCESS;
 }
 
@@ -22,11 +22,102 @@
  */
 #define M86_MEM_RESIZE_OPT "r"
 
+/* M86_MEM_SIZE_OPT: command-line memory size option (followed by the
+ * number of memory units to allocate initially, up to
+ * M86_MAX_MEM_SIZE).
+ */
+#define M86_MEM_SIZE_OPT "m"
+
+/* M86_THREADED_OPT: command-line threaded dispatch option.
+ */
+#define M86_THREADED_OPT "g"
+
+/* M86_JIT_OPT: command-line native translation (just-in-time
+ * compilation) option.
+ */
+#define M86_JIT_OPT "j"
+
+/* M86_AOT_OPT: command-line ahead-of-time compilation option (see
+ * micro86_aot.h for the compile cache).
+ */
+#define M86_AOT_OPT "a"
+
+/* M86_TIERED_OPT: command-line tiered execution option (see
+ * micro86_machine.h).
+ */
+#define M86_TIERED_OPT "p"
+
+/* M86_TIER_REPORT_OPT: command-line tier residency report option
+ * (implies tiered execution).
+ */
+#define M86_TIER_REPORT_OPT "s"
+
+/* M86_REPLAY_OPT: command-line cached result option (see
+ * micro86_replay.h).
+ */
+#define M86_REPLAY_OPT "c"
+
+/* M86_LIMIT_OPT: command-line instruction limit option (followed by
+ * the maximum number of instructions to execute).
+ */
+#define M86_LIMIT_OPT "l"
+
+/* M86_TIMEOUT_OPT: command-line wall-clock limit option (followed by
+ * the maximum number of seconds to run for).
+ */
+#define M86_TIMEOUT_OPT "w"
+
+/* M86_TRACE_FROM_OPT: command-line delayed execution trace option
+ * (followed by the number of instructions to execute before the trace
+ * is switched on).
+ */
+#define M86_TRACE_FROM_OPT "f"
+
+/* M86_TRACE_AT_OPT: command-line execution trace trigger option
+ * (followed by the position the instruction pointer has to reach for
+ * the trace to be switched on, in decimal, octal or hexadecimal).
+ */
+#define M86_TRACE_AT_OPT "b"
+
+/* M86_LIMIT_EXIT_CODE: exit code used when the instruction or
+ * wall-clock limit is reached (the same as timeout(1)'s).
+ */
+#define M86_LIMIT_EXIT_CODE 124
+
+/* M86_WATCHDOG_SLICE: number of instructions executed between checks
+ * of the wall-clock limit, and of whether the execution trace was
+ * toggled with M86_TRACE_SIGNAL.
+ */
+#define M86_WATCHDOG_SLICE (1UL << 20)
+
+/* M86_TRACE_SIGNAL: signal toggling the execution trace on and off
+ * while the program runs, provided that any of the execution trace
+ * options is set (only on platforms that define it).
+ */
+#define M86_TRACE_SIGNAL SIGUSR1
+
+/* M86_HAVE_THREADED: whether the threaded dispatch engine is available
+ * (it relies on the labels as values extension of GCC and compatible
+ * compilers); if not, the threaded dispatch option is accepted but
+ * has no effect.
+ */
+#if defined(__GNUC__)
+#define M86_HAVE_THREADED 1
+#else
+#define M86_HAVE_THREADED 0
+#endif
+
 /* M86_DEF_MEM_SIZE: default memory size (i.e., number of memory units
  * allocated initially).
  */
 #define M86_DEF_MEM_SIZE 20
 
+/* M86_MAX_MEM_SIZE: maximum memory size that can be requested with
+ * M86_MEM_SIZE_OPT (i.e., number of memory units operands can
+ * address).
+ */
+#define M86_MAX_MEM_SIZE 0x10000
+
 /* M86_INIT_MEM_VAL: initial value for all memory units.
  */
 #define M86_INIT_MEM_VAL 0x00
@@ -0,0 +1,417 @@
+/* micro86_aot:
+ *
+ * Ahead-of-time compiler from micro86 program images to native shared
+ * objects.
+ *
+ * Translated code keeps the accumulator and the result of the latest
+ * comparison in unsigned locals, so that arithmetic wraps around as it
+ * does in the interpreter without relying on signed overflow. Each
+ * reachable position gets a label; the function starts with a switch
+ * on the instruction pointer that jumps to the matching label, and
+ * jumps between positions become gotos.
+ */
+
+#ifndef _STDIO_H
+#include <stdio.h>
+#endif
+
+#ifndef _STDLIB_H
+#include <stdlib.h>
+#endif
+
+#ifndef _STRING_H
+#include <string.h>
+#endif
+
+#ifndef MICRO86_H
+#include "micro86.h"
+#endif
+
+#ifndef MICRO86CACHE_H
+#include "micro86_cache.h"
+#endif
+
+#ifndef MICRO86AOT_H
+#include "micro86_aot.h"
+#endif
+
+#if M86_HAVE_AOT
+
+#ifndef _DLFCN_H
+#include <dlfcn.h>
+#endif
+
+#ifndef _UNISTD_H
+#include <unistd.h>
+#endif
+
+/* M86AOT_KEY_NAME: name of the string translated code defines to hold
+ * the cache key it was built for, checked on loading.
+ */
+#define M86AOT_KEY_NAME "m86aot_key"
+
+/* M86AOT_IMAGE_NAME: name of the array translated code defines to hold
+ * the words of the program it was translated from, checked on loading
+ * (the cache key is only a hash of them).
+ */
+#define M86AOT_IMAGE_NAME "m86aot_image"
+
+/* M86AOT_PARAMS_NAME: name of the array translated code defines to
+ * hold the number of words of the program, the memory size and the
+ * entry (see m86pd_resume()) it was translated for, checked on
+ * loading.
+ */
+#define M86AOT_PARAMS_NAME "m86aot_params"
+
+/* M86AOT_CC_FLAGS: flags passed on to the C compiler.
+ */
+#define M86AOT_CC_FLAGS "-O2 -shared -fPIC"
+
+/* Write C code for the program into stream; return false if it could
+ * not be written.
+ */
+static bool m86aot_generate(
+        FILE *stream,
+        const m86_predecoded_program *program,
+        const unsigned int mem_size,
+        const char *key)
+{
+    static const char *const conditions[] =
+    {
+        "_cmp == 0",            /* JEI */
+        "_cmp != 0",            /* JNEI */
+        "(int) _cmp < 0",       /* JLI */
+        "(int) _cmp <= 0",      /* JLEI */
+        "(int) _cmp > 0",       /* JGI */
+        "(int) _cmp >= 0"       /* JGEI */
+    };
+    const unsigned int size = program->size;
+    bool *reachable = m86pd_reachable(program);
+    unsigned int pos,
+                 k;
+    const m86_predecoded_instruct *di;
+    if (reachable == NULL) return false;
+    fprintf(stream,
+            "/* micro86 program %s, translated by Micro86 Emulator"
+            " V. " M86_VERSION_NUM ". */\n\n"
+            "typedef struct\n{\n"
+            "    int acc, cmp;\n"
+            "    unsigned int ip, ir;\n"
+            "    int *mem;\n"
+            "    unsigned int status;\n"
+            "} m86_aot_state;\n\n"
+            "const char " M86AOT_KEY_NAME "[] = \"%s\";\n\n"
+            "const unsigned int " M86AOT_PARAMS_NAME "[] ="
+            " { %uu, %uu, %uu };\n\n"
+            "const int " M86AOT_IMAGE_NAME "[] =\n{\n",
+            key, key, size, mem_size, program->entry);
+    for (pos = 0; pos < size; pos++)
+        fprintf(stream, "    (int) 0x%08Xu,\n",
+                (unsigned int) program->code[pos].word);
+    fprintf(stream, "};\n\n"
+            "void " M86AOT_ENTRY_NAME "(m86_aot_state *s)\n{\n"
+            "    int *mem = s->mem;\n"
+            "    unsigned int _acc = (unsigned int) s->acc,\n"
+            "                 _cmp = (unsigned int) s->cmp,\n"
+            "                 _ip = s->ip,\n"
+            "                 _status = %d;\n"
+            "    switch (_ip)\n    {\n",
+            M86AOT_INTERPRET);
+    for (pos = 0; pos < size; pos++)
+        if (reachable[pos])
+            fprintf(stream, "        case %u: goto L%u;\n", pos, pos);
+    fprintf(stream, "        default: goto leave;\n    }\n");
+
+/* Leave the instruction at position p to the interpreter. */
+#define LEAVE(p) \
+    fprintf(stream, "    { _ip = %u; goto leave; }\n", (p))
+
+/* Leave for position p past the end of the program after running the
+ * current instruction, so the interpreter reports the error. */
+#define LEAVE_PAST(p) \
+    fprintf(stream, "    { s->ir = 0x%08Xu; _ip = %u; goto leave; }\n",\
+            (unsigned int) di->word, (p))
+
+    for (pos = 0; pos < size; pos++)
+    {
+        if (!reachable[pos]) continue;
+        di = program->code + pos;
+        k = (unsigned int) di->operand;
+        fprintf(stream, "L%u:\n", pos);
+        switch (di->handler)
+        {
+            case M86PD_LOAD:
+            case M86PD_STORE:
+            case M86PD_STORE_CODE:
+            case M86PD_ADD:
+            case M86PD_SUB:
+            case M86PD_MUL:
+            case M86PD_DIV:
+            case M86PD_MOD:
+            case M86PD_CMP:
+                if (k >= mem_size)
+                {
+                    LEAVE(pos);
+                    continue;
+                }
+                break;
+            default:
+                break;
+        }
+        switch (di->handler)
+        {
+            case M86PD_LOAD:
+                fprintf(stream,
+                        "    _acc = (unsigned int) mem[%u];\n", k);
+                break;
+            case M86PD_LOADI:
+                fprintf(stream, "    _acc = %uu;\n", k);
+                break;
+            case M86PD_STORE:
+                fprintf(stream, "    mem[%u] = (int) _acc;\n", k);
+                break;
+            case M86PD_STORE_CODE:
+                fprintf(stream, "    mem[%u] = (int) _acc;\n", k);
+                if (reachable[k])
+                    fprintf(stream, "    if (_acc != 0x%08Xu)\n"
+                            "    {\n"
+                            "        s->ir = 0x%08Xu;\n"
+                            "        _status = %d;\n"
+                            "        _ip = %u;\n"
+                            "        goto leave;\n"
+                            "    }\n",
+                            (unsigned int) program->code[k].word,
+                            (unsigned int) di->word,
+                            M86AOT_MODIFIED, pos + 1);
+                break;
+            case M86PD_ADD:
+                fprintf(stream,
+                        "    _acc += (unsigned int) mem[%u];\n", k);
+                break;
+            case M86PD_ADDI:
+                fprintf(stream, "    _acc += %uu;\n", k);
+                break;
+            case M86PD_SUB:
+                fprintf(stream,
+                        "    _acc -= (unsigned int) mem[%u];\n", k);
+                break;
+            case M86PD_SUBI:
+                fprintf(stream, "    _acc -= %uu;\n", k);
+                break;
+            case M86PD_MUL:
+                fprintf(stream,
+                        "    _acc *= (unsigned int) mem[%u];\n", k);
+                break;
+            case M86PD_MULI:
+                fprintf(stream, "    _acc *= %uu;\n", k);
+                break;
+            case M86PD_DIV:
+            case M86PD_MOD:
+                fprintf(stream, "    if (mem[%u] == 0)", k);
+                LEAVE(pos);
+                fprintf(stream, "    _acc = (unsigned int)"
+                        " ((int) _acc %c mem[%u]);\n",
+                        (di->handler == M86PD_DIV) ? '/' : '%', k);
+                break;
+            case M86PD_DIVI:
+            case M86PD_MODI:
+                if (k == 0)
+                {
+                    LEAVE(pos);
+                    break;
+                }
+                fprintf(stream, "    _acc = (unsigned int)"
+                        " ((int) _acc %c %u);\n",
+                        (di->handler == M86PD_DIVI) ? '/' : '%', k);
+                break;
+            case M86PD_CMP:
+                fprintf(stream,
+                        "    _cmp = _acc - (unsigned int) mem[%u];\n",
+                        k);
+                break;
+            case M86PD_CMPI:
+                fprintf(stream, "    _cmp = _acc - %uu;\n", k);
+                break;
+            case M86PD_JMPI:
+                if (k < size) fprintf(stream, "    goto L%u;\n", k);
+                else LEAVE_PAST(k);
+                break;
+            case M86PD_JEI:
+            case M86PD_JNEI:
+            case M86PD_JLI:
+            case M86PD_JLEI:
+            case M86PD_JGI:
+            case M86PD_JGEI:
+                fprintf(stream, "    if (%s)",
+                        conditions[di->handler - M86PD_JEI]);
+                if (k < size) fprintf(stream, " goto L%u;\n", k);
+                else LEAVE_PAST(k);
+                break;
+            default:
+                /* HALT, IN, OUT and invalid instructions. */
+                LEAVE(pos);
+                break;
+        }
+    }
+    /* Fall through past the last instruction of the program. */
+    if (reachable[size - 1])
+    {
+        di = program->code + size - 1;
+        LEAVE_PAST(size);
+    }
+    free(reachable);
+    fprintf(stream, "leave:\n"
+            "    s->acc = (int) _acc;\n"
+            "    s->cmp = (int) _cmp;\n"
+            "    s->ip = _ip;\n"
+            "    s->status = _status;\n"
+            "}\n");
+    return !ferror(stream);
+
+#undef LEAVE
+#undef LEAVE_PAST
+}
+
+/* Load shared object at specified path; return false if it cannot be
+ * loaded or was not built for the cache key and the program itself.
+ */
+static bool m86aot_load(
+        m86_aot *aot,
+        const char *path,
+        const m86_predecoded_program *program,
+        const unsigned int mem_size,
+        const char *key)
+{
+    const char *built_for;
+    const unsigned int *params;
+    const int *image;
+    unsigned int pos;
+    bool same;
+    if ((aot->handle = dlopen(path, RTLD_NOW | RTLD_LOCAL)) == NULL)
+        return false;
+    *(void **) &aot->entry = dlsym(aot->handle, M86AOT_ENTRY_NAME);
+    built_for = dlsym(aot->handle, M86AOT_KEY_NAME);
+    params = dlsym(aot->handle, M86AOT_PARAMS_NAME);
+    image = dlsym(aot->handle, M86AOT_IMAGE_NAME);
+    same = (aot->entry != NULL) && (built_for != NULL) &&
+        (params != NULL) && (image != NULL) &&
+        (strcmp(built_for, key) == 0) &&
+        (params[0] == program->size) && (params[1] == mem_size) &&
+        (params[2] == program->entry);
+    for (pos = 0; same && (pos < program->size); pos++)
+        same = (image[pos] == program->code[pos].word);
+    if (same) return true;
+    dlclose(aot->handle);
+    aot->handle = NULL;
+    return false;
+}
+
+/* Translate the program and build it into a shared object at
+ * specified path; return false on failure.
+ */
+static bool m86aot_build(
+        const m86_predecoded_program *program,
+        const unsigned int mem_size,
+        const char *key,
+        const char *path)
+{
+    char source[M86CACHE_PATH_SIZE],
+         object[M86CACHE_PATH_SIZE],
+         *command;
+    const char *cc = getenv("CC");
+    FILE *stream;
+    bool built;
+    if ((cc == NULL) || (*cc == '\0')) cc = "cc";
+    /* Paths are quoted with single quotes in the compiler command. */
+    if ((strchr(path, '\'') != NULL) ||
+            !m86cache_temp_path(source, path, ".c") ||
+            !m86cache_temp_path(object, path, ".so"))
+        return false;
+    if ((stream = fopen(source, "w")) == NULL) return false;
+    built = m86aot_generate(stream, program, mem_size, key);
+    built = (fclose(stream) == 0) && built;
+    command = malloc(strlen(cc) + 2 * M86CACHE_PATH_SIZE + 64);
+    if (built && (command != NULL))
+    {
+        sprintf(command, "%s " M86AOT_CC_FLAGS " -o '%s' '%s'"
+                " >/dev/null 2>&1", cc, object, source);
+        built = (system(command) == 0) &&
+            (rename(object, path) == 0);
+    } else built = false;
+    free(command);
+    remove(source);
+    if (!built) remove(object);
+    return built;
+}
+
+#endif
+
+/* m86aot_init: load translated program, from the cache if possible,
+ * or else compiling and caching it first.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to m86_aot variable.
+ * # pointer to m86_predecoded_program variable.
+ * # unsigned value for memory size.
+ *
+ * Note: the translation reflects the records of the pre-decoded
+ * program as they are when this function is called, which must be up
+ * to date (see m86pd_refresh()).
+ *
+ * Note: to avoid resource leaks, m86aot_kill() should be called once
+ * the translated program is no longer needed, provided that this
+ * function succeeded.
+ *
+ * Returns: bool value to indicate status of initialization; true =
+ * success, false = failure (i.e., shared objects unavailable, or the
+ * program could not be compiled or loaded).
+ */
+bool m86aot_init(
+        m86_aot *aot,
+        const m86_predecoded_program *program,
+        const unsigned int mem_size)
+{
+#if M86_HAVE_AOT
+    char path[M86CACHE_PATH_SIZE],
+         key[M86CACHE_KEY_SIZE];
+    if ((aot == NULL) || (program == NULL) || (program->size == 0))
+        return false;
+    m86cache_key(key, program, mem_size, M86AOT_ABI_VERSION);
+    if (!m86cache_path(path, key, ".so")) return false;
+    if (m86aot_load(aot, path, program, mem_size, key)) return true;
+    /* Not cached yet (or unusable): build it anew. */
+    return m86aot_build(program, mem_size, key, path) &&
+        m86aot_load(aot, path, program, mem_size, key);
+#else
+    (void) aot;
+    (void) program;
+    (void) mem_size;
+    return false;
+#endif
+}
+
+/* m86aot_kill: unload translated program.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to m86_aot variable.
+ *
+ * Note: passing NULL results in no operation being performed.
+ *
+ * Returns: N/A.
+ */
+void m86aot_kill(m86_aot *aot)
+{
+#if M86_HAVE_AOT
+    if ((aot == NULL) || (aot->handle == NULL)) return;
+    dlclose(aot->handle);
+    aot->handle = NULL;
+    aot->entry = NULL;
+#else
+    (void) aot;
+#endif
+    return;
+}
+
+/* EOF. */
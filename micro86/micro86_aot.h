@@ -0,0 +1,156 @@
+/* micro86_aot:
+ *
+ * Ahead-of-time compiler from micro86 program images to native shared
+ * objects.
+ *
+ * The code region is translated into a C function, which is built by
+ * the system C compiler (the CC environment variable, "cc" by default)
+ * into a shared object and loaded with dlopen(). Shared objects are
+ * kept in the cache (see micro86_cache.h), so later runs of the same
+ * image load native code straight away instead of compiling it again.
+ *
+ * Only the instructions statically reachable from position 0 are
+ * translated. Translated code returns to the caller, which interprets
+ * the instruction in question, at instructions that are left to the
+ * interpreter: HALT, IN, OUT, invalid instructions, memory operands
+ * outside memory bounds, division by zero, jumps beyond the end of the
+ * program and entries at positions that are not translated. STOREs
+ * that modify reachable code return to the caller as well, since the
+ * translation no longer matches the program.
+ *
+ * Note: on platforms other than Unix-like systems, m86aot_init() always
+ * fails and callers are expected to fall back to interpreting.
+ */
+
+#ifndef _STDBOOL_H
+#include <stdbool.h>
+#endif
+
+#ifndef MICRO86PREDECODE_H
+#include "micro86_predecode.h"
+#endif
+
+#ifndef MICRO86AOT_H
+#define MICRO86AOT_H
+
+/* M86_HAVE_AOT: whether shared objects can be built and loaded.
+ */
+#if defined(__unix__)
+#define M86_HAVE_AOT 1
+#else
+#define M86_HAVE_AOT 0
+#endif
+
+/* M86AOT_ABI_VERSION: version of the interface between translated code
+ * and its caller; part of the cache key, so it has to be bumped
+ * whenever m86_aot_state or the generated code changes (see
+ * m86cache_key()).
+ */
+#define M86AOT_ABI_VERSION 2
+
+/* M86AOT_ENTRY_NAME: name of the function defined by translated code.
+ */
+#define M86AOT_ENTRY_NAME "m86aot_entry"
+
+/* Statuses of translated code on returning (see m86_aot_state).
+ *
+ * # M86AOT_INTERPRET: the instruction at the instruction pointer is
+ * left to the interpreter.
+ * # M86AOT_MODIFIED: the STORE in the instruction register modified
+ * reachable code; the instruction pointer is past it.
+ */
+#define M86AOT_INTERPRET 0
+#define M86AOT_MODIFIED  1
+
+/* Type: m86_aot_state.
+ *
+ * Machine state shared between translated code and its caller,
+ * consisting of the following:
+ *
+ * # acc: accumulator register.
+ * # cmp: result of the latest comparison (see m86_get_flags_cmp()).
+ * # ip: instruction pointer register.
+ * # ir: instruction register (only set by translated code when it
+ * returns right after running an instruction, i.e., with
+ * M86AOT_MODIFIED or past the end of the program).
+ * # mem: memory base (i.e., the memory variable).
+ * # status: status of translated code on returning.
+ *
+ * WARNING: translated code declares the same type; do not change it
+ * without updating micro86_aot.c and M86AOT_ABI_VERSION.
+ */
+typedef struct
+{
+    int acc,
+        cmp;
+    unsigned int ip,
+                 ir;
+    int *mem;
+    unsigned int status;
+} m86_aot_state;
+
+/* Type: m86_aot_entry.
+ *
+ * Translated program; running it updates the state passed to it.
+ */
+typedef void (*m86_aot_entry)(m86_aot_state*);
+
+/* Type: m86_aot.
+ *
+ * A loaded shared object consisting of the following:
+ *
+ * # handle: handle returned by dlopen().
+ * # entry: translated program.
+ *
+ * # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # #
+ * WARNING: m86_aot fields should not be modified directly. The
+ * functions declared below are to be used for such purposes.
+ * # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # #
+ */
+typedef struct
+{
+    void *handle;
+    m86_aot_entry entry;
+} m86_aot;
+
+/* m86aot_init: load translated program, from the cache if possible,
+ * or else compiling and caching it first.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to m86_aot variable.
+ * # pointer to m86_predecoded_program variable.
+ * # unsigned value for memory size.
+ *
+ * Note: the translation reflects the records of the pre-decoded
+ * program as they are when this function is called, which must be up
+ * to date (see m86pd_refresh()).
+ *
+ * Note: to avoid resource leaks, m86aot_kill() should be called once
+ * the translated program is no longer needed, provided that this
+ * function succeeded.
+ *
+ * Returns: bool value to indicate status of initialization; true =
+ * success, false = failure (i.e., shared objects unavailable, or the
+ * program could not be compiled or loaded).
+ */
+bool m86aot_init(
+        m86_aot*,
+        const m86_predecoded_program*,
+        const unsigned int);
+
+/* m86aot_kill: unload translated program.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to m86_aot variable.
+ *
+ * Note: passing NULL results in no operation being performed.
+ *
+ * Returns: N/A.
+ */
+void m86aot_kill(m86_aot*);
+
+#endif
+
+/* EOF. */
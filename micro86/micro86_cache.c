@@ -0,0 +1,204 @@
+/* micro86_cache:
+ *
+ * On-disk cache of translated code for the micro86 emulator.
+ *
+ * Keys are 64-bit FNV-1a hashes written as 16 hexadecimal digits.
+ */
+
+#ifndef _STDIO_H
+#include <stdio.h>
+#endif
+
+#ifndef _STDLIB_H
+#include <stdlib.h>
+#endif
+
+#ifndef _STRING_H
+#include <string.h>
+#endif
+
+#ifndef MICRO86_H
+#include "micro86.h"
+#endif
+
+#ifndef MICRO86CACHE_H
+#include "micro86_cache.h"
+#endif
+
+#if defined(__unix__)
+
+#ifndef _UNISTD_H
+#include <unistd.h>
+#endif
+
+#ifndef _SYS_STAT_H
+#include <sys/stat.h>
+#endif
+
+#endif
+
+/* Add a 32-bit value to an FNV-1a hash.
+ */
+static unsigned long long m86cache_hash(
+        unsigned long long hash,
+        const unsigned int value)
+{
+    unsigned int i;
+    for (i = 0; i < 4; i++)
+    {
+        hash ^= (value >> (i * 8)) & 0xFF;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+/* m86cache_key: write the cache key of a program into string.
+ *
+ * Parameters (in order):
+ *
+ * # string of at least M86CACHE_KEY_SIZE characters.
+ * # pointer to m86_predecoded_program variable.
+ * # unsigned value for memory size.
+ * # unsigned value for version of the format of what is cached.
+ *
+ * Note: the key is a hash of the words of the records of the
+ * pre-decoded program, which must be up to date (see m86pd_refresh()),
+ * and of its entry if set (see m86pd_resume()), which decides what is
+ * reachable.
+ *
+ * Returns: N/A.
+ */
+void m86cache_key(
+        char *key,
+        const m86_predecoded_program *program,
+        const unsigned int mem_size,
+        const unsigned int format)
+{
+    unsigned long long hash = 0xcbf29ce484222325ULL;
+    const char *version = M86_VERSION_NUM;
+    unsigned int i;
+    for (; *version != '\0'; version++)
+        hash = m86cache_hash(hash, (unsigned char) *version);
+    hash = m86cache_hash(hash, format);
+    hash = m86cache_hash(hash, mem_size);
+    hash = m86cache_hash(hash, program->size);
+    for (i = 0; i < program->size; i++)
+        hash = m86cache_hash(hash, program->code[i].word);
+    if (program->entry != 0)
+        hash = m86cache_hash(hash, program->entry);
+    sprintf(key, "%016llx", hash);
+    return;
+}
+
+/* m86cache_checksum: return the 64-bit FNV-1a hash of a block of
+ * bytes, used to check that the contents of cache files are intact.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to block of bytes.
+ * # size in bytes of block.
+ *
+ * Returns: unsigned long long value for hash of block.
+ */
+unsigned long long m86cache_checksum(
+        const void *data,
+        const size_t size)
+{
+    const unsigned char *bytes = data;
+    unsigned long long hash = 0xcbf29ce484222325ULL;
+    size_t i;
+    for (i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+/* Write the path of the cache directory into dir, creating it if
+ * needed; return false if there is none.
+ */
+static bool m86cache_dir(char *dir)
+{
+#if defined(__unix__)
+    const char *env;
+    int length;
+    char *slash;
+    if ((env = getenv("M86_CACHE_DIR")) != NULL)
+        length = snprintf(dir, M86CACHE_PATH_SIZE, "%s", env);
+    else if ((env = getenv("XDG_CACHE_HOME")) != NULL)
+        length = snprintf(dir, M86CACHE_PATH_SIZE, "%s/micro86", env);
+    else if ((env = getenv("HOME")) != NULL)
+        length = snprintf(dir, M86CACHE_PATH_SIZE,
+                "%s/.cache/micro86", env);
+    else return false;
+    if ((length <= 0) || (length >= M86CACHE_PATH_SIZE)) return false;
+    for (slash = strchr(dir + 1, '/'); slash != NULL;
+            slash = strchr(slash + 1, '/'))
+    {
+        *slash = '\0';
+        mkdir(dir, 0700);
+        *slash = '/';
+    }
+    mkdir(dir, 0700);
+    return access(dir, W_OK | X_OK) == 0;
+#else
+    (void) dir;
+    return false;
+#endif
+}
+
+/* m86cache_path: write the path of a cache file into string, creating
+ * the cache directory if needed.
+ *
+ * Parameters (in order):
+ *
+ * # string of at least M86CACHE_PATH_SIZE characters.
+ * # string for cache key (see m86cache_key()).
+ * # string for file name suffix (e.g., ".so").
+ *
+ * Returns: bool value to indicate whether there is a usable cache
+ * directory; true = path written, false = no cache.
+ */
+bool m86cache_path(
+        char *path,
+        const char *key,
+        const char *suffix)
+{
+    char dir[M86CACHE_PATH_SIZE];
+    if (!m86cache_dir(dir)) return false;
+    return snprintf(path, M86CACHE_PATH_SIZE, "%s/%s%s",
+            dir, key, suffix) < M86CACHE_PATH_SIZE;
+}
+
+/* m86cache_temp_path: write a temporary path, unique to the calling
+ * process, next to a cache file.
+ *
+ * Parameters (in order):
+ *
+ * # string of at least M86CACHE_PATH_SIZE characters.
+ * # string for path of cache file (see m86cache_path()).
+ * # string for file name suffix.
+ *
+ * Note: cache files are to be written under a temporary path and
+ * renamed into place with rename(), so that other processes never see
+ * partly written ones.
+ *
+ * Returns: bool value to indicate status; true = path written, false =
+ * path too long.
+ */
+bool m86cache_temp_path(
+        char *temp,
+        const char *path,
+        const char *suffix)
+{
+#if defined(__unix__)
+    long pid = (long) getpid();
+#else
+    long pid = 0;
+#endif
+    return snprintf(temp, M86CACHE_PATH_SIZE, "%s.%ld%s",
+            path, pid, suffix) < M86CACHE_PATH_SIZE;
+}
+
+/* EOF. */
@@ -0,0 +1,116 @@
+/* micro86_cache:
+ *
+ * On-disk cache of translated code for the micro86 emulator.
+ *
+ * Translating engines (see micro86_aot.h and micro86_jit.h) store what
+ * they produce in a cache directory, under a key that is a hash of the
+ * program image, the memory size, the emulator version and a version
+ * of the format of what is stored, so that later runs of the same
+ * image skip translation.
+ *
+ * The cache directory is the M86_CACHE_DIR environment variable if set
+ * (an empty value disables the cache), else "micro86" under
+ * XDG_CACHE_HOME or, failing that, under ".cache" in HOME.
+ *
+ * Note: on platforms other than Unix-like systems, there is no cache
+ * directory.
+ */
+
+#ifndef _STDBOOL_H
+#include <stdbool.h>
+#endif
+
+#ifndef MICRO86PREDECODE_H
+#include "micro86_predecode.h"
+#endif
+
+#ifndef MICRO86CACHE_H
+#define MICRO86CACHE_H
+
+/* M86CACHE_KEY_SIZE: size of a cache key in characters, including the
+ * terminating null character.
+ */
+#define M86CACHE_KEY_SIZE 17
+
+/* M86CACHE_PATH_SIZE: maximum size of a path in the cache directory
+ * in characters, including the terminating null character.
+ */
+#define M86CACHE_PATH_SIZE 4096
+
+/* m86cache_key: write the cache key of a program into string.
+ *
+ * Parameters (in order):
+ *
+ * # string of at least M86CACHE_KEY_SIZE characters.
+ * # pointer to m86_predecoded_program variable.
+ * # unsigned value for memory size.
+ * # unsigned value for version of the format of what is cached.
+ *
+ * Note: the key is a hash of the words of the records of the
+ * pre-decoded program, which must be up to date (see m86pd_refresh()),
+ * and of its entry if set (see m86pd_resume()), which decides what is
+ * reachable.
+ *
+ * Returns: N/A.
+ */
+void m86cache_key(
+        char*,
+        const m86_predecoded_program*,
+        const unsigned int,
+        const unsigned int);
+
+/* m86cache_checksum: return the 64-bit FNV-1a hash of a block of
+ * bytes, used to check that the contents of cache files are intact.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to block of bytes.
+ * # size in bytes of block.
+ *
+ * Returns: unsigned long long value for hash of block.
+ */
+unsigned long long m86cache_checksum(
+        const void*,
+        const size_t);
+
+/* m86cache_path: write the path of a cache file into string, creating
+ * the cache directory if needed.
+ *
+ * Parameters (in order):
+ *
+ * # string of at least M86CACHE_PATH_SIZE characters.
+ * # string for cache key (see m86cache_key()).
+ * # string for file name suffix (e.g., ".so").
+ *
+ * Returns: bool value to indicate whether there is a usable cache
+ * directory; true = path written, false = no cache.
+ */
+bool m86cache_path(
+        char*,
+        const char*,
+        const char*);
+
+/* m86cache_temp_path: write a temporary path, unique to the calling
+ * process, next to a cache file.
+ *
+ * Parameters (in order):
+ *
+ * # string of at least M86CACHE_PATH_SIZE characters.
+ * # string for path of cache file (see m86cache_path()).
+ * # string for file name suffix.
+ *
+ * Note: cache files are to be written under a temporary path and
+ * renamed into place with rename(), so that other processes never see
+ * partly written ones.
+ *
+ * Returns: bool value to indicate status; true = path written, false =
+ * path too long.
+ */
+bool m86cache_temp_path(
+        char*,
+        const char*,
+        const char*);
+
+#endif
+
+/* EOF. */
@@ -17,7 +17,7 @@
 #endif
 
 #ifndef MICRO86COMMON_H
-#define MICOR86COMMON_H
+#define MICRO86COMMON_H
 
 #define INSTRUCT_BASE 16
 #define INSTRUCT_NUM_DIGITS 8
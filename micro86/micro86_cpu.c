@@ -33,7 +33,9 @@ void m86_proc_init(micro86_proc *p)
     p->acc =
         p->ir =
         p->ip =
-        p->flags = DEF_REG_VAL;
+        p->flags =
+        p->cmp = DEF_REG_VAL;
+    p->lazy = false;
     return;
 }
 
@@ -194,7 +196,8 @@ void m86_set_ip_reg(
  */
 unsigned int m86_get_flags_reg(const micro86_proc p)
 {
-    return p.flags;
+    if (!p.lazy) return p.flags;
+    return (p.cmp == 0) ? 0x01 : ((p.cmp < 0) ? 0x02 : 0x00);
 }
 
 /* m86_get_flags_zb: return zero bit of value contained in flags
@@ -211,7 +214,7 @@ unsigned int m86_get_flags_reg(const micro86_proc p)
  */
 unsigned int m86_get_flags_zb(const micro86_proc p)
 {
-    return (p.flags & 0x01);
+    return (m86_get_flags_reg(p) & 0x01);
 }
 
 /* m86_set_flags_zb: set zero bit of value contained in flags
@@ -236,6 +239,8 @@ void m86_set_flags_zb(
         bool yes)
 {
     if (p == NULL) return;
+    p->flags = m86_get_flags_reg(*p);
+    p->lazy = false;
     p->flags = yes ? (p->flags | 0x01) : (p->flags & 0x02);
     return;
 }
@@ -254,7 +259,7 @@ void m86_set_flags_zb(
  */
 unsigned int m86_get_flags_sb(const micro86_proc p)
 {
-    return (p.flags >> 1);
+    return (m86_get_flags_reg(p) >> 1);
 }
 
 /* m86_set_flags_sb: set sign bit of value contained in flags
@@ -279,10 +284,60 @@ void m86_set_flags_sb(
         bool yes)
 {
     if (p == NULL) return;
+    p->flags = m86_get_flags_reg(*p);
+    p->lazy = false;
     p->flags = yes ? (p->flags | 0x02) : (p->flags & 0x01);
     return;
 }
 
+/* m86_get_flags_cmp: return a comparison result that sets the flags
+ * register to the value it contains.
+ *
+ * Parameters (in order):
+ *
+ * # micro86_proc variable.
+ *
+ * Note: this is the result of the latest comparison, unless either
+ * bit has been set on its own since, in which case it is 0 if the
+ * zero bit is set, -1 if the sign bit is set and 1 if neither is.
+ *
+ * Returns: value of comparison result.
+ */
+int m86_get_flags_cmp(const micro86_proc p)
+{
+    if (p.lazy) return p.cmp;
+    if (p.flags & 0x01) return 0;
+    return (p.flags & 0x02) ? -1 : 1;
+}
+
+/* m86_set_flags_cmp: set zero and sign bits of value contained in
+ * flags register from a comparison result.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to micro86_proc variable.
+ * # value of comparison result (i.e., the difference between the
+ * values compared).
+ *
+ * Note: passing NULL for micro86_proc variable parameter results in
+ * no operation being performed.
+ *
+ * Note: the zero bit is set to ZERO_BIT_TRUE if the result is zero
+ * and the sign bit to SIGN_BIT_TRUE if it is negative; both bits are
+ * only worked out when read.
+ *
+ * Returns: N/A.
+ */
+void m86_set_flags_cmp(
+        micro86_proc *p,
+        const int cmp)
+{
+    if (p == NULL) return;
+    p->cmp = cmp;
+    p->lazy = true;
+    return;
+}
+
 /* m86_print_proc: print processor (i.e., registers and their values)
  * to specified file stream.
  *
@@ -310,7 +365,7 @@ void m86_print_proc(
             " ip: 0x%08X"
             " flags: 0x%08X"
             " (ir: 0x%08X)\n",
-            p.acc, p.ip, p.flags, p.ir);
+            p.acc, p.ip, m86_get_flags_reg(p), p.ir);
     return;
 }
 
@@ -0,0 +1,348 @@
+/* micro86_engine:
+ *
+ * Switch-based FDE cycle for the micro86 emulator, specialised at
+ * compile time: micro86_machine.c includes this file once per
+ * combination of policies, with the following macros defined
+ * beforehand.
+ *
+ * # M86E_NAME: name of the (static) function to define.
+ * # M86E_TRACE: trace policy; 1 = print the execution trace, 0 = do
+ * not trace.
+ * # M86E_CHECKED: bounds policy; 1 = check jump targets against the
+ * end of the program, 0 = rely on the program being verified (see
+ * m86pd_verify()) and return as soon as it stops being verified.
+ *
+ * Each instantiation keeps registers in locals and indexes memory
+ * directly, so policy tests are resolved by the preprocessor rather
+ * than on every instruction. Registers are written back to the cpu
+ * before printing the trace and on stopping; errors are reported
+ * through the same functions execute() uses.
+ *
+ * Memory operands are not checked against memory bounds under either
+ * policy: records whose operand lies beyond them are trapped when
+ * decoded (see m86pd_verify()) and reported on being reached, as
+ * invalid instructions are.
+ *
+ * Instruction budgets are charged once per basic block, with the run
+ * of the record a block is entered at (see micro86_predecode.h), so
+ * the loop itself does not count instructions. If what is left of the
+ * budget does not cover the next block, the function returns and
+ * leaves the remaining instructions to be stepped through one at a
+ * time by the caller.
+ *
+ * Divisions by divisors known when decoding run as multiplications by
+ * their reciprocals (see micro86_predecode.h), with no check for zero.
+ *
+ * Untraced instantiations run recognised loops as loop kernels (see
+ * micro86_loop.h) whenever they jump to their heads; kernels charge the
+ * budget for the iterations they run.
+ *
+ * The function defined has the following parameters (in order):
+ *
+ * # pointer to micro86_machine variable (the execution trace, if any,
+ * goes to its trace stream).
+ * # pointer to unsigned long variable for the number of instructions
+ * left to execute, which is decremented accordingly.
+ *
+ * and returns the stop reason (M86_STOP_NONE if the program stopped
+ * being verified or the budget does not cover the next block).
+ *
+ * WARNING: this file has no include guard and expects to be included
+ * by micro86_machine.c only, after the static helpers it uses are
+ * defined. The policy macros are undefined at the end of this file.
+ */
+
+#if !defined(M86E_NAME) || !defined(M86E_TRACE) || \
+    !defined(M86E_CHECKED)
+#error "micro86_engine.h: policy macros must be defined."
+#endif
+
+static unsigned int M86E_NAME(
+        micro86_machine *m,
+        unsigned long *budget)
+{
+    micro86_proc *micro86_cpu = &m->cpu;
+    memory *micro86_memory = &m->mem;
+    const unsigned int mem_size = m->mem_size;
+    m86_predecoded_program *program = &m->program;
+    unsigned long steps = *budget;
+    int *mem = *micro86_memory,
+        acc = m86_get_acc_reg(*micro86_cpu),
+        cmp = m86_get_flags_cmp(*micro86_cpu),
+        value;
+    unsigned int ip = m86_get_ip_reg(*micro86_cpu),
+                 ir = m86_get_ir_reg(*micro86_cpu),
+                 end = ip,
+                 run;
+    const m86_predecoded_instruct *di;
+#if !M86E_TRACE
+    m86_loop_state loop;
+#endif
+
+/* Return the record at position pos. */
+#if M86E_CHECKED
+#define RECORD(pos) \
+    (program->code + (((pos) < program->size) ? (pos) : program->size))
+#else
+#define RECORD(pos) (program->code + (pos))
+#endif
+
+/* Write registers and the number of instructions left back. */
+#define SYNC() \
+    do { \
+        m86_store_regs(micro86_cpu, acc, cmp, ip, ir); \
+        *budget = steps; \
+    } while (0)
+
+/* Charge the block entered at ip to the budget, up to position end,
+ * or return if the budget does not cover it. */
+#define CHARGE() \
+    do { \
+        run = RECORD(ip)->run; \
+        if (steps < run) \
+        { \
+            SYNC(); \
+            return M86_STOP_NONE; \
+        } \
+        steps -= run; \
+        end = ip + run; \
+    } while (0)
+
+/* Give back the part of the block charged but not run yet. */
+#define REFUND() steps += end - ip
+
+/* Run whole iterations of the loop headed by the record at ip, if
+ * any, as a loop kernel (see micro86_loop.h); loops are not run as a
+ * whole when tracing. */
+#if M86E_TRACE
+#define LOOP()
+#else
+#define LOOP() \
+    if (RECORD(ip)->loop != 0) \
+    { \
+        loop.acc = acc; \
+        loop.cmp = cmp; \
+        loop.ip = ip; \
+        loop.last = di - program->code; \
+        steps = m86lp_run(&m->loops, program, mem, &loop, steps); \
+        acc = loop.acc; \
+        cmp = loop.cmp; \
+        ip = loop.ip; \
+        ir = RECORD(loop.last)->word; \
+        LOOP_VERIFIED(); \
+    }
+#endif
+
+/* Return if the program stopped being verified. */
+#if M86E_CHECKED
+#define LOOP_VERIFIED()
+#else
+#define LOOP_VERIFIED() \
+    if (!program->verified) \
+    { \
+        SYNC(); \
+        return M86_STOP_NONE; \
+    }
+#endif
+
+/* Jump to the operand of the current record if condition holds, and
+ * enter the next block either way. */
+#define JUMP_IF(condition) \
+    do { \
+        if (condition) \
+        { \
+            ip = di->operand; \
+            LOOP(); \
+        } \
+        CHARGE(); \
+    } while (0)
+
+#if !M86E_CHECKED
+    if (!program->verified) return M86_STOP_NONE;
+#endif
+    CHARGE();
+    while (true)
+    {
+        di = RECORD(ip);
+        if (di->handler == M86PD_END)
+        {
+            if (ip < program->size)
+            {
+                /* Reached the breakpoint (see m86pd_break()). */
+                REFUND();
+                SYNC();
+                return M86_STOP_BREAK;
+            }
+            /* Ran past the end of the program; fetch() reports it. */
+            SYNC();
+            fetch(m);
+            return M86_STOP_ERROR;
+        }
+        ip++;
+        ir = di->word;
+#if M86E_TRACE
+        SYNC();
+        if (m86_print_trace(m->trace, *micro86_cpu, *micro86_memory,
+                    mem_size, m->error_code))
+            return M86_STOP_ERROR;
+#endif
+        switch (di->handler)
+        {
+            case M86PD_HALT:
+                SYNC();
+                return M86_STOP_HALTED;
+            case M86PD_LOAD:
+                acc = mem[di->operand];
+                break;
+            case M86PD_LOADI:
+                acc = di->operand;
+                break;
+            case M86PD_STORE:
+                mem[di->operand] = acc;
+                break;
+            case M86PD_STORE_CODE:
+                mem[di->operand] = acc;
+                m86pd_update(program, di->operand, acc);
+#if !M86E_CHECKED
+                if (!program->verified)
+                {
+                    REFUND();
+                    SYNC();
+                    return M86_STOP_NONE;
+                }
+#endif
+                if (((unsigned) di->operand >= ip) &&
+                        ((unsigned) di->operand < end))
+                {
+                    /* The rest of the block changed; charge it anew. */
+                    REFUND();
+                    CHARGE();
+                }
+                break;
+            case M86PD_ADD:
+                acc += mem[di->operand];
+                break;
+            case M86PD_ADDI:
+                acc += di->operand;
+                break;
+            case M86PD_SUB:
+                acc -= mem[di->operand];
+                break;
+            case M86PD_SUBI:
+                acc -= di->operand;
+                break;
+            case M86PD_MUL:
+                acc *= mem[di->operand];
+                break;
+            case M86PD_MULI:
+                acc *= di->operand;
+                break;
+            case M86PD_DIV:
+            case M86PD_MOD:
+                if (di->reciprocal != 0)
+                {
+                    value = M86PD_QUOTIENT(di, acc);
+                    if (di->handler == M86PD_DIV) acc = value;
+                    else acc -= value * mem[di->operand];
+                    break;
+                }
+                value = mem[di->operand];
+                if (value == 0)
+                {
+                    SYNC();
+                    m86_check_zero_div_error(value, STD_ERR_DEST,
+                            m->error_code, *micro86_cpu,
+                            *micro86_memory, mem_size);
+                    return M86_STOP_ERROR;
+                }
+                if (di->handler == M86PD_DIV) acc /= value;
+                else acc %= value;
+                break;
+            case M86PD_DIVI:
+            case M86PD_MODI:
+                if (di->reciprocal != 0)
+                {
+                    value = M86PD_QUOTIENT(di, acc);
+                    if (di->handler == M86PD_DIVI) acc = value;
+                    else acc -= value * di->operand;
+                    break;
+                }
+                if (di->operand == 0)
+                {
+                    SYNC();
+                    m86_check_zero_div_error(di->operand, STD_ERR_DEST,
+                            m->error_code, *micro86_cpu,
+                            *micro86_memory, mem_size);
+                    return M86_STOP_ERROR;
+                }
+                if (di->handler == M86PD_DIVI) acc /= di->operand;
+                else acc %= di->operand;
+                break;
+            case M86PD_CMP:
+                cmp = acc - mem[di->operand];
+                break;
+            case M86PD_CMPI:
+                cmp = acc - di->operand;
+                break;
+            case M86PD_JMPI:
+                JUMP_IF(true);
+                break;
+            case M86PD_JEI:
+                JUMP_IF(cmp == 0);
+                break;
+            case M86PD_JNEI:
+                JUMP_IF(cmp != 0);
+                break;
+            case M86PD_JLI:
+                JUMP_IF(cmp < 0);
+                break;
+            case M86PD_JLEI:
+                JUMP_IF(cmp <= 0);
+                break;
+            case M86PD_JGI:
+                JUMP_IF(cmp > 0);
+                break;
+            case M86PD_JGEI:
+                JUMP_IF(cmp >= 0);
+                break;
+            case M86PD_IN:
+                if ((value = m86_read_input(m)) == M86_NO_INPUT)
+                {
+                    /* Wait on the IN instruction itself. */
+                    ip--;
+                    REFUND();
+                    SYNC();
+                    return M86_STOP_INPUT;
+                }
+                if (value == EOF)
+                {
+                    SYNC();
+                    m86_input_error(m);
+                    return M86_STOP_ERROR;
+                }
+                acc = (unsigned char) value;
+                break;
+            case M86PD_OUT:
+                m86_write_output(m, (unsigned char) acc);
+                break;
+            default:
+                SYNC();
+                m86_invalid_error(m, di);
+                return M86_STOP_ERROR;
+        }
+    }
+
+#undef RECORD
+#undef SYNC
+#undef CHARGE
+#undef REFUND
+#undef LOOP
+#undef LOOP_VERIFIED
+#undef JUMP_IF
+}
+
+#undef M86E_NAME
+#undef M86E_TRACE
+#undef M86E_CHECKED
+
+/* EOF. */
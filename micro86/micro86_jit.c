@@ -0,0 +1,1465 @@
+/* micro86_jit:
+ *
+ * Just-in-time compiler from pre-decoded micro86 basic blocks to native
+ * x86-64 code.
+ *
+ * Register usage of translated code: ebx holds the accumulator, r12
+ * the memory base, r13 the m86_jit_state pointer and r14d the result of
+ * the latest comparison (zero and sign bits are derived from it only
+ * when leaving a block). Memory operands are static, so they are
+ * checked against memory bounds at translation time; STOREs into the
+ * code region check at run time whether the memory unit they modify
+ * has been translated.
+ */
+
+#ifndef _STDIO_H
+#include <stdio.h>
+#endif
+
+#ifndef _STDLIB_H
+#include <stdlib.h>
+#endif
+
+#ifndef _STRING_H
+#include <string.h>
+#endif
+
+#ifndef MICRO86_H
+#include "micro86.h"
+#endif
+
+#ifndef MICRO86CACHE_H
+#include "micro86_cache.h"
+#endif
+
+#ifndef MICRO86JIT_H
+#include "micro86_jit.h"
+#endif
+
+#if M86_HAVE_JIT
+
+#ifndef _SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+
+/* M86JIT_MAX_INSTRUCT_BYTES: upper bound on the size of the code
+ * translated for a single instruction, including its exit stubs.
+ */
+#define M86JIT_MAX_INSTRUCT_BYTES 128
+
+/* M86JIT_BLOCK_OVERHEAD: upper bound on the size of the prologue,
+ * epilogue, register loads, final exit stub and stale stub of a
+ * block.
+ */
+#define M86JIT_BLOCK_OVERHEAD 192
+
+/* Translated code relies on these field offsets of m86_jit_state.
+ */
+typedef char m86jit_state_layout_check[
+    ((offsetof(m86_jit_state, acc) == 0) &&
+     (offsetof(m86_jit_state, flags) == 4) &&
+     (offsetof(m86_jit_state, ip) == 8) &&
+     (offsetof(m86_jit_state, ir) == 12) &&
+     (offsetof(m86_jit_state, mem) == 16) &&
+     (offsetof(m86_jit_state, interpret) == 24) &&
+     (offsetof(m86_jit_state, covered) == 32)) ? 1 : -1];
+
+/* Marks positions of the code region left to the interpreter.
+ */
+static char m86jit_none;
+
+/* Emit a byte.
+ */
+static void emit8(
+        m86_jit *jit,
+        const unsigned char byte)
+{
+    jit->buffer[jit->used++] = byte;
+    return;
+}
+
+/* Emit a sequence of bytes.
+ */
+static void emit(
+        m86_jit *jit,
+        const unsigned char *bytes,
+        const size_t count)
+{
+    memcpy(jit->buffer + jit->used, bytes, count);
+    jit->used += count;
+    return;
+}
+
+/* Emit a 32-bit little-endian value.
+ */
+static void emit32(
+        m86_jit *jit,
+        const int value)
+{
+    unsigned int v = (unsigned int) value;
+    emit8(jit, v & 0xFF);
+    emit8(jit, (v >> 8) & 0xFF);
+    emit8(jit, (v >> 16) & 0xFF);
+    emit8(jit, (v >> 24) & 0xFF);
+    return;
+}
+
+/* Emit an instruction with a register operand (reg) and a register or
+ * memory operand: register rm if rm is not negative, otherwise the
+ * memory unit at specified position ([r12 + position * 4]).
+ */
+static void emit_operand(
+        m86_jit *jit,
+        const unsigned char *opcode,
+        const size_t count,
+        const int reg,
+        const int rm,
+        const int pos)
+{
+    unsigned char rex = 0x40 | ((reg & 8) ? 0x04 : 0);
+    if (rm < 0)
+    {
+        emit8(jit, rex | 0x01);     /* r12 base */
+        emit(jit, opcode, count);
+        emit8(jit, 0x84 | ((reg & 7) << 3));
+        emit8(jit, 0x24);
+        emit32(jit, pos * (int) sizeof(int));
+        return;
+    }
+    rex |= ((rm & 8) ? 0x01 : 0);
+    if (rex != 0x40) emit8(jit, rex);
+    emit(jit, opcode, count);
+    emit8(jit, 0xc0 | ((reg & 7) << 3) | (rm & 7));
+    return;
+}
+
+/* Emit the block epilogue: store accumulator and flags, restore
+ * callee-saved registers and return.
+ */
+static void emit_epilogue(m86_jit *jit)
+{
+    static const unsigned char code[] =
+    {
+        0x41, 0x89, 0x5d, 0x00,     /* mov [r13], ebx */
+        0x31, 0xc0,                 /* xor eax, eax */
+        0x31, 0xc9,                 /* xor ecx, ecx */
+        0x45, 0x85, 0xf6,           /* test r14d, r14d */
+        0x0f, 0x94, 0xc0,           /* sete al */
+        0x0f, 0x9c, 0xc1,           /* setl cl */
+        0x8d, 0x04, 0x48,           /* lea eax, [rax + rcx * 2] */
+        0x41, 0x89, 0x45, 0x04,     /* mov [r13 + 4], eax */
+        0x41, 0x5e,                 /* pop r14 */
+        0x41, 0x5d,                 /* pop r13 */
+        0x41, 0x5c,                 /* pop r12 */
+        0x5b,                       /* pop rbx */
+        0xc3                        /* ret */
+    };
+    emit(jit, code, sizeof(code));
+    return;
+}
+
+/* Block prologue: save callee-saved registers and load the state into
+ * registers, turning the zero and sign bits into a representative
+ * comparison result (0, -1 or 1).
+ */
+static const unsigned char m86jit_prologue[] =
+{
+    0x53,                       /* push rbx */
+    0x41, 0x54,                 /* push r12 */
+    0x41, 0x55,                 /* push r13 */
+    0x41, 0x56,                 /* push r14 */
+    0x49, 0x89, 0xfd,           /* mov r13, rdi */
+    0x41, 0x8b, 0x5d, 0x00,     /* mov ebx, [r13] */
+    0x4d, 0x8b, 0x65, 0x10,     /* mov r12, [r13 + 16] */
+    0x41, 0x8b, 0x45, 0x04,     /* mov eax, [r13 + 4] */
+    0x45, 0x31, 0xf6,           /* xor r14d, r14d */
+    0xa8, 0x01,                 /* test al, 1 */
+    0x75, 0x10,                 /* jnz +16 */
+    0x41, 0xbe, 0x01, 0x00,
+    0x00, 0x00,                 /* mov r14d, 1 */
+    0xa8, 0x02,                 /* test al, 2 */
+    0x74, 0x06,                 /* jz +6 */
+    0x41, 0xbe, 0xff, 0xff,
+    0xff, 0xff                  /* mov r14d, -1 */
+};
+
+/* Emit the block prologue (see m86jit_prologue).
+ */
+static void emit_prologue(m86_jit *jit)
+{
+    emit(jit, m86jit_prologue, sizeof(m86jit_prologue));
+    return;
+}
+
+/* Return size in bytes of an exit stub.
+ */
+static size_t exit_size(
+        const bool set_ir,
+        const bool interpret)
+{
+    return 8 + (set_ir ? 8 : 0) + (interpret ? 8 : 0) + 5;
+}
+
+/* Emit an exit stub: set instruction pointer (and, optionally,
+ * instruction register and interpret flag) and jump to the epilogue
+ * at specified buffer offset.
+ */
+static void emit_exit(
+        m86_jit *jit,
+        const size_t epilogue,
+        const unsigned int ip,
+        const bool set_ir,
+        const int ir,
+        const bool interpret)
+{
+    static const unsigned char
+           set_ip_code[] = { 0x41, 0xc7, 0x45, 0x08 },
+           set_ir_code[] = { 0x41, 0xc7, 0x45, 0x0c },
+           set_interpret_code[] = { 0x41, 0xc7, 0x45, 0x18 };
+    emit(jit, set_ip_code, sizeof(set_ip_code));
+    emit32(jit, (int) ip);
+    if (set_ir)
+    {
+        emit(jit, set_ir_code, sizeof(set_ir_code));
+        emit32(jit, ir);
+    }
+    if (interpret)
+    {
+        emit(jit, set_interpret_code, sizeof(set_interpret_code));
+        emit32(jit, 1);
+    }
+    emit8(jit, 0xe9);               /* jmp epilogue */
+    emit32(jit, (int) epilogue - (int) (jit->used + 4));
+    return;
+}
+
+/* Return size in bytes of a link stub.
+ */
+static size_t link_size(const bool set_ir)
+{
+    return (set_ir ? 8 : 0) + 5 + exit_size(false, false);
+}
+
+/* Emit a link stub for a jump (or fall-through) from specified
+ * position: set instruction register (optionally) and jump to the
+ * block at specified target position. The jump initially falls through
+ * to an exit stub, and is patched once the target block has been
+ * translated (and, for backward jumps, has become hot).
+ */
+static void emit_link(
+        m86_jit *jit,
+        const size_t epilogue,
+        const unsigned int from,
+        const unsigned int target,
+        const bool set_ir,
+        const int ir)
+{
+    static const unsigned char
+           set_ir_code[] = { 0x41, 0xc7, 0x45, 0x0c };
+    if (set_ir)
+    {
+        emit(jit, set_ir_code, sizeof(set_ir_code));
+        emit32(jit, ir);
+    }
+    emit8(jit, 0xe9);               /* jmp exit stub (patched later) */
+    size_t site = jit->used;
+    emit32(jit, 0);
+    emit_exit(jit, epilogue, target, false, 0, false);
+    if (target >= jit->program_size) return;
+    if (jit->num_links == jit->max_links)
+    {
+        unsigned int max = jit->max_links ? 2 * jit->max_links : 256;
+        m86_jit_link *links = realloc(jit->links,
+                max * sizeof(m86_jit_link));
+        if (links == NULL) return;  /* stays unchained */
+        jit->links = links;
+        jit->max_links = max;
+    }
+    m86_jit_link *link = jit->links + jit->num_links++;
+    link->site = site;
+    link->backward = (target <= from);
+    link->next = jit->blocks[target].links;
+    jit->blocks[target].links = jit->num_links;
+    return;
+}
+
+/* Patch a jump at specified buffer offset of its displacement to go to
+ * specified buffer offset.
+ */
+static void patch(
+        m86_jit *jit,
+        const size_t site,
+        const size_t target)
+{
+    unsigned int rel = (unsigned int) (target - (site + 4));
+    jit->buffer[site] = rel & 0xFF;
+    jit->buffer[site + 1] = (rel >> 8) & 0xFF;
+    jit->buffer[site + 2] = (rel >> 16) & 0xFF;
+    jit->buffer[site + 3] = (rel >> 24) & 0xFF;
+    return;
+}
+
+/* Chain links to the block at specified position to its body; while
+ * the block is not hot yet, backward jumps are left unchained so that
+ * they keep going through m86jit_get(), which counts them.
+ */
+static void chain(
+        m86_jit *jit,
+        const unsigned int pos)
+{
+    const m86_jit_block_info *info = jit->blocks + pos;
+    bool hot = (info->hits >= M86JIT_HOT_THRESHOLD);
+    unsigned int i;
+    for (i = info->links; i != 0; i = jit->links[i - 1].next)
+        if (hot || !jit->links[i - 1].backward)
+            patch(jit, jit->links[i - 1].site, info->body);
+    return;
+}
+
+/* Return handler of specified pre-decoded instruction, counting
+ * STOREs into the code region as M86PD_STORE_CODE even where the
+ * memory unit they store into was not reachable when decoding them
+ * (see m86pd_init()), since translated blocks outlive such records.
+ */
+static unsigned int handler_of(
+        const m86_jit *jit,
+        const m86_predecoded_instruct *di)
+{
+    if ((di->handler == M86PD_STORE) &&
+            ((unsigned) di->operand < jit->program_size))
+        return M86PD_STORE_CODE;
+    return di->handler;
+}
+
+/* Return true if instruction with specified memory operand position
+ * can be translated.
+ */
+static bool mem_ok(
+        const m86_jit *jit,
+        const int pos)
+{
+    return ((pos >= 0) && ((unsigned) pos < jit->mem_size));
+}
+
+/* Return true if specified pre-decoded instruction can be translated.
+ */
+static bool translatable(
+        const m86_jit *jit,
+        const m86_predecoded_instruct *di)
+{
+    switch (di->handler)
+    {
+        case M86PD_LOAD:
+        case M86PD_STORE:
+        case M86PD_STORE_CODE:
+        case M86PD_ADD:
+        case M86PD_SUB:
+        case M86PD_MUL:
+        case M86PD_DIV:
+        case M86PD_MOD:
+        case M86PD_CMP:     return mem_ok(jit, di->operand);
+        case M86PD_DIVI:
+        case M86PD_MODI:    return (di->operand != 0);
+        case M86PD_LOADI:
+        case M86PD_ADDI:
+        case M86PD_SUBI:
+        case M86PD_MULI:
+        case M86PD_CMPI:
+        case M86PD_JMPI:
+        case M86PD_JEI:
+        case M86PD_JNEI:
+        case M86PD_JLI:
+        case M86PD_JLEI:
+        case M86PD_JGI:
+        case M86PD_JGEI:    return true;
+        default:            break;
+    }
+    return false;
+}
+
+/* Return short conditional jump opcode taken when the condition of
+ * specified conditional jump handler holds for the comparison result.
+ */
+static unsigned char jcc_short(const unsigned int handler)
+{
+    switch (handler)
+    {
+        case M86PD_JEI:     return 0x74;    /* je */
+        case M86PD_JNEI:    return 0x75;    /* jne */
+        case M86PD_JLI:     return 0x7c;    /* jl */
+        case M86PD_JLEI:    return 0x7e;    /* jle */
+        case M86PD_JGI:     return 0x7f;    /* jg */
+        default:            break;
+    }
+    return 0x7d;                            /* jge */
+}
+
+/* Emit a division (or modulo) of the accumulator by ecx.
+ */
+static void emit_divide(
+        m86_jit *jit,
+        const bool modulo)
+{
+    static const unsigned char code[] =
+    {
+        0x89, 0xd8,                 /* mov eax, ebx */
+        0x99,                       /* cdq */
+        0xf7, 0xf9                  /* idiv ecx */
+    },
+    quotient[] = { 0x89, 0xc3 },    /* mov ebx, eax */
+    remainder[] = { 0x89, 0xd3 };   /* mov ebx, edx */
+    emit(jit, code, sizeof(code));
+    if (modulo) emit(jit, remainder, sizeof(remainder));
+    else emit(jit, quotient, sizeof(quotient));
+    return;
+}
+
+/* Emit a division (or modulo) of the accumulator by the divisor of
+ * specified record, which holds a reciprocal (see M86PD_QUOTIENT()).
+ */
+static void emit_reciprocal(
+        m86_jit *jit,
+        const m86_predecoded_instruct *di,
+        const bool modulo)
+{
+    static const unsigned char load[] =
+    {
+        0x48, 0x63, 0xc3,           /* movsxd rax, ebx */
+        0x48, 0xba                  /* mov rdx, imm64 */
+    },
+    multiply[] =
+    {
+        0x48, 0x0f, 0xaf, 0xc2,     /* imul rax, rdx */
+        0x48, 0x89, 0xc2,           /* mov rdx, rax */
+        0x48, 0xc1, 0xea, 0x3f,     /* shr rdx, 63 */
+        0x48, 0xc1, 0xf8            /* sar rax, imm8 */
+    },
+    round[] = { 0x01, 0xd0 },       /* add eax, edx */
+    quotient[] = { 0x89, 0xc3 },    /* mov ebx, eax */
+    remainder[] = { 0x29, 0xc3 };   /* sub ebx, eax */
+    emit(jit, load, sizeof(load));
+    emit32(jit, (int) di->reciprocal);
+    emit32(jit, (int) (di->reciprocal >> 32));
+    emit(jit, multiply, sizeof(multiply));
+    emit8(jit, (unsigned char) di->shift);
+    emit(jit, round, sizeof(round));
+    if (modulo)
+    {
+        emit8(jit, 0x69);           /* imul eax, eax, imm32 */
+        emit8(jit, 0xc0);
+        emit32(jit, di->operand);
+        emit(jit, remainder, sizeof(remainder));
+    } else emit(jit, quotient, sizeof(quotient));
+    return;
+}
+
+/* Type: m86jit_context.
+ *
+ * What translate() needs to know about the code being translated:
+ *
+ * # epilogue: buffer offset of the epilogue.
+ * # top: buffer offset of the top of the loop (traces only).
+ * # start: starting position.
+ * # end: position of the jump closing the loop (traces only).
+ * # trace: whether a trace (as opposed to a block) is translated.
+ * # set_ir: whether jumps back to the top must set the instruction
+ * register (i.e., the first instruction of the trace may exit).
+ * # cells: number of memory units kept in registers.
+ * # cell_pos: position of each memory unit kept in a register.
+ * # dirty: whether each memory unit kept in a register is stored into.
+ */
+typedef struct
+{
+    size_t epilogue,
+           top;
+    unsigned int start,
+                 end;
+    bool trace,
+         set_ir;
+    unsigned int cells;
+    int cell_pos[M86JIT_NUM_CELL_REGS];
+    bool dirty[M86JIT_NUM_CELL_REGS];
+} m86jit_context;
+
+/* Registers keeping memory units in traces: esi, edi and r8d-r11d. */
+static const int m86jit_cell_regs[M86JIT_NUM_CELL_REGS] =
+    { 6, 7, 8, 9, 10, 11 };
+
+/* Return register keeping memory unit at specified position, or -1 if
+ * it is not kept in a register.
+ */
+static int cell_reg(
+        const m86jit_context *ctx,
+        const int pos)
+{
+    unsigned int i;
+    for (i = 0; i < ctx->cells; i++)
+        if (ctx->cell_pos[i] == pos) return m86jit_cell_regs[i];
+    return -1;
+}
+
+/* Return size in bytes of the code writing registers back to the
+ * memory units they keep.
+ */
+static size_t spill_size(const m86jit_context *ctx)
+{
+    size_t size = 0;
+    unsigned int i;
+    for (i = 0; i < ctx->cells; i++) if (ctx->dirty[i]) size += 8;
+    return size;
+}
+
+/* Emit code writing registers back to the memory units they keep, so
+ * that memory is up to date whenever translated code is left.
+ */
+static void emit_spill(
+        m86_jit *jit,
+        const m86jit_context *ctx)
+{
+    static const unsigned char mov_to[] = { 0x89 };
+    unsigned int i;
+    for (i = 0; i < ctx->cells; i++)
+        if (ctx->dirty[i])
+            emit_operand(jit, mov_to, sizeof(mov_to),
+                    m86jit_cell_regs[i], -1, ctx->cell_pos[i]);
+    return;
+}
+
+/* Emit a jump back to the top of the loop of a trace.
+ */
+static void emit_loop(
+        m86_jit *jit,
+        const m86jit_context *ctx,
+        const int ir)
+{
+    static const unsigned char
+           set_ir_code[] = { 0x41, 0xc7, 0x45, 0x0c };
+    if (ctx->set_ir)
+    {
+        emit(jit, set_ir_code, sizeof(set_ir_code));
+        emit32(jit, ir);
+    }
+    emit8(jit, 0xe9);               /* jmp top */
+    emit32(jit, (int) ctx->top - (int) (jit->used + 4));
+    return;
+}
+
+/* Return size in bytes of a jump back to the top of the loop.
+ */
+static size_t loop_size(const m86jit_context *ctx)
+{
+    return (ctx->set_ir ? 8 : 0) + 5;
+}
+
+/* Emit an exit to the interpreter at specified position.
+ */
+static void exit_to(
+        m86_jit *jit,
+        const m86jit_context *ctx,
+        const unsigned int pos,
+        const bool executed,
+        const int last_ir)
+{
+    emit_spill(jit, ctx);
+    emit_exit(jit, ctx->epilogue, pos, executed, last_ir, true);
+    return;
+}
+
+/* Emit a link from specified position to specified target position.
+ */
+static void link_to(
+        m86_jit *jit,
+        const m86jit_context *ctx,
+        const unsigned int from,
+        const unsigned int target,
+        const int ir)
+{
+    emit_spill(jit, ctx);
+    emit_link(jit, ctx->epilogue, from, target, true, ir);
+    return;
+}
+
+/* Translate the instruction at specified position; return true if it
+ * ends the block (or trace).
+ */
+static bool translate_instruct(
+        m86_jit *jit,
+        const m86jit_context *ctx,
+        const m86_predecoded_instruct *di,
+        const unsigned int pos)
+{
+    static const unsigned char load[] = { 0x8b },
+           store[] = { 0x89 },
+           add[] = { 0x03 },
+           sub[] = { 0x2b },
+           mul[] = { 0x0f, 0xaf },
+           cmp_acc[] = { 0x41, 0x89, 0xde },    /* mov r14d, ebx */
+           cmp_imm[] = { 0x41, 0x81, 0xee },    /* sub r14d, imm32 */
+           test_cmp[] = { 0x45, 0x85, 0xf6 },   /* test r14d, r14d */
+           test_ecx[] = { 0x85, 0xc9 },         /* test ecx, ecx */
+           load_covered[] = { 0x49, 0x8b, 0x45, 0x20 },
+                                    /* mov rax, [r13 + 32] */
+           test_covered[] = { 0x80, 0xb8 };     /* cmp [rax + imm32] */
+    const int rbx = 3, rcx = 1, r14 = 14;
+    bool executed = (pos != ctx->start);
+    int last_ir = executed ? di[-1].word : 0,
+        rm = cell_reg(ctx, di->operand);
+    size_t exit_len = spill_size(ctx) + exit_size(executed, true),
+           link_len = spill_size(ctx) + link_size(true);
+    switch (handler_of(jit, di))
+    {
+        case M86PD_LOAD:
+            emit_operand(jit, load, sizeof(load), rbx, rm, di->operand);
+            break;
+        case M86PD_LOADI:
+            emit8(jit, 0xbb);       /* mov ebx, imm32 */
+            emit32(jit, di->operand);
+            break;
+        case M86PD_STORE:
+            emit_operand(jit, store, sizeof(store),
+                    rbx, rm, di->operand);
+            break;
+        case M86PD_STORE_CODE:
+            emit(jit, load_covered, sizeof(load_covered));
+            emit(jit, test_covered, sizeof(test_covered));
+            emit32(jit, di->operand);
+            emit8(jit, 0x00);       /* , 0 */
+            emit8(jit, 0x74);       /* je over exit */
+            emit8(jit, (unsigned char) exit_len);
+            exit_to(jit, ctx, pos, executed, last_ir);
+            emit_operand(jit, store, sizeof(store),
+                    rbx, rm, di->operand);
+            break;
+        case M86PD_ADD:
+            emit_operand(jit, add, sizeof(add), rbx, rm, di->operand);
+            break;
+        case M86PD_ADDI:
+            emit8(jit, 0x81);       /* add ebx, imm32 */
+            emit8(jit, 0xc3);
+            emit32(jit, di->operand);
+            break;
+        case M86PD_SUB:
+            emit_operand(jit, sub, sizeof(sub), rbx, rm, di->operand);
+            break;
+        case M86PD_SUBI:
+            emit8(jit, 0x81);       /* sub ebx, imm32 */
+            emit8(jit, 0xeb);
+            emit32(jit, di->operand);
+            break;
+        case M86PD_MUL:
+            emit_operand(jit, mul, sizeof(mul), rbx, rm, di->operand);
+            break;
+        case M86PD_MULI:
+            emit8(jit, 0x69);       /* imul ebx, ebx, imm32 */
+            emit8(jit, 0xdb);
+            emit32(jit, di->operand);
+            break;
+        case M86PD_DIV:
+        case M86PD_MOD:
+            emit_operand(jit, load, sizeof(load), rcx, rm, di->operand);
+            emit(jit, test_ecx, sizeof(test_ecx));
+            emit8(jit, 0x75);       /* jnz over exit */
+            emit8(jit, (unsigned char) exit_len);
+            exit_to(jit, ctx, pos, executed, last_ir);
+            emit_divide(jit, (di->handler == M86PD_MOD));
+            break;
+        case M86PD_DIVI:
+        case M86PD_MODI:
+            if (di->reciprocal != 0)
+            {
+                emit_reciprocal(jit, di, (di->handler == M86PD_MODI));
+                break;
+            }
+            emit8(jit, 0xb9);       /* mov ecx, imm32 */
+            emit32(jit, di->operand);
+            emit_divide(jit, (di->handler == M86PD_MODI));
+            break;
+        case M86PD_CMP:
+            emit(jit, cmp_acc, sizeof(cmp_acc));
+            emit_operand(jit, sub, sizeof(sub), r14, rm, di->operand);
+            break;
+        case M86PD_CMPI:
+            emit(jit, cmp_acc, sizeof(cmp_acc));
+            emit(jit, cmp_imm, sizeof(cmp_imm));
+            emit32(jit, di->operand);
+            break;
+        case M86PD_JMPI:
+            if (ctx->trace) emit_loop(jit, ctx, di->word);
+            else link_to(jit, ctx, pos, di->operand, di->word);
+            return true;
+        default:                    /* conditional jumps */
+            emit(jit, test_cmp, sizeof(test_cmp));
+            /* Skip the taken path if condition fails. */
+            emit8(jit, jcc_short(di->handler) ^ 0x01);
+            if (ctx->trace && ((unsigned) di->operand == ctx->start))
+            {
+                emit8(jit, (unsigned char) loop_size(ctx));
+                emit_loop(jit, ctx, di->word);
+            }
+            else
+            {
+                emit8(jit, (unsigned char) link_len);
+                link_to(jit, ctx, pos, di->operand, di->word);
+            }
+            /* Within a trace, a side exit; otherwise the block ends. */
+            if (ctx->trace && (pos != ctx->end)) return false;
+            link_to(jit, ctx, pos, pos + 1, di->word);
+            return true;
+    }
+    return false;
+}
+
+/* Translate the block (or trace) described by specified context into
+ * the buffer and record it.
+ */
+static void translate(
+        m86_jit *jit,
+        m86_predecoded_program *program,
+        m86jit_context *ctx)
+{
+    static const unsigned char load[] = { 0x8b },
+           nop[] = { 0x0f, 0x1f, 0x44, 0x00, 0x00 };
+    unsigned int start = ctx->start,
+                 pos,
+                 i;
+    m86_jit_block_info *info = jit->blocks + start;
+    ctx->epilogue = jit->used;
+    emit_epilogue(jit);
+    void *entry = jit->buffer + jit->used;
+    emit_prologue(jit);
+    /* Room for redirecting the body once the block is invalidated. */
+    size_t body = jit->used;
+    emit(jit, nop, sizeof(nop));
+    for (i = 0; i < ctx->cells; i++)
+        emit_operand(jit, load, sizeof(load),
+                m86jit_cell_regs[i], -1, ctx->cell_pos[i]);
+    ctx->top = jit->used;
+    for (pos = start; ; pos++)
+    {
+        m86pd_refresh(program, jit->mem, pos);
+        const m86_predecoded_instruct *di = program->code + pos;
+        if ((pos >= program->size) || (!translatable(jit, di)))
+        {
+            exit_to(jit, ctx, pos, (pos != start),
+                    (pos != start) ? di[-1].word : 0);
+            break;
+        }
+        if ((pos - start) >= M86JIT_MAX_BLOCK_LEN)
+        {
+            link_to(jit, ctx, pos - 1, pos, di[-1].word);
+            break;
+        }
+        jit->covered[pos]++;
+        if (translate_instruct(jit, ctx, di, pos))
+        {
+            pos++;
+            break;
+        }
+    }
+    info->stale = jit->used;
+    emit_exit(jit, ctx->epilogue, start, false, 0, false);
+    info->entry = entry;
+    info->body = body;
+    info->end = pos;
+    jit->dirty = true;
+    return;
+}
+
+/* Set up context for translating the block starting at specified
+ * position.
+ */
+static void plan_block(
+        m86jit_context *ctx,
+        const unsigned int start)
+{
+    ctx->start = ctx->end = start;
+    ctx->trace = ctx->set_ir = false;
+    ctx->cells = 0;
+    return;
+}
+
+/* Return true if the instruction in specified record has a memory
+ * operand.
+ */
+static bool has_mem_operand(const m86_predecoded_instruct *di)
+{
+    switch (di->handler)
+    {
+        case M86PD_LOAD:
+        case M86PD_STORE:
+        case M86PD_STORE_CODE:
+        case M86PD_ADD:
+        case M86PD_SUB:
+        case M86PD_MUL:
+        case M86PD_DIV:
+        case M86PD_MOD:
+        case M86PD_CMP:     return true;
+        default:            break;
+    }
+    return false;
+}
+
+/* Record the trace of the loop starting at specified position (i.e.,
+ * the straight-line code up to a jump back to it) and set up context
+ * for translating it, keeping its most used memory units in registers.
+ * Return false if there is no such loop.
+ */
+static bool plan_trace(
+        m86_jit *jit,
+        m86_predecoded_program *program,
+        m86jit_context *ctx,
+        const unsigned int start)
+{
+    int cand_pos[M86JIT_MAX_BLOCK_LEN];
+    unsigned int cand_uses[M86JIT_MAX_BLOCK_LEN],
+                 cands = 0,
+                 pos,
+                 i;
+    bool cand_dirty[M86JIT_MAX_BLOCK_LEN],
+         closed = false;
+    plan_block(ctx, start);
+    for (pos = start; (pos < program->size) &&
+            ((pos - start) < M86JIT_MAX_BLOCK_LEN); pos++)
+    {
+        m86pd_refresh(program, jit->mem, pos);
+        const m86_predecoded_instruct *di = program->code + pos;
+        if (!translatable(jit, di)) return false;
+        if ((di->handler >= M86PD_JMPI) && (di->handler <= M86PD_JGEI)
+                && ((unsigned) di->operand == start))
+        {
+            closed = true;
+            break;
+        }
+        if (di->handler == M86PD_JMPI) return false;
+        if (!has_mem_operand(di)) continue;
+        for (i = 0; (i < cands) && (cand_pos[i] != di->operand); i++);
+        if (i == cands)
+        {
+            cand_pos[cands] = di->operand;
+            cand_uses[cands] = 0;
+            cand_dirty[cands++] = false;
+        }
+        cand_uses[i]++;
+        if ((di->handler == M86PD_STORE) ||
+                (di->handler == M86PD_STORE_CODE))
+            cand_dirty[i] = true;
+    }
+    if (!closed) return false;
+    ctx->trace = true;
+    ctx->end = pos;
+    switch (handler_of(jit, program->code + start))
+    {
+        case M86PD_STORE_CODE:
+        case M86PD_DIV:
+        case M86PD_MOD:     ctx->set_ir = true; break;
+        default:            break;
+    }
+    /* Pick the most used memory units. */
+    while ((ctx->cells < M86JIT_NUM_CELL_REGS) && (cands > 0))
+    {
+        unsigned int best = 0;
+        for (i = 1; i < cands; i++)
+            if (cand_uses[i] > cand_uses[best]) best = i;
+        ctx->cell_pos[ctx->cells] = cand_pos[best];
+        ctx->dirty[ctx->cells++] = cand_dirty[best];
+        cands--;
+        cand_pos[best] = cand_pos[cands];
+        cand_uses[best] = cand_uses[cands];
+        cand_dirty[best] = cand_dirty[cands];
+    }
+    return true;
+}
+
+/* Discard the block starting at specified position: redirect its body
+ * to its stale stub, so chained jumps to it return to the caller.
+ */
+static void discard(
+        m86_jit *jit,
+        const unsigned int start)
+{
+    m86_jit_block_info *info = jit->blocks + start;
+    unsigned int pos;
+    if (info->entry != &m86jit_none)
+    {
+        jit->buffer[info->body] = 0xe9;     /* jmp stale stub */
+        patch(jit, info->body + 1, info->stale);
+    }
+    for (pos = start; pos < info->end; pos++) jit->covered[pos]--;
+    info->entry = NULL;
+    return;
+}
+
+/* Make the buffer writable (and not executable), or executable (and
+ * not writable); return false if its protection could not be changed.
+ */
+static bool protect(
+        m86_jit *jit,
+        const bool writable)
+{
+    if (jit->writable == writable) return true;
+    int prot = writable ?
+        (PROT_READ | PROT_WRITE) : (PROT_READ | PROT_EXEC);
+    if (mprotect(jit->buffer, M86JIT_BUFFER_SIZE, prot) != 0)
+        return false;
+    jit->writable = writable;
+    return true;
+}
+
+/* Discard all translated blocks.
+ */
+static void flush(m86_jit *jit)
+{
+    jit->used = 0;
+    jit->num_links = 0;
+    memset(jit->blocks, 0,
+            jit->program_size * sizeof(m86_jit_block_info));
+    memset(jit->covered, 0, jit->program_size);
+    return;
+}
+
+/* M86JIT_CACHE_MAGIC: first bytes of a cache file.
+ */
+#define M86JIT_CACHE_MAGIC "M86J"
+
+/* M86JIT_BUILD: identifies the build of the code generator; translated
+ * code saved by other builds may differ even if the format of cache
+ * files does not, so it is not loaded.
+ */
+#if defined(__VERSION__)
+#define M86JIT_BUILD \
+    M86_VERSION_NUM " " __VERSION__ " " __DATE__ " " __TIME__
+#else
+#define M86JIT_BUILD M86_VERSION_NUM " " __DATE__ " " __TIME__
+#endif
+
+/* Type: m86jit_cache_header.
+ *
+ * Header of a cache file, which is followed by the image of the code
+ * region, the part of the buffer in use, the block bookkeeping, the
+ * entry of each block (see entry_code()), the covered counts and the
+ * links; build is the checksum of M86JIT_BUILD, and checksum that of
+ * everything following the header.
+ */
+typedef struct
+{
+    char magic[4];
+    unsigned int format,
+                 program_size,
+                 mem_size,
+                 num_links;
+    size_t used;
+    unsigned long long build,
+                       checksum;
+} m86jit_cache_header;
+
+/* Return the entry of a block as saved in cache files: 0 if not
+ * translated, 1 if left to the interpreter, or else its buffer offset
+ * plus 2.
+ */
+static size_t entry_code(
+        const m86_jit *jit,
+        const void *entry)
+{
+    if (entry == NULL) return 0;
+    if (entry == &m86jit_none) return 1;
+    return (size_t) ((const unsigned char *) entry - jit->buffer) + 2;
+}
+
+/* Return the entry of a block saved in cache files as specified code
+ * (see entry_code()).
+ */
+static void *entry_of(
+        const m86_jit *jit,
+        const size_t code)
+{
+    if (code == 0) return NULL;
+    if (code == 1) return &m86jit_none;
+    return jit->buffer + (code - 2);
+}
+
+/* Return the size in bytes of the contents of a cache file following
+ * specified header.
+ */
+static size_t cache_size(const m86jit_cache_header *header)
+{
+    size_t blocks = header->program_size + 1;
+    return header->program_size * sizeof(m86_encoded_instruct)
+        + header->used
+        + blocks * (sizeof(m86_jit_block_info) + sizeof(size_t) + 1)
+        + header->num_links * sizeof(m86_jit_link);
+}
+
+/* Return whether the contents of a cache file following specified
+ * header were saved by the same build, are intact (i.e., match the
+ * checksum in the header), were saved for the code region the compiler
+ * was set up for, and only refer to the part of the buffer in use and
+ * to links that exist: translated code is run and patched as it is,
+ * so anything else (e.g., a truncated write, or a cache key shared by
+ * another program) must not be loaded.
+ */
+static bool cache_valid(
+        const m86_jit *jit,
+        const m86jit_cache_header *header,
+        const unsigned char *contents)
+{
+    const unsigned char *buffer = contents
+        + jit->program_size * sizeof(m86_encoded_instruct);
+    const unsigned char *info = buffer + header->used;
+    const unsigned char *codes = info
+        + (jit->program_size + 1) * sizeof(m86_jit_block_info);
+    const unsigned char *links = codes
+        + (jit->program_size + 1) * (sizeof(size_t) + 1);
+    m86_jit_block_info block;
+    m86_jit_link link;
+    size_t code;
+    unsigned int i;
+    if ((header->build != m86cache_checksum(M86JIT_BUILD,
+                    strlen(M86JIT_BUILD))) ||
+            (header->checksum !=
+             m86cache_checksum(contents, cache_size(header))) ||
+            (memcmp(contents, jit->image,
+                    jit->program_size * sizeof(m86_encoded_instruct))
+             != 0))
+        return false;
+    for (i = 0; i <= jit->program_size; i++)
+    {
+        memcpy(&block, info + i * sizeof(block), sizeof(block));
+        memcpy(&code, codes + i * sizeof(code), sizeof(code));
+        if ((block.end > jit->program_size) ||
+                (block.links > header->num_links))
+            return false;
+        if (code < 2) continue;
+        /* A block enters through its prologue, which its body follows;
+         * discarding it writes a jump over its body. */
+        if ((code - 2 >= header->used) ||
+                (code - 2 + sizeof(m86jit_prologue) != block.body) ||
+                (block.body + 5 > header->used) ||
+                (block.stale >= header->used) ||
+                (memcmp(buffer + code - 2, m86jit_prologue,
+                        sizeof(m86jit_prologue)) != 0))
+            return false;
+    }
+    for (i = 0; i < header->num_links; i++)
+    {
+        memcpy(&link, links + i * sizeof(link), sizeof(link));
+        /* Links only ever point to earlier ones, which also rules out
+         * cycles. */
+        if ((link.site >= header->used) ||
+                (header->used - link.site < 4) || (link.next > i))
+            return false;
+    }
+    return true;
+}
+
+#endif
+
+/* m86jit_init: initialize just-in-time compiler for specified
+ * pre-decoded program.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to m86_jit variable.
+ * # pointer to m86_predecoded_program variable.
+ * # memory variable containing program.
+ * # unsigned value for memory size.
+ *
+ * Note: memory must not be moved (e.g., extended) while the compiler
+ * is in use.
+ *
+ * Note: to avoid memory leaks, m86jit_kill() should be called once the
+ * compiler is no longer needed, provided that this function succeeded.
+ *
+ * Returns: bool value to indicate status of initialization; true =
+ * success, false = failure (i.e., native code generation unavailable
+ * or not enough memory).
+ */
+bool m86jit_init(
+        m86_jit *jit,
+        const m86_predecoded_program *program,
+        const memory mem,
+        const unsigned int mem_size)
+{
+#if M86_HAVE_JIT
+    unsigned int i;
+    if ((jit == NULL) || (program == NULL)) return false;
+    jit->program_size = program->size;
+    jit->mem_size = mem_size;
+    jit->mem = mem;
+    jit->used = 0;
+    jit->links = NULL;
+    jit->num_links = jit->max_links = 0;
+    jit->dirty = false;
+    jit->blocks = calloc(program->size + 1, sizeof(m86_jit_block_info));
+    jit->covered = calloc(program->size + 1, 1);
+    jit->image = malloc((program->size + 1) *
+            sizeof(m86_encoded_instruct));
+    if ((jit->blocks == NULL) || (jit->covered == NULL) ||
+            (jit->image == NULL))
+    {
+        free(jit->blocks);
+        free(jit->covered);
+        free(jit->image);
+        return false;
+    }
+    jit->buffer = mmap(NULL, M86JIT_BUFFER_SIZE,
+            PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    jit->writable = true;
+    if (jit->buffer == MAP_FAILED)
+    {
+        free(jit->blocks);
+        free(jit->covered);
+        free(jit->image);
+        return false;
+    }
+    for (i = 0; i < program->size; i++)
+        jit->image[i] = program->code[i].word;
+    m86cache_key(jit->key, program, mem_size, M86JIT_CACHE_FORMAT);
+    return true;
+#else
+    (void) jit;
+    (void) program;
+    (void) mem;
+    (void) mem_size;
+    return false;
+#endif
+}
+
+/* m86jit_prepare: set the fields of the state used by translated
+ * blocks that do not hold registers.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to m86_jit variable.
+ * # pointer to m86_jit_state variable.
+ *
+ * Returns: N/A.
+ */
+void m86jit_prepare(
+        const m86_jit *jit,
+        m86_jit_state *state)
+{
+    state->mem = jit->mem;
+    state->covered = jit->covered;
+    return;
+}
+
+/* m86jit_load: replace translated blocks with those saved in the cache
+ * for specified pre-decoded program, if any.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to m86_jit variable.
+ * # pointer to m86_predecoded_program variable.
+ *
+ * Note: records of the pre-decoded program must be up to date (see
+ * m86pd_refresh()).
+ *
+ * Note: a cache file is only loaded if it was saved for the same code
+ * region and everything it refers to is within bounds; otherwise,
+ * blocks are translated from scratch and the file is replaced once
+ * they are saved.
+ *
+ * Returns: bool value to indicate whether translated blocks were
+ * loaded; true = loaded, false = not cached (or unusable), in which
+ * case the compiler is left as it was.
+ */
+bool m86jit_load(m86_jit *jit)
+{
+#if M86_HAVE_JIT
+    char path[M86CACHE_PATH_SIZE];
+    m86jit_cache_header header;
+    unsigned char *contents = NULL,
+                  *next;
+    m86_jit_link *links = NULL;
+    size_t size = 0,
+           code;
+    unsigned int i;
+    FILE *file;
+    bool loaded = false;
+    if (!m86cache_path(path, jit->key, ".jit") ||
+            ((file = fopen(path, "rb")) == NULL))
+        return false;
+    if ((fread(&header, sizeof(header), 1, file) == 1) &&
+            (memcmp(header.magic, M86JIT_CACHE_MAGIC, 4) == 0) &&
+            (header.format == M86JIT_CACHE_FORMAT) &&
+            (header.program_size == jit->program_size) &&
+            (header.mem_size == jit->mem_size) &&
+            (header.used <= M86JIT_BUFFER_SIZE))
+    {
+        size = cache_size(&header);
+        contents = malloc(size);
+        links = malloc((header.num_links + 1) * sizeof(m86_jit_link));
+        loaded = (contents != NULL) && (links != NULL) &&
+            (fread(contents, 1, size, file) == size) &&
+            (fgetc(file) == EOF);
+    }
+    fclose(file);
+    loaded = loaded && cache_valid(jit, &header, contents) &&
+        protect(jit, true);
+    if (!loaded)
+    {
+        free(contents);
+        free(links);
+        return false;
+    }
+    next = contents + jit->program_size * sizeof(m86_encoded_instruct);
+    memcpy(jit->buffer, next, header.used);
+    next += header.used;
+    memcpy(jit->blocks, next,
+            (jit->program_size + 1) * sizeof(m86_jit_block_info));
+    next += (jit->program_size + 1) * sizeof(m86_jit_block_info);
+    for (i = 0; i <= jit->program_size; i++)
+    {
+        memcpy(&code, next, sizeof(size_t));
+        next += sizeof(size_t);
+        jit->blocks[i].entry = entry_of(jit, code);
+    }
+    memcpy(jit->covered, next, jit->program_size + 1);
+    next += jit->program_size + 1;
+    memcpy(links, next, header.num_links * sizeof(m86_jit_link));
+    free(jit->links);
+    jit->links = links;
+    jit->num_links = header.num_links;
+    jit->max_links = header.num_links + 1;
+    jit->used = header.used;
+    jit->dirty = false;
+    free(contents);
+    return true;
+#else
+    (void) jit;
+    return false;
+#endif
+}
+
+/* m86jit_save: save translated blocks to the cache for specified
+ * pre-decoded program, if anything has been translated since they
+ * were set up or loaded.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to m86_jit variable.
+ * # pointer to m86_predecoded_program variable.
+ *
+ * Note: records of the pre-decoded program must be up to date (see
+ * m86pd_refresh()); translated blocks are saved for the program as it
+ * is, which may differ from the program they were loaded for if it
+ * modified itself.
+ *
+ * Note: failures (e.g., no cache directory) are silently ignored.
+ *
+ * Returns: N/A.
+ */
+void m86jit_save(
+        m86_jit *jit,
+        const m86_predecoded_program *program)
+{
+#if M86_HAVE_JIT
+    char path[M86CACHE_PATH_SIZE],
+         temp[M86CACHE_PATH_SIZE];
+    m86jit_cache_header header;
+    unsigned char *contents,
+                  *next;
+    size_t size,
+           code;
+    unsigned int i;
+    FILE *file;
+    bool saved;
+    if ((jit == NULL) || !jit->dirty) return;
+    for (i = 0; i < jit->program_size; i++)
+        if (jit->covered[i] &&
+                (program->code[i].word != jit->image[i]))
+            return;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, M86JIT_CACHE_MAGIC, 4);
+    header.format = M86JIT_CACHE_FORMAT;
+    header.program_size = jit->program_size;
+    header.mem_size = jit->mem_size;
+    header.num_links = jit->num_links;
+    header.used = jit->used;
+    size = cache_size(&header);
+    if ((contents = malloc(size)) == NULL) return;
+    next = contents;
+    memcpy(next, jit->image,
+            jit->program_size * sizeof(m86_encoded_instruct));
+    next += jit->program_size * sizeof(m86_encoded_instruct);
+    memcpy(next, jit->buffer, jit->used);
+    next += jit->used;
+    memcpy(next, jit->blocks,
+            (jit->program_size + 1) * sizeof(m86_jit_block_info));
+    next += (jit->program_size + 1) * sizeof(m86_jit_block_info);
+    for (i = 0; i <= jit->program_size; i++)
+    {
+        code = entry_code(jit, jit->blocks[i].entry);
+        memcpy(next, &code, sizeof(size_t));
+        next += sizeof(size_t);
+    }
+    memcpy(next, jit->covered, jit->program_size + 1);
+    next += jit->program_size + 1;
+    memcpy(next, jit->links, jit->num_links * sizeof(m86_jit_link));
+    header.build = m86cache_checksum(M86JIT_BUILD,
+            strlen(M86JIT_BUILD));
+    header.checksum = m86cache_checksum(contents, size);
+    if (!m86cache_path(path, jit->key, ".jit") ||
+            !m86cache_temp_path(temp, path, ".tmp") ||
+            ((file = fopen(temp, "wb")) == NULL))
+    {
+        free(contents);
+        return;
+    }
+    saved = (fwrite(&header, sizeof(header), 1, file) == 1) &&
+        (fwrite(contents, 1, size, file) == size);
+    free(contents);
+    saved = (fclose(file) == 0) && saved && (rename(temp, path) == 0);
+    if (!saved) remove(temp);
+    else jit->dirty = false;
+#else
+    (void) jit;
+    (void) program;
+#endif
+    return;
+}
+
+/* m86jit_get: return translated block starting at specified
+ * position, translating it first if needed.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to m86_jit variable.
+ * # pointer to m86_predecoded_program variable.
+ * # unsigned value for starting position of block.
+ *
+ * Note: records of the pre-decoded program are refreshed as needed.
+ *
+ * Returns: translated block, or NULL if the instruction at specified
+ * position (or the position itself) is left to the interpreter.
+ */
+m86_jit_block m86jit_get(
+        m86_jit *jit,
+        m86_predecoded_program *program,
+        const unsigned int pos)
+{
+#if M86_HAVE_JIT
+    if (pos >= jit->program_size) return NULL;
+    m86_jit_block_info *info = jit->blocks + pos;
+    if (info->entry == &m86jit_none) return NULL;
+    if (info->entry != NULL)
+    {
+        if ((info->hits >= M86JIT_HOT_THRESHOLD) ||
+                (++info->hits < M86JIT_HOT_THRESHOLD))
+            return protect(jit, false) ?
+                (m86_jit_block) info->entry : NULL;
+    }
+    else
+    {
+        m86pd_refresh(program, jit->mem, pos);
+        if (!translatable(jit, program->code + pos))
+        {
+            /* Stores into pos must reset the sentinel. */
+            info->entry = &m86jit_none;
+            info->end = pos + 1;
+            jit->covered[pos]++;
+            return NULL;
+        }
+    }
+    /* Left to the interpreter if it cannot be translated. */
+    if (!protect(jit, true)) return NULL;
+    if ((M86JIT_BUFFER_SIZE - jit->used) <
+            (M86JIT_BLOCK_OVERHEAD + M86JIT_MAX_BLOCK_LEN
+             * M86JIT_MAX_INSTRUCT_BYTES))
+        flush(jit);
+    m86jit_context ctx;
+    if ((info->hits >= M86JIT_HOT_THRESHOLD) &&
+            plan_trace(jit, program, &ctx, pos))
+    {
+        /* Replace the block with a trace of the loop it starts. */
+        if (info->entry != NULL) discard(jit, pos);
+        translate(jit, program, &ctx);
+    }
+    else if (info->entry == NULL)
+    {
+        plan_block(&ctx, pos);
+        translate(jit, program, &ctx);
+    }
+    chain(jit, pos);
+    return protect(jit, false) ? (m86_jit_block) info->entry : NULL;
+#else
+    (void) jit;
+    (void) program;
+    (void) pos;
+    return NULL;
+#endif
+}
+
+/* m86jit_invalidate: discard translated blocks that depend on the
+ * memory unit at specified position after it has been modified.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to m86_jit variable.
+ * # unsigned value for position of modified memory unit.
+ *
+ * Note: positions outside the code region are ignored. Other blocks
+ * stay translated; jumps chained to a discarded block return to the
+ * caller, which translates the block anew.
+ *
+ * Returns: N/A.
+ */
+void m86jit_invalidate(
+        m86_jit *jit,
+        const unsigned int pos)
+{
+#if M86_HAVE_JIT
+    if ((pos >= jit->program_size) || (!jit->covered[pos])) return;
+    /* Only blocks starting at most M86JIT_MAX_BLOCK_LEN instructions
+     * before pos can extend over it. */
+    unsigned int start = (pos < M86JIT_MAX_BLOCK_LEN) ?
+        0 : pos - M86JIT_MAX_BLOCK_LEN;
+    if (!protect(jit, true))
+    {
+        /* Blocks are only reached through their entries, so none
+         * can run once all of them are dropped. */
+        flush(jit);
+        return;
+    }
+    for (; start <= pos; start++)
+        if ((jit->blocks[start].entry != NULL) &&
+                (jit->blocks[start].end > pos))
+            discard(jit, start);
+#else
+    (void) jit;
+    (void) pos;
+#endif
+    return;
+}
+
+/* m86jit_kill: release resources held by just-in-time compiler.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to m86_jit variable.
+ *
+ * Note: passing NULL results in no operation being performed.
+ *
+ * Returns: N/A.
+ */
+void m86jit_kill(m86_jit *jit)
+{
+#if M86_HAVE_JIT
+    if (jit == NULL) return;
+    munmap(jit->buffer, M86JIT_BUFFER_SIZE);
+    free(jit->blocks);
+    free(jit->covered);
+    free(jit->links);
+    free(jit->image);
+    jit->buffer = NULL;
+    jit->blocks = NULL;
+    jit->covered = NULL;
+    jit->links = NULL;
+    jit->image = NULL;
+#else
+    (void) jit;
+#endif
+    return;
+}
+
+/* EOF. */
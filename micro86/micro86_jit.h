@@ -0,0 +1,362 @@
+/* micro86_jit:
+ *
+ * Just-in-time compiler from pre-decoded micro86 basic blocks to native
+ * x86-64 code.
+ *
+ * A block starts at any instruction and runs up to and including the
+ * next jump. Jumps (and fall-throughs) between translated blocks are
+ * chained: once the target block has been translated, the jump is
+ * patched to go to it directly instead of returning to the caller.
+ *
+ * Once a block that starts a loop becomes hot, the straight-line code
+ * from it up to the jump back to it is recorded as a trace, which is
+ * translated into a native loop that keeps the memory units it uses
+ * most (i.e., the VAR cells) in registers. Conditional jumps out of
+ * the loop become side exits, which write the registers back to memory
+ * and continue in ordinary blocks.
+ *
+ * Blocks stop early at instructions that are left to the interpreter:
+ * HALT, IN, OUT, invalid instructions, memory operands outside memory
+ * bounds and division by an immediate zero. Division by a memory
+ * operand that turns out to be zero, and STOREs into a part of the
+ * code region that has been translated, leave the block just before
+ * the instruction in question, so the interpreter carries it out (and
+ * reports errors). Divisions by immediates other than 0, 1 and -1 are
+ * translated into multiplications by their reciprocals (see
+ * micro86_predecode.h).
+ *
+ * Note: translated STOREs into parts of the code region that have not
+ * been translated do not re-decode the pre-decoded program; records
+ * are refreshed (see m86pd_refresh()) before being translated, and
+ * callers interpreting instructions must refresh them likewise.
+ *
+ * Translated code does not depend on where the buffer is mapped, so
+ * translated blocks and their bookkeeping can be saved to the cache
+ * (see micro86_cache.h) and loaded back by later runs of the same
+ * program, which then start with the blocks already translated.
+ *
+ * The buffer is never writable and executable at once: it is made
+ * writable while blocks are translated, chained, discarded or loaded,
+ * and executable again before a translated block is returned.
+ *
+ * Note: on platforms other than x86-64 Unix-like systems, m86jit_init()
+ * always fails and callers are expected to fall back to interpreting.
+ */
+
+#ifndef _STDBOOL_H
+#include <stdbool.h>
+#endif
+
+#ifndef _STDDEF_H
+#include <stddef.h>
+#endif
+
+#ifndef MICRO86PREDECODE_H
+#include "micro86_predecode.h"
+#endif
+
+#ifndef MICRO86CACHE_H
+#include "micro86_cache.h"
+#endif
+
+#ifndef MICRO86JIT_H
+#define MICRO86JIT_H
+
+/* M86_HAVE_JIT: whether native code generation is available.
+ */
+#if defined(__x86_64__) && defined(__unix__)
+#define M86_HAVE_JIT 1
+#else
+#define M86_HAVE_JIT 0
+#endif
+
+/* M86JIT_CACHE_FORMAT: version of the format of cache files; part of
+ * the cache key, so it has to be bumped whenever translated code or
+ * the bookkeeping saved with it changes.
+ */
+#define M86JIT_CACHE_FORMAT 4
+
+/* M86JIT_BUFFER_SIZE: size in bytes of executable buffer holding
+ * translated blocks; the buffer is flushed when it runs out of space.
+ */
+#define M86JIT_BUFFER_SIZE (4 * 1024 * 1024)
+
+/* M86JIT_MAX_BLOCK_LEN: maximum number of instructions per block (or
+ * trace).
+ */
+#define M86JIT_MAX_BLOCK_LEN 64
+
+/* M86JIT_HOT_THRESHOLD: number of times a block has to be entered
+ * through m86jit_get() before it is considered hot, i.e., a trace is
+ * recorded if it starts a loop and backward jumps to it are chained.
+ */
+#define M86JIT_HOT_THRESHOLD 50
+
+/* M86JIT_NUM_CELL_REGS: maximum number of memory units kept in
+ * registers by a trace.
+ */
+#define M86JIT_NUM_CELL_REGS 6
+
+/* Type: m86_jit_state.
+ *
+ * Machine state shared between translated blocks and their caller,
+ * consisting of the following:
+ *
+ * # acc: accumulator register.
+ * # flags: flags register (zero and sign bits as in micro86_proc).
+ * # ip: instruction pointer register.
+ * # ir: instruction register.
+ * # mem: memory base (i.e., the memory variable).
+ * # interpret: set to non-zero by a block that stops at an instruction
+ * it leaves to the interpreter; the caller clears it before running a
+ * block.
+ * # covered: bookkeeping of the compiler, checked by translated
+ * STOREs into the code region.
+ *
+ * Note: mem and covered are set by m86jit_prepare().
+ *
+ * WARNING: translated code depends on the layout of this type; do not
+ * reorder or add fields without updating micro86_jit.c.
+ */
+typedef struct
+{
+    int acc;
+    unsigned int flags,
+                 ip,
+                 ir;
+    int *mem;
+    int interpret;
+    const unsigned char *covered;
+} m86_jit_state;
+
+/* Type: m86_jit_block.
+ *
+ * A translated block; running it updates the state passed to it.
+ */
+typedef void (*m86_jit_block)(m86_jit_state*);
+
+/* Type: m86_jit_block_info.
+ *
+ * Bookkeeping for the block starting at a position of the code region
+ * consisting of the following:
+ *
+ * # entry: translated block (NULL if not translated yet, or a sentinel
+ * if the instruction at that position is left to the interpreter).
+ * # body: buffer offset of the block body (i.e., the code following
+ * the prologue, which chained blocks jump to).
+ * # stale: buffer offset of the exit stub that the body is redirected
+ * to once the block is invalidated.
+ * # end: position following the last instruction translated.
+ * # links: index (plus one) of the first link to be patched whenever a
+ * block starting at that position is translated (0 if none).
+ * # hits: number of times the block was entered through m86jit_get(),
+ * up to M86JIT_HOT_THRESHOLD.
+ */
+typedef struct
+{
+    void *entry;
+    size_t body,
+           stale;
+    unsigned int end,
+                 links,
+                 hits;
+} m86_jit_block_info;
+
+/* Type: m86_jit_link.
+ *
+ * A jump between translated blocks consisting of the following:
+ *
+ * # site: buffer offset of the 32-bit displacement to patch.
+ * # next: index (plus one) of the next link sharing the same target (0
+ * if none).
+ * # backward: whether the jump goes backward (such links are only
+ * patched once their target is hot).
+ */
+typedef struct
+{
+    size_t site;
+    unsigned int next;
+    bool backward;
+} m86_jit_link;
+
+/* Type: m86_jit.
+ *
+ * A just-in-time compiler consisting of the following:
+ *
+ * # buffer: executable buffer holding translated blocks.
+ * # used: number of bytes of buffer in use.
+ * # blocks: m86_jit_block_info for each position of the code region.
+ * # covered: for each position of the code region, number of
+ * translated blocks that depend on the memory unit at that position.
+ * # links: array of jumps between translated blocks.
+ * # num_links: number of links in use.
+ * # max_links: number of links allocated.
+ * # mem: memory variable containing program.
+ * # program_size: size of code region.
+ * # mem_size: memory size, used to check memory operands.
+ * # image: words of the code region when the compiler was set up.
+ * # key: cache key of the program when the compiler was set up.
+ * # dirty: whether anything has been translated since the compiler was
+ * set up or loaded from the cache.
+ * # writable: whether buffer is writable (and then not executable)
+ * rather than executable.
+ *
+ * # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # #
+ * WARNING: m86_jit fields should not be accessed or modified directly.
+ * The functions declared below are to be used for such purposes.
+ * # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # #
+ */
+typedef struct
+{
+    unsigned char *buffer;
+    size_t used;
+    m86_jit_block_info *blocks;
+    unsigned char *covered;
+    m86_jit_link *links;
+    unsigned int num_links,
+                 max_links;
+    memory mem;
+    unsigned int program_size,
+                 mem_size;
+    m86_encoded_instruct *image;
+    char key[M86CACHE_KEY_SIZE];
+    bool dirty,
+         writable;
+} m86_jit;
+
+/* m86jit_init: initialize just-in-time compiler for specified
+ * pre-decoded program.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to m86_jit variable.
+ * # pointer to m86_predecoded_program variable.
+ * # memory variable containing program.
+ * # unsigned value for memory size.
+ *
+ * Note: memory must not be moved (e.g., extended) while the compiler
+ * is in use. Records of the pre-decoded program must be up to date
+ * (see m86pd_refresh()), as they make up the cache key (see
+ * m86jit_load()).
+ *
+ * Note: to avoid memory leaks, m86jit_kill() should be called once the
+ * compiler is no longer needed, provided that this function succeeded.
+ *
+ * Returns: bool value to indicate status of initialization; true =
+ * success, false = failure (i.e., native code generation unavailable
+ * or not enough memory).
+ */
+bool m86jit_init(
+        m86_jit*,
+        const m86_predecoded_program*,
+        const memory,
+        const unsigned int);
+
+/* m86jit_prepare: set the fields of the state used by translated
+ * blocks that do not hold registers.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to m86_jit variable.
+ * # pointer to m86_jit_state variable.
+ *
+ * Returns: N/A.
+ */
+void m86jit_prepare(
+        const m86_jit*,
+        m86_jit_state*);
+
+/* m86jit_load: replace translated blocks with those saved in the cache
+ * for the program the compiler was set up for, if any.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to m86_jit variable.
+ *
+ * Note: a cache file is only loaded if it was saved for the same code
+ * region and everything it refers to is within bounds; otherwise,
+ * blocks are translated from scratch and the file is replaced once
+ * they are saved.
+ *
+ * Returns: bool value to indicate whether translated blocks were
+ * loaded; true = loaded, false = not cached (or unusable), in which
+ * case the compiler is left as it was.
+ */
+bool m86jit_load(m86_jit*);
+
+/* m86jit_save: save translated blocks to the cache for the program
+ * the compiler was set up for, if anything has been translated since
+ * they were set up or loaded.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to m86_jit variable.
+ * # pointer to m86_predecoded_program variable.
+ *
+ * Note: records of the pre-decoded program must be up to date (see
+ * m86pd_refresh()). Nothing is saved if the program has modified any
+ * of the instructions translated blocks depend on, since they would no
+ * longer match the program as it was when the compiler was set up;
+ * stores into the rest of the code region (e.g., variables) do not
+ * matter.
+ *
+ * Note: failures (e.g., no cache directory) are silently ignored.
+ *
+ * Returns: N/A.
+ */
+void m86jit_save(
+        m86_jit*,
+        const m86_predecoded_program*);
+
+/* m86jit_get: return translated block starting at specified
+ * position, translating it first if needed.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to m86_jit variable.
+ * # pointer to m86_predecoded_program variable.
+ * # unsigned value for starting position of block.
+ *
+ * Note: records of the pre-decoded program are refreshed as needed.
+ *
+ * Returns: translated block, or NULL if the instruction at specified
+ * position (or the position itself) is left to the interpreter.
+ */
+m86_jit_block m86jit_get(
+        m86_jit*,
+        m86_predecoded_program*,
+        const unsigned int);
+
+/* m86jit_invalidate: discard translated blocks that depend on the
+ * memory unit at specified position after it has been modified.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to m86_jit variable.
+ * # unsigned value for position of modified memory unit.
+ *
+ * Note: positions outside the code region are ignored. Other blocks
+ * stay translated; jumps chained to a discarded block return to the
+ * caller, which translates the block anew.
+ *
+ * Returns: N/A.
+ */
+void m86jit_invalidate(
+        m86_jit*,
+        const unsigned int);
+
+/* m86jit_kill: release resources held by just-in-time compiler.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to m86_jit variable.
+ *
+ * Note: passing NULL results in no operation being performed.
+ *
+ * Returns: N/A.
+ */
+void m86jit_kill(m86_jit*);
+
+#endif
+
+/* EOF. */
@@ -0,0 +1,768 @@
+/* micro86_loop:
+ *
+ * Loop kernels for the micro86 emulator.
+ *
+ * Slot values are handled as unsigned values, so that arithmetic wraps
+ * around modulo 2^32 exactly as the engines' does; comparisons are
+ * reasoned about with exact (64-bit) values, which is only valid as
+ * long as those do not wrap around, hence the range checks before
+ * using closed forms.
+ */
+
+#ifndef _STDLIB_H
+#include <stdlib.h>
+#endif
+
+#ifndef _STRING_H
+#include <string.h>
+#endif
+
+#ifndef _LIMITS_H
+#include <limits.h>
+#endif
+
+#ifndef MICRO86LOOP_H
+#include "micro86_loop.h"
+#endif
+
+/* M86LP_NEVER: iteration count standing for "never".
+ */
+#define M86LP_NEVER (~0ULL)
+
+/* M86LP_MAX_COEFFICIENT: maximum magnitude of the coefficients of the
+ * comparison of a closed form (so that exact comparison results fit
+ * comfortably in 64 bits).
+ */
+#define M86LP_MAX_COEFFICIENT 0x10000
+
+/* Return true if conditional jump with specified handler is taken for
+ * specified comparison result.
+ */
+static bool m86lp_taken(
+        const unsigned int handler,
+        const long long cmp)
+{
+    switch (handler)
+    {
+        case M86PD_JEI:     return cmp == 0;
+        case M86PD_JNEI:    return cmp != 0;
+        case M86PD_JLI:     return cmp < 0;
+        case M86PD_JLEI:    return cmp <= 0;
+        case M86PD_JGI:     return cmp > 0;
+        default:            break;
+    }
+    return cmp >= 0;
+}
+
+/* Return handler of the conditional jump taken exactly when the one
+ * with specified handler is not.
+ */
+static unsigned int m86lp_negated(const unsigned int handler)
+{
+    switch (handler)
+    {
+        case M86PD_JEI:     return M86PD_JNEI;
+        case M86PD_JNEI:    return M86PD_JEI;
+        case M86PD_JLI:     return M86PD_JGEI;
+        case M86PD_JLEI:    return M86PD_JGI;
+        case M86PD_JGI:     return M86PD_JLEI;
+        default:            break;
+    }
+    return M86PD_JLI;
+}
+
+/* Set form to a constant value.
+ */
+static void m86lp_constant(
+        m86_loop_form *f,
+        const unsigned int value)
+{
+    memset(f, 0, sizeof(m86_loop_form));
+    f->known = true;
+    f->c[0] = value;
+    return;
+}
+
+/* Return true if form is known to be a constant value.
+ */
+static bool m86lp_is_constant(
+        const m86_loop_form *f,
+        const unsigned int num_slots)
+{
+    unsigned int i;
+    for (i = 1; i <= num_slots; i++)
+        if (f->c[i] != 0) return false;
+    return f->known;
+}
+
+/* Add form g, multiplied by factor, to form f.
+ */
+static void m86lp_add(
+        m86_loop_form *f,
+        const m86_loop_form *g,
+        const unsigned int factor)
+{
+    unsigned int i;
+    f->known = f->known && g->known;
+    for (i = 0; i <= M86LP_MAX_SLOTS; i++) f->c[i] += factor * g->c[i];
+    return;
+}
+
+/* Multiply form by factor.
+ */
+static void m86lp_scale(
+        m86_loop_form *f,
+        const unsigned int factor)
+{
+    unsigned int i;
+    for (i = 0; i <= M86LP_MAX_SLOTS; i++) f->c[i] *= factor;
+    return;
+}
+
+/* Return the value of form for specified slot values.
+ */
+static unsigned int m86lp_eval(
+        const m86_loop_form *f,
+        const unsigned int *values,
+        const unsigned int num_slots)
+{
+    unsigned int value = f->c[0],
+                 i;
+    for (i = 0; i < num_slots; i++) value += f->c[1 + i] * values[i];
+    return value;
+}
+
+/* Return slot index of memory position in loop, allocating a new slot
+ * if needed, or M86LP_MAX_SLOTS if there are too many.
+ */
+static unsigned int m86lp_slot(
+        m86_loop *l,
+        const unsigned int pos)
+{
+    unsigned int i;
+    for (i = 1; i < l->num_slots; i++)
+        if (l->cells[i] == pos) return i;
+    if (l->num_slots == M86LP_MAX_SLOTS) return M86LP_MAX_SLOTS;
+    l->cells[l->num_slots] = pos;
+    l->stored[l->num_slots] = false;
+    return l->num_slots++;
+}
+
+/* Translate the instructions from head up to tail of program into
+ * loop, or return false if they do not make up a loop that can be
+ * run as a kernel.
+ */
+static bool m86lp_recognise(
+        m86_loop *l,
+        const m86_predecoded_program *program,
+        const bool *reachable,
+        const unsigned int mem_size,
+        const unsigned int head,
+        const unsigned int tail)
+{
+    const m86_predecoded_instruct *di = program->code + head;
+    unsigned int pos,
+                 slot;
+    bool exits = false;
+    l->head = head;
+    l->tail = tail;
+    l->num_slots = 1;
+    l->stored[0] = true;
+    l->num_ops = tail - head;
+    l->bottom = (program->code[tail].handler != M86PD_JMPI);
+    l->condition = program->code[tail].handler;
+    l->closed = false;
+    for (pos = head; pos <= tail; pos++)
+        l->words[pos - head] = program->code[pos].word;
+    for (pos = head; pos < tail; pos++, di++)
+    {
+        l->ops[pos - head].handler = di->handler;
+        l->ops[pos - head].operand = di->operand;
+        switch (di->handler)
+        {
+            case M86PD_STORE:
+            case M86PD_STORE_CODE:
+                if (!l->bottom && !exits) return false;
+                /* Fall through. */
+            case M86PD_LOAD:
+            case M86PD_ADD:
+            case M86PD_SUB:
+            case M86PD_MUL:
+            case M86PD_CMP:
+                if ((di->operand < 0) ||
+                        ((unsigned) di->operand >= mem_size))
+                    return false;
+                if (((unsigned) di->operand < program->size) &&
+                        reachable[di->operand] &&
+                        (di->handler == M86PD_STORE_CODE))
+                    return false;
+                slot = m86lp_slot(l, di->operand);
+                if (slot == M86LP_MAX_SLOTS) return false;
+                if ((di->handler == M86PD_STORE) ||
+                        (di->handler == M86PD_STORE_CODE))
+                    l->stored[slot] = true;
+                l->ops[pos - head].operand = slot;
+                break;
+            case M86PD_DIVI:
+            case M86PD_MODI:
+                if (di->operand == 0) return false;
+                break;
+            case M86PD_LOADI:
+            case M86PD_ADDI:
+            case M86PD_SUBI:
+            case M86PD_MULI:
+            case M86PD_CMPI:
+                break;
+            case M86PD_JEI:
+            case M86PD_JNEI:
+            case M86PD_JLI:
+            case M86PD_JLEI:
+            case M86PD_JGI:
+            case M86PD_JGEI:
+                /* The single side exit, out of the loop. */
+                if (l->bottom || exits ||
+                        (((unsigned) di->operand >= head) &&
+                         ((unsigned) di->operand <= tail)))
+                    return false;
+                exits = true;
+                l->condition = di->handler;
+                break;
+            default:
+                return false;
+        }
+    }
+    return l->bottom || exits;
+}
+
+/* Work out the forms of loop by running an iteration symbolically;
+ * return false if the comparison the way out depends on is not set
+ * within the iteration.
+ */
+static bool m86lp_summarise(m86_loop *l)
+{
+    m86_loop_form *slots = l->next,
+                  cmp,
+                  operand;
+    const m86_loop_op *op;
+    unsigned int value;
+    bool tested = l->bottom;
+    memset(&cmp, 0, sizeof(m86_loop_form));
+    for (value = 0; value < l->num_slots; value++)
+    {
+        memset(slots + value, 0, sizeof(m86_loop_form));
+        slots[value].known = true;
+        slots[value].c[1 + value] = 1;
+    }
+    for (op = l->ops; op < l->ops + l->num_ops; op++)
+    {
+        m86lp_constant(&operand, op->operand);
+        switch (op->handler)
+        {
+            case M86PD_LOAD:
+                slots[0] = slots[op->operand];
+                break;
+            case M86PD_LOADI:
+                slots[0] = operand;
+                break;
+            case M86PD_STORE:
+            case M86PD_STORE_CODE:
+                slots[op->operand] = slots[0];
+                break;
+            case M86PD_ADD:
+                m86lp_add(slots, slots + op->operand, 1);
+                break;
+            case M86PD_ADDI:
+                m86lp_add(slots, &operand, 1);
+                break;
+            case M86PD_SUB:
+                m86lp_add(slots, slots + op->operand, ~0U);
+                break;
+            case M86PD_SUBI:
+                m86lp_add(slots, &operand, ~0U);
+                break;
+            case M86PD_MUL:
+                if (m86lp_is_constant(slots + op->operand,
+                            l->num_slots))
+                    m86lp_scale(slots, slots[op->operand].c[0]);
+                else if (m86lp_is_constant(slots, l->num_slots))
+                {
+                    value = slots[0].c[0];
+                    slots[0] = slots[op->operand];
+                    m86lp_scale(slots, value);
+                } else slots[0].known = false;
+                break;
+            case M86PD_MULI:
+                m86lp_scale(slots, op->operand);
+                break;
+            case M86PD_DIVI:
+            case M86PD_MODI:
+                slots[0].known = false;
+                break;
+            case M86PD_CMP:
+            case M86PD_CMPI:
+                /* The comparison left over at the end of an iteration
+                 * has to be the one the way out depends on. */
+                if (tested && !l->bottom) return false;
+                cmp = slots[0];
+                m86lp_add(&cmp, (op->handler == M86PD_CMP) ?
+                        slots + op->operand : &operand, ~0U);
+                break;
+            default:
+                l->test = cmp;
+                tested = true;
+                break;
+        }
+    }
+    if (l->bottom) l->test = cmp;
+    return l->test.known;
+}
+
+/* Return true if every slot the form depends on (but slot self, which
+ * it has to depend on with coefficient self_factor) is of a kind below
+ * specified kind.
+ */
+static bool m86lp_depends(
+        const m86_loop *l,
+        const m86_loop_form *f,
+        const unsigned int self,
+        const unsigned int self_factor,
+        const unsigned int kind)
+{
+    unsigned int i;
+    if (!f->known) return false;
+    for (i = 0; i < l->num_slots; i++)
+        if ((i == self) ? (f->c[1 + i] != self_factor) :
+                ((f->c[1 + i] != 0) &&
+                 ((l->kinds[i] == M86LP_UNKNOWN) ||
+                  (l->kinds[i] >= kind))))
+            return false;
+    return true;
+}
+
+/* Classify the slots of loop and check that its comparison only
+ * depends on counters; return true if the loop has a closed form.
+ */
+static bool m86lp_classify(m86_loop *l)
+{
+    unsigned int kind,
+                 i;
+    int c;
+    for (i = 0; i < l->num_slots; i++) l->kinds[i] = M86LP_UNKNOWN;
+    for (kind = M86LP_INVARIANT; kind <= M86LP_DERIVED; kind++)
+        for (i = 0; i < l->num_slots; i++)
+            if ((l->kinds[i] == M86LP_UNKNOWN) &&
+                    ((kind != M86LP_INVARIANT) ||
+                     (l->next[i].c[0] == 0)) &&
+                    m86lp_depends(l, l->next + i, i,
+                        (kind == M86LP_DERIVED) ? 0 : 1, kind))
+                l->kinds[i] = kind;
+    for (i = 0; i < l->num_slots; i++)
+    {
+        if (l->kinds[i] == M86LP_UNKNOWN) return false;
+        c = (int) l->test.c[1 + i];
+        if ((c < -M86LP_MAX_COEFFICIENT) || (c > M86LP_MAX_COEFFICIENT))
+            return false;
+    }
+    return m86lp_depends(l, &l->test, l->num_slots, 0,
+            M86LP_QUADRATIC);
+}
+
+/* Return the first iteration (counting from 0) whose comparison result
+ * value + iteration * step takes the conditional jump with specified
+ * handler (JLI, JLEI, JGI or JGEI), or M86LP_NEVER, provided that the
+ * comparison results do not wrap around.
+ */
+static unsigned long long m86lp_first(
+        const unsigned int handler,
+        const long long value,
+        const long long step)
+{
+    if (m86lp_taken(handler, value)) return 0;
+    switch (handler)
+    {
+        case M86PD_JLI:
+            if (step >= 0) break;
+            return value / -step + 1;
+        case M86PD_JLEI:
+            if (step >= 0) break;
+            return (value - step - 1) / -step;
+        case M86PD_JGI:
+            if (step <= 0) break;
+            return -value / step + 1;
+        default:
+            if (step <= 0) break;
+            return (step - value - 1) / step;
+    }
+    return M86LP_NEVER;
+}
+
+/* Return the first iteration (counting from 0) whose comparison result
+ * value + iteration * step, modulo 2^32, takes the conditional jump
+ * with specified handler (JEI or JNEI), or M86LP_NEVER.
+ */
+static unsigned long long m86lp_first_zero(
+        const unsigned int handler,
+        const unsigned int value,
+        const unsigned int step)
+{
+    unsigned int shift = 0,
+                 odd,
+                 inverse,
+                 i;
+    if (m86lp_taken(handler, (int) value)) return 0;
+    if (step == 0) return M86LP_NEVER;
+    if (handler == M86PD_JNEI) return 1;
+    /* Solve iteration * step = -value modulo 2^32: the odd part of step
+     * has an inverse (by Newton's method, doubling the number of bits
+     * right on each round), and the rest has to divide value. */
+    while (((step >> shift) & 1) == 0) shift++;
+    if ((value & ((1U << shift) - 1)) != 0) return M86LP_NEVER;
+    odd = step >> shift;
+    for (inverse = odd, i = 0; i < 4; i++) inverse *= 2 - odd * inverse;
+    return (((0U - value) >> shift) * inverse) & (~0U >> shift);
+}
+
+/* Return true if value and value + count * step are within the range
+ * of int values.
+ */
+static bool m86lp_in_range(
+        const long long value,
+        const long long step,
+        const unsigned long long count)
+{
+    const long long magnitude = (step < 0) ? -step : step;
+    long long end = value;
+    if ((value < INT_MIN) || (value > INT_MAX)) return false;
+    if (step == 0) return true;
+    /* Larger steps certainly leave the range. */
+    if (count > (0x400000000ULL / magnitude)) return false;
+    end += (long long) count * step;
+    return (end >= INT_MIN) && (end <= INT_MAX);
+}
+
+/* Return m * (m - 1) / 2, modulo 2^32.
+ */
+static unsigned int m86lp_triangle(const unsigned long long m)
+{
+    return (m % 2 == 0) ? (m / 2) * (m - 1) : m * ((m - 1) / 2);
+}
+
+/* Run up to limit iterations of loop in closed form, updating slot
+ * values and comparison result; return false if the closed form does
+ * not apply to these values, or else set the number of iterations run
+ * and whether the last one left the loop through its tail.
+ */
+static bool m86lp_closed(
+        const m86_loop *l,
+        unsigned int *values,
+        int *cmp,
+        const unsigned long limit,
+        unsigned long *iterations,
+        bool *left)
+{
+    unsigned int delta[M86LP_MAX_SLOTS],
+                 step[M86LP_MAX_SLOTS],
+                 before[M86LP_MAX_SLOTS],
+                 condition,
+                 i,
+                 j;
+    long long value = (int) l->test.c[0],
+              slope = 0;
+    unsigned long long first,
+                       last,
+                       n;
+    bool exact;
+    for (i = 0; i < l->num_slots; i++)
+    {
+        delta[i] = m86lp_eval(l->next + i, values, l->num_slots) -
+            values[i];
+        step[i] = 0;
+    }
+    for (i = 0; i < l->num_slots; i++)
+        for (j = 0; (l->kinds[i] == M86LP_QUADRATIC) &&
+                (j < l->num_slots); j++)
+            if (l->kinds[j] == M86LP_LINEAR)
+                step[i] += l->next[i].c[1 + j] * delta[j];
+    for (i = 0; i < l->num_slots; i++)
+    {
+        value += (long long) (int) l->test.c[1 + i] * (int) values[i];
+        slope += (long long) (int) l->test.c[1 + i] * (int) delta[i];
+    }
+    condition = l->bottom ? m86lp_negated(l->condition) : l->condition;
+    /* Equality does not care about wrapping around. */
+    exact = (condition == M86PD_JEI) || (condition == M86PD_JNEI);
+    first = exact ?
+        m86lp_first_zero(condition, (unsigned int) value,
+                (unsigned int) slope) :
+        m86lp_first(condition, value, slope);
+    if (first < limit)
+    {
+        last = first;
+        n = l->bottom ? first + 1 : first;
+        *left = l->bottom;
+    } else
+    {
+        last = limit - 1;
+        n = limit;
+        *left = false;
+    }
+    /* Other branches only go as worked out if nothing they depend on
+     * wraps around up to the last comparison. */
+    if (!exact && !m86lp_in_range(value, slope, last)) return false;
+    for (i = 0; !exact && (i < l->num_slots); i++)
+        if ((l->test.c[1 + i] != 0) &&
+                !m86lp_in_range((int) values[i], (int) delta[i], last))
+            return false;
+    *iterations = n;
+    if (n == 0) return true;
+    /* Values at the start of the last iteration; derived slots are not
+     * needed to run it. */
+    for (i = 0; i < l->num_slots; i++)
+        before[i] = values[i] + (unsigned int) (n - 1) * delta[i] +
+            m86lp_triangle(n - 1) * step[i];
+    *cmp = (int) m86lp_eval(&l->test, before, l->num_slots);
+    for (i = 0; i < l->num_slots; i++)
+        values[i] = m86lp_eval(l->next + i, before, l->num_slots);
+    return true;
+}
+
+/* Run up to limit iterations of loop one instruction at a time,
+ * updating slot values and comparison result; return the number of
+ * iterations run and set whether the last one left the loop through
+ * its tail.
+ */
+static unsigned long m86lp_iterate(
+        const m86_loop *l,
+        unsigned int *values,
+        int *cmp,
+        const unsigned long limit,
+        bool *left)
+{
+    const m86_loop_op *op,
+          *end = l->ops + l->num_ops;
+    unsigned int acc = values[0],
+                 saved_acc;
+    int result = *cmp,
+        saved_cmp;
+    unsigned long n;
+    *left = false;
+    for (n = 0; n < limit; n++)
+    {
+        saved_acc = acc;
+        saved_cmp = result;
+        for (op = l->ops; op < end; op++)
+        {
+            switch (op->handler)
+            {
+                case M86PD_LOAD:
+                    acc = values[op->operand];
+                    break;
+                case M86PD_LOADI:
+                    acc = op->operand;
+                    break;
+                case M86PD_STORE:
+                case M86PD_STORE_CODE:
+                    values[op->operand] = acc;
+                    break;
+                case M86PD_ADD:
+                    acc += values[op->operand];
+                    break;
+                case M86PD_ADDI:
+                    acc += op->operand;
+                    break;
+                case M86PD_SUB:
+                    acc -= values[op->operand];
+                    break;
+                case M86PD_SUBI:
+                    acc -= op->operand;
+                    break;
+                case M86PD_MUL:
+                    acc *= values[op->operand];
+                    break;
+                case M86PD_MULI:
+                    acc *= op->operand;
+                    break;
+                case M86PD_DIVI:
+                    acc = (int) acc / op->operand;
+                    break;
+                case M86PD_MODI:
+                    acc = (int) acc % op->operand;
+                    break;
+                case M86PD_CMP:
+                    result = acc - values[op->operand];
+                    break;
+                case M86PD_CMPI:
+                    result = acc - op->operand;
+                    break;
+                default:
+                    /* Nothing is stored before the side exit. */
+                    if (m86lp_taken(op->handler, result))
+                    {
+                        acc = saved_acc;
+                        result = saved_cmp;
+                        goto done;
+                    }
+                    break;
+            }
+        }
+        if (l->bottom && !m86lp_taken(l->condition, result))
+        {
+            n++;
+            *left = true;
+            break;
+        }
+    }
+done:
+    values[0] = acc;
+    *cmp = result;
+    return n;
+}
+
+/* m86lp_init: recognise the loops of a pre-decoded program.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to m86_loops variable.
+ * # pointer to m86_predecoded_program variable.
+ * # unsigned value for memory size.
+ *
+ * Note: the records of the program must be up to date; the loop field
+ * of the records at loop heads is set. Loops are discarded, one at a
+ * time, once their instructions are modified.
+ *
+ * Note: to avoid memory leaks, m86lp_kill() should be called once the
+ * loops are no longer needed.
+ *
+ * Returns: bool value to indicate status of recognition; true =
+ * success, false = failure (i.e., not enough memory, in which case no
+ * loops are recognised).
+ */
+bool m86lp_init(
+        m86_loops *loops,
+        m86_predecoded_program *program,
+        const unsigned int mem_size)
+{
+    const m86_predecoded_instruct *di;
+    unsigned int count = 0,
+                 head,
+                 tail;
+    bool *reachable;
+    m86_loop *l;
+    loops->loops = NULL;
+    loops->count = 0;
+    if (program->size == 0) return true;
+    for (di = program->code; di < program->code + program->size; di++)
+        if ((di->handler >= M86PD_JMPI) && (di->handler <= M86PD_JGEI))
+            count++;
+    if (count == 0) return true;
+    reachable = m86pd_reachable(program);
+    loops->loops = malloc(count * sizeof(m86_loop));
+    if ((reachable == NULL) || (loops->loops == NULL))
+    {
+        free(reachable);
+        m86lp_kill(loops);
+        return false;
+    }
+    for (tail = 0; tail < program->size; tail++)
+    {
+        di = program->code + tail;
+        head = (unsigned int) di->operand;
+        if ((di->handler < M86PD_JMPI) || (di->handler > M86PD_JGEI) ||
+                (di->operand < 0) || (head > tail) ||
+                (tail - head >= M86LP_MAX_LEN) ||
+                (program->code[head].loop != 0))
+            continue;
+        l = loops->loops + loops->count;
+        if (!m86lp_recognise(l, program, reachable, mem_size,
+                    head, tail))
+            continue;
+        l->closed = m86lp_summarise(l) && m86lp_classify(l);
+        program->code[head].loop = ++loops->count;
+    }
+    free(reachable);
+    return true;
+}
+
+/* m86lp_run: run whole iterations of the loop headed by the record at
+ * the instruction pointer.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to m86_loops variable.
+ * # pointer to m86_predecoded_program variable.
+ * # memory variable.
+ * # pointer to m86_loop_state variable.
+ * # unsigned long value for the number of instructions left to
+ * execute.
+ *
+ * Note: no iterations are run if the record at the instruction pointer
+ * heads no loop, if the instructions of the loop were modified, or if
+ * a breakpoint is set within it (see m86pd_break()). The
+ * records of cells in the code region are re-decoded (see
+ * m86pd_update()) after running.
+ *
+ * Returns: unsigned long value for the number of instructions left to
+ * execute after the iterations run.
+ */
+unsigned long m86lp_run(
+        const m86_loops *loops,
+        m86_predecoded_program *program,
+        memory mem,
+        m86_loop_state *state,
+        unsigned long budget)
+{
+    unsigned int index = (state->ip < program->size) ?
+        program->code[state->ip].loop : 0,
+                 values[M86LP_MAX_SLOTS],
+                 length,
+                 i;
+    unsigned long limit,
+                  n;
+    const m86_loop *l;
+    bool left;
+    if ((index == 0) || (index > loops->count)) return budget;
+    l = loops->loops + (index - 1);
+    length = l->tail - l->head + 1;
+    if ((limit = budget / length) == 0) return budget;
+    for (i = 0; i < length; i++)
+        if ((program->code[l->head + i].word != l->words[i]) ||
+                (program->code[l->head + i].handler == M86PD_END))
+            return budget;
+    values[0] = state->acc;
+    for (i = 1; i < l->num_slots; i++) values[i] = mem[l->cells[i]];
+    if (!l->closed ||
+            !m86lp_closed(l, values, &state->cmp, limit, &n, &left))
+        n = m86lp_iterate(l, values, &state->cmp, limit, &left);
+    if (n == 0) return budget;
+    state->acc = values[0];
+    for (i = 1; i < l->num_slots; i++)
+    {
+        if (!l->stored[i]) continue;
+        mem[l->cells[i]] = values[i];
+        m86pd_update(program, l->cells[i], values[i]);
+    }
+    state->ip = left ? l->tail + 1 : l->head;
+    state->last = l->tail;
+    return budget - n * length;
+}
+
+/* m86lp_kill: release resources held by loops.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to m86_loops variable.
+ *
+ * Note: passing NULL results in no operation being performed.
+ *
+ * Returns: N/A.
+ */
+void m86lp_kill(m86_loops *loops)
+{
+    if (loops == NULL) return;
+    free(loops->loops);
+    loops->loops = NULL;
+    loops->count = 0;
+    return;
+}
+
+/* EOF. */
@@ -0,0 +1,257 @@
+/* micro86_loop:
+ *
+ * Loop kernels for the micro86 emulator: counted loops recognised in
+ * the loaded program and run as a whole instead of one instruction at
+ * a time.
+ *
+ * A loop is recognised from a jump back to a head at or before it (the
+ * tail), provided the instructions from the head to the tail are
+ * straight-line code made up of LOAD, LOADI, STORE, ADD, ADDI, SUB,
+ * SUBI, MUL, MULI, CMP, CMPI, DIVI and MODI (the last two by anything
+ * but zero) and of a single way out: either one conditional jump out
+ * of the loop followed, further down, by an unconditional tail, or a
+ * conditional tail. Loops that contain anything else (notably IN, OUT,
+ * HALT, DIV and MOD), that use memory operands outside memory bounds,
+ * that store before their way out, or that store into code reachable
+ * from position 0 (e.g., into their own instructions) are left to the
+ * engines. Memory operands are static, so the memory units a loop uses
+ * (its cells) cannot alias one another.
+ *
+ * Each loop is first summarised symbolically: the value of every cell
+ * and of the accumulator at the end of an iteration, and the
+ * comparison deciding whether to leave, as affine forms (modulo 2^32)
+ * of their values at the start of the iteration. Loops whose counters
+ * step by a constant (e.g., accumulating by ADD over a counter, or
+ * dividing by repeated subtraction) have closed forms: the number of
+ * iterations before leaving is worked out with a single division and
+ * the cells are updated in O(1). The closed form is only used when the
+ * counters provably do not wrap around before leaving; all other loops
+ * (e.g., accumulating by MUL, as in factorials) run as a tight loop
+ * over a compact copy of their instructions, with cells held in
+ * locals and written back once at the end.
+ *
+ * Either way, a kernel only runs whole iterations and stops as soon as
+ * the next one would leave the loop through its side exit (which the
+ * engine then runs as usual), leave the loop through its tail, or not
+ * be covered by the instruction budget; the machine ends up in exactly
+ * the state that running the instructions one at a time would leave
+ * it in.
+ */
+
+#ifndef _STDBOOL_H
+#include <stdbool.h>
+#endif
+
+#ifndef MICRO86PREDECODE_H
+#include "micro86_predecode.h"
+#endif
+
+#ifndef MICRO86LOOP_H
+#define MICRO86LOOP_H
+
+/* M86LP_MAX_LEN: maximum number of instructions of a loop, including
+ * its tail.
+ */
+#define M86LP_MAX_LEN 32
+
+/* M86LP_MAX_SLOTS: maximum number of slots of a loop, i.e., the
+ * accumulator (always slot 0) and the cells it uses.
+ */
+#define M86LP_MAX_SLOTS 8
+
+/* Kinds of slots, according to how their values change from one
+ * iteration to the next (see m86_loop).
+ *
+ * # M86LP_UNKNOWN: none of the others.
+ * # M86LP_INVARIANT: unchanged.
+ * # M86LP_LINEAR: incremented by the same value on each iteration,
+ * which only depends on M86LP_INVARIANT slots (e.g., counters).
+ * # M86LP_QUADRATIC: incremented by the value of M86LP_INVARIANT and
+ * M86LP_LINEAR slots (e.g., sums over counters).
+ * # M86LP_DERIVED: set from other slots (that are not M86LP_DERIVED)
+ * regardless of its own value (e.g., the accumulator reloaded from a
+ * counter).
+ */
+#define M86LP_UNKNOWN   0
+#define M86LP_INVARIANT 1
+#define M86LP_LINEAR    2
+#define M86LP_QUADRATIC 3
+#define M86LP_DERIVED   4
+
+/* Type: m86_loop_op.
+ *
+ * A single instruction of a loop consisting of the following:
+ *
+ * # handler: handler index (see micro86_predecode.h).
+ * # operand: immediate operand, or slot index for memory operands.
+ */
+typedef struct
+{
+    unsigned int handler;
+    int operand;
+} m86_loop_op;
+
+/* Type: m86_loop_form.
+ *
+ * An affine form of the values of the slots of a loop at the start of
+ * an iteration, consisting of the following:
+ *
+ * # known: whether the value is an affine form of slots at all (e.g.,
+ * products of two slots are not).
+ * # c: constant term (c[0]) and coefficient of each slot (c[1 + slot
+ * index]), all modulo 2^32.
+ */
+typedef struct
+{
+    bool known;
+    unsigned int c[M86LP_MAX_SLOTS + 1];
+} m86_loop_form;
+
+/* Type: m86_loop.
+ *
+ * A recognised loop consisting of the following:
+ *
+ * # head: position of the first instruction.
+ * # tail: position of the jump back to head.
+ * # num_slots: number of slots.
+ * # cells: memory position of each slot but slot 0.
+ * # stored: whether each slot is stored into by the loop.
+ * # ops: instructions from head up to, but excluding, tail.
+ * # num_ops: number of instructions in ops (i.e., tail - head).
+ * # words: encoded instructions from head up to and including tail,
+ * as they were when the loop was recognised.
+ * # bottom: whether tail is a conditional jump (i.e., the way out of
+ * the loop), rather than JMPI.
+ * # condition: handler of the conditional jump leaving the loop, or of
+ * tail if bottom.
+ * # closed: whether the loop has a closed form, in which case the
+ * fields below are meaningful.
+ * # kinds: kind of each slot (one of the M86LP_* values above).
+ * # next: value of each slot at the end of an iteration.
+ * # test: comparison result the way out depends on.
+ *
+ * # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # #
+ * WARNING: m86_loop fields should not be modified directly. The
+ * functions declared below are to be used for such purposes.
+ * # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # #
+ */
+typedef struct
+{
+    unsigned int head,
+                 tail,
+                 num_slots,
+                 cells[M86LP_MAX_SLOTS];
+    bool stored[M86LP_MAX_SLOTS];
+    m86_loop_op ops[M86LP_MAX_LEN];
+    unsigned int num_ops;
+    m86_encoded_instruct words[M86LP_MAX_LEN];
+    bool bottom;
+    unsigned int condition;
+    bool closed;
+    unsigned int kinds[M86LP_MAX_SLOTS];
+    m86_loop_form next[M86LP_MAX_SLOTS],
+                  test;
+} m86_loop;
+
+/* Type: m86_loops.
+ *
+ * The loops recognised in a program, consisting of the following:
+ *
+ * # loops: array of loops (NULL if none).
+ * # count: number of loops.
+ *
+ * Note: the loop field of the record at the head of each loop is set
+ * to its index in loops plus one (see micro86_predecode.h).
+ */
+typedef struct
+{
+    m86_loop *loops;
+    unsigned int count;
+} m86_loops;
+
+/* Type: m86_loop_state.
+ *
+ * Machine state passed to and returned by m86lp_run(), consisting of
+ * the following:
+ *
+ * # acc: accumulator register.
+ * # cmp: result of the latest comparison (see m86_get_flags_cmp()).
+ * # ip: instruction pointer register (i.e., the head of a loop on
+ * entry, and the position to go on from on return).
+ * # last: position of the last instruction run (only set if any).
+ */
+typedef struct
+{
+    int acc,
+        cmp;
+    unsigned int ip,
+                 last;
+} m86_loop_state;
+
+/* m86lp_init: recognise the loops of a pre-decoded program.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to m86_loops variable.
+ * # pointer to m86_predecoded_program variable.
+ * # unsigned value for memory size.
+ *
+ * Note: the records of the program must be up to date; the loop field
+ * of the records at loop heads is set. Loops are discarded, one at a
+ * time, once their instructions are modified.
+ *
+ * Note: to avoid memory leaks, m86lp_kill() should be called once the
+ * loops are no longer needed.
+ *
+ * Returns: bool value to indicate status of recognition; true =
+ * success, false = failure (i.e., not enough memory, in which case no
+ * loops are recognised).
+ */
+bool m86lp_init(
+        m86_loops*,
+        m86_predecoded_program*,
+        const unsigned int);
+
+/* m86lp_run: run whole iterations of the loop headed by the record at
+ * the instruction pointer.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to m86_loops variable.
+ * # pointer to m86_predecoded_program variable.
+ * # memory variable.
+ * # pointer to m86_loop_state variable.
+ * # unsigned long value for the number of instructions left to
+ * execute.
+ *
+ * Note: no iterations are run if the record at the instruction pointer
+ * heads no loop, if the instructions of the loop were modified, or if
+ * a breakpoint is set within it (see m86pd_break()). The
+ * records of cells in the code region are re-decoded (see
+ * m86pd_update()) after running.
+ *
+ * Returns: unsigned long value for the number of instructions left to
+ * execute after the iterations run.
+ */
+unsigned long m86lp_run(
+        const m86_loops*,
+        m86_predecoded_program*,
+        memory,
+        m86_loop_state*,
+        unsigned long);
+
+/* m86lp_kill: release resources held by loops.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to m86_loops variable.
+ *
+ * Note: passing NULL results in no operation being performed.
+ *
+ * Returns: N/A.
+ */
+void m86lp_kill(m86_loops*);
+
+#endif
+
+/* EOF. */
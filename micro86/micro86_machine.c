@@ -0,0 +1,1747 @@
+/* micro86_machine:
+ *
+ * A resumable micro86 machine: processor, memory and pre-decoded
+ * program, together with the execution engines that run it.
+ *
+ * m86_run() runs a machine for a bounded number of instructions and
+ * returns the reason it stopped, so that a host can time-slice many
+ * programs in one process and resume each of them later on. A program
+ * executing IN on a machine without an input stream stops until the
+ * host provides a byte with m86_provide_input().
+ *
+ * Errors (e.g., memory violations) are reported as in the rest of the
+ * emulator: a message and a post-mortem dump are printed, and the
+ * process exits only if the error code of the machine is EXIT_FAILURE;
+ * otherwise, the machine stops for good with M86_STOP_ERROR.
+ */
+
+#ifndef _STDLIB_H
+#include <stdlib.h>
+#endif
+
+#ifndef _LIMITS_H
+#include <limits.h>
+#endif
+
+#ifndef _STRING_H
+#include <string.h>
+#endif
+
+#ifndef COMMONERR_H
+#include "common/common_err.h"
+#endif
+
+#ifndef COMMONIO_H
+#include "common/common_io.h"
+#endif
+
+#ifndef MICRO86COMMON_H
+#include "micro86_common.h"
+#endif
+
+#ifndef MICRO86DATASET_H
+#include "micro86_dataset.h"
+#endif
+
+#ifndef MICRO86_H
+#include "micro86.h"
+#endif
+
+#ifndef MICRO86MACHINE_H
+#include "micro86_machine.h"
+#endif
+
+/* M86_STOP_NONE: stop reason of an engine that returns without the
+ * machine having stopped (e.g., an engine for verified programs once
+ * the program is no longer verified); m86_run() then carries on with
+ * another engine and never returns it.
+ */
+#define M86_STOP_NONE 5
+
+/* M86_NO_INPUT: value of pending input when no byte has been provided
+ * (distinct from EOF and from any unsigned char value).
+ */
+#define M86_NO_INPUT (EOF - 1)
+
+/* Print out contents of memory.
+ */
+static void m86_print_memory(
+        const memory micro86_memory,
+        const unsigned int size,
+        FILE *stream)
+{
+    if (stream == NULL) return;
+    fprintf(stream, "\nMEMORY:\n\n");
+    m_print_memory(micro86_memory, 0, size, stream);
+    return;
+}
+
+/* Print out contents of cpu.
+ */
+static void m86_print_cpu(
+        const micro86_proc micro86_cpu,
+        FILE *stream)
+{
+    if (stream == NULL) return;
+    fprintf(stream, "\nCPU:\n\n");
+    m86_print_proc(micro86_cpu, stream);
+    return;
+}
+
+/* m86_postmortem_dump: print out contents of cpu and memory.
+ *
+ * Parameters (in order):
+ *
+ * # micro86_proc variable.
+ * # memory variable.
+ * # unsigned value for memory size.
+ * # pointer to FILE variable for output.
+ *
+ * Returns: N/A.
+ */
+void m86_postmortem_dump(
+        const micro86_proc micro86_cpu,
+        const memory micro86_memory,
+        const unsigned int size,
+        FILE *stream)
+{
+    fprintf(stream, "\n=== POST-MORTEM DUMP ===\n");
+    m86_print_cpu(micro86_cpu, stream);
+    m86_print_memory(micro86_memory, size, stream);
+    return;
+}
+
+/* m86_error: print out error message and post-mortem dump, and exit if
+ * error code is EXIT_FAILURE.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to FILE variable for output.
+ * # string for error message.
+ * # integer for error code.
+ * # micro86_proc variable.
+ * # memory variable.
+ * # unsigned value for memory size.
+ *
+ * Returns: N/A.
+ */
+void m86_error(
+        FILE *stream,
+        const char *message,
+        const int error_code,
+        const micro86_proc micro86_cpu,
+        const memory micro86_memory,
+        const unsigned int mem_size)
+{
+    fprintf(stream, "%s\n", message);
+    m86_postmortem_dump(micro86_cpu,
+            micro86_memory, mem_size, stream);
+    exit_on_exit_fail(error_code, error_code);
+    return;
+}
+
+/* Check if divisor is zero and report an error if it is; return true
+ * if an error was reported.
+ */
+static bool m86_check_zero_div_error(
+        int divisor,
+        FILE *stream,
+        const int error_code,
+        const micro86_proc micro86_cpu,
+        const memory micro86_memory,
+        const unsigned int mem_size)
+{
+    if (divisor != 0) return false;
+    m86_error(stream, "Micro86 ERROR: division by zero!",
+            error_code, micro86_cpu, micro86_memory, mem_size);
+    return true;
+}
+
+/* Check if there is a program in memory and report an error if there
+ * isn't; return true if an error was reported.
+ */
+static bool m86_check_no_prgm_error(
+        const unsigned int program_size,
+        FILE *stream,
+        const int error_code,
+        const micro86_proc micro86_cpu,
+        const memory micro86_memory,
+        const unsigned int mem_size)
+{
+    if (program_size != 0) return false;
+    m86_error(stream, "Micro86 ERROR: no program in memory!",
+            error_code, micro86_cpu, micro86_memory, mem_size);
+    return true;
+}
+
+/* Check memory bounds and report an error if violated; return true if
+ * an error was reported.
+ */
+static bool m86_check_memory_bounds(
+        const int position,
+        FILE *stream,
+        const int error_code,
+        const micro86_proc micro86_cpu,
+        const memory micro86_memory,
+        const unsigned int mem_size)
+{
+    if ((position >= 0) && ((unsigned) position <= mem_size))
+        return false;
+    memory_bounds_error(STD_ERR_DEST, position, 0);
+    m86_error(stream, "Micro86 ERROR: memory violation!",
+            error_code, micro86_cpu, micro86_memory, mem_size);
+    return true;
+}
+
+/* Return true if instruction argument is a jump instruction;
+ * otherwise, return false.
+ */
+static bool is_jmp_instruct(const m86_decoded_instruct di)
+{
+    switch (di.opcode)
+    {
+        case JMPI:
+        case JEI:
+        case JNEI:
+        case JLI:
+        case JLEI:
+        case JGI:
+        case JGEI:  return true;
+        default:    break;
+    }
+    return false;
+}
+
+/* Print out disassembled instruction; return true if an error was
+ * reported. */
+static bool m86_disassemble(
+        FILE *stream,
+        const micro86_proc micro86_cpu,
+        const memory micro86_memory,
+        const unsigned int mem_size,
+        const int word,
+        const int error_code)
+{
+    bool has_operand = false,
+         nonjmp_immediate = false;
+    const m86_decoded_instruct di = m86_ei_decoded(word);
+    char *output = malloc(sizeof(char) * M86_PRINT_FORMAT_SIZE);
+    if (m86_di_is_valid_instruct(di))
+    {
+        output = m86ds_get_mnemonic(di.opcode);
+        if (m86_di_instruct_has_operand(di)) has_operand = true;
+        if (m86_di_instruct_is_immediate(di) &&
+                !(is_jmp_instruct(di))) nonjmp_immediate = true;
+    } else sprintf(output, M86_PRINT_FORMAT, word);
+    if (has_operand)
+    {
+        if (m86_check_memory_bounds(di.operand, STD_ERR_DEST,
+                    error_code, micro86_cpu, micro86_memory, mem_size))
+            return true;
+        if (nonjmp_immediate)
+            fprintf(stream, "%s\t\t"
+                    M86_PRINT_FORMAT "\n", output, di.operand);
+        else
+            fprintf(stream, "%s\t\t" M86_PRINT_FORMAT "\t\t|"
+                    M86_PRINT_FORMAT ": " M86_PRINT_FORMAT "|\n",
+                    output, di.operand, di.operand,
+                    m_get_value(micro86_memory, di.operand));
+    } else fprintf(stream, "%s\n", output);
+    return false;
+}
+
+/* m86_disassembly: print out disassembled code in memory.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to FILE variable for output.
+ * # micro86_proc variable (for error dumps).
+ * # memory variable.
+ * # unsigned value for memory size.
+ * # unsigned value for program size.
+ * # integer for error code.
+ *
+ * Note: the mnemonic dataset (see micro86_dataset.h) must be
+ * initialized.
+ *
+ * Returns: bool value to indicate whether an error was reported
+ * (i.e., no program or operand out of memory bounds); true = error,
+ * false = no error.
+ */
+bool m86_disassembly(
+        FILE *stream,
+        const micro86_proc micro86_cpu,
+        const memory micro86_memory,
+        const unsigned int mem_size,
+        const unsigned int program_size,
+        const int error_code)
+{
+    if (m86_check_no_prgm_error(program_size, STD_ERR_DEST,
+                error_code, micro86_cpu, micro86_memory, mem_size))
+        return true;
+    unsigned int i;
+    fprintf(stream, "\n=== DISASSEMBLED CODE ===\n\n");
+    for (i = 0; i < program_size; i++)
+    {
+        if (m86_check_memory_bounds(i, STD_ERR_DEST, error_code,
+                    micro86_cpu, micro86_memory, mem_size))
+            return true;
+        fprintf(stream, M86_PRINT_FORMAT ":\t", i);
+        if (m86_disassemble(stream, micro86_cpu,
+                    micro86_memory, mem_size,
+                    m_get_value(micro86_memory, i), error_code))
+            return true;
+    }
+    return false;
+}
+
+/* Print out the execution trace line of the instruction in the
+ * instruction register of the cpu; return true if an error was
+ * reported.
+ */
+static bool m86_print_trace(
+        FILE *stream,
+        const micro86_proc micro86_cpu,
+        const memory micro86_memory,
+        const unsigned int mem_size,
+        const int error_code)
+{
+    fprintf(stream, M86_PRINT_FORMAT ":\t",
+            m86_get_ip_reg(micro86_cpu) - 1);
+    if (m86_disassemble(stream, micro86_cpu, micro86_memory, mem_size,
+                m86_get_ir_reg(micro86_cpu), error_code))
+        return true;
+    fprintf(stream, "\t\t");
+    m86_print_proc(micro86_cpu, stream);
+    return false;
+}
+
+/* Write register values held in locals back to the cpu.
+ */
+static void m86_store_regs(
+        micro86_proc *micro86_cpu,
+        const int acc,
+        const int cmp,
+        const unsigned int ip,
+        const unsigned int ir)
+{
+    m86_set_acc_reg(micro86_cpu, acc);
+    m86_set_ip_reg(micro86_cpu, ip);
+    m86_set_ir_reg(micro86_cpu, ir);
+    m86_set_flags_cmp(micro86_cpu, cmp);
+    return;
+}
+
+/* Return the byte to be read by IN: the byte provided by the host if
+ * any, else the next byte of the input stream of the machine (EOF if
+ * there is none left); M86_NO_INPUT if the machine has to wait for the
+ * host to provide one.
+ */
+static int m86_read_input(micro86_machine *m)
+{
+    int input = m->pending_input;
+    if (input != M86_NO_INPUT)
+    {
+        m->pending_input = M86_NO_INPUT;
+        return input;
+    }
+    if (m->input == NULL) return M86_NO_INPUT;
+    return fgetc(m->input);
+}
+
+/* Write byte to the output stream, as OUT does, and to the transcript
+ * of the run if it is recorded (see micro86_replay.h).
+ */
+static void m86_write_output(
+        const micro86_machine *m,
+        const unsigned char byte)
+{
+    fprintf(m->output, "%c\n", byte);
+    if (m->record_ready) fprintf(m->record.transcript, "%c\n", byte);
+    return;
+}
+
+/* Report that input cannot be read.
+ */
+static void m86_input_error(const micro86_machine *m)
+{
+    file_read_error(STD_ERR_DEST, "'STD_IN_SRC'", 0);
+    m86_error(STD_ERR_DEST, "Micro86 ERROR: cannot read input!",
+            m->error_code, m->cpu, m->mem, m->mem_size);
+    return;
+}
+
+/* Report an invalid instruction, or a memory operand out of bounds
+ * if the record is trapped (see m86pd_trapped()).
+ */
+static void m86_invalid_error(
+        const micro86_machine *m,
+        const m86_predecoded_instruct *di)
+{
+    if (m86pd_trapped(di))
+    {
+        m86_check_memory_bounds(di->operand, STD_ERR_DEST,
+                m->error_code, m->cpu, m->mem, m->mem_size);
+        return;
+    }
+    m86_invalid_opcode_error(STD_ERR_DEST, di->opcode, 0);
+    m86_error(STD_ERR_DEST, "Micro86 ERROR: invalid instruction!",
+            m->error_code, m->cpu, m->mem, m->mem_size);
+    return;
+}
+
+/* Execute the pre-decoded instruction and return the stop reason
+ * (M86_STOP_NONE if the machine did not stop).
+ *
+ * Note: this is the reference implementation of a single cycle, used
+ * by engines that leave some instructions to it; m86_run() runs the
+ * specialised loops of micro86_engine.h instead.
+ */
+static unsigned int execute(
+        micro86_machine *m,
+        const m86_predecoded_instruct *di)
+{
+    micro86_proc *micro86_cpu = &m->cpu;
+    memory *micro86_memory = &m->mem;
+    const unsigned int mem_size = m->mem_size;
+    int value;
+
+/* Check memory bounds of the operand. */
+#define CHECK_BOUNDS() \
+    if (m86_check_memory_bounds(di->operand, STD_ERR_DEST, \
+                m->error_code, *micro86_cpu, *micro86_memory, \
+                mem_size)) \
+        return M86_STOP_ERROR
+
+/* Check that divisor is not zero. */
+#define CHECK_DIVISOR(divisor) \
+    if (m86_check_zero_div_error((divisor), STD_ERR_DEST, \
+                m->error_code, *micro86_cpu, *micro86_memory, \
+                mem_size)) \
+        return M86_STOP_ERROR
+
+    switch (di->handler)
+    {
+        case M86PD_HALT:
+            return M86_STOP_HALTED;
+        case M86PD_LOAD:
+            CHECK_BOUNDS();
+            m86_set_acc_reg(micro86_cpu,
+                    m_get_value(*micro86_memory, di->operand));
+            break;
+        case M86PD_LOADI:
+            m86_set_acc_reg(micro86_cpu, di->operand);
+            break;
+        case M86PD_STORE:
+            CHECK_BOUNDS();
+            m_set_value(micro86_memory, di->operand,
+                    m86_get_acc_reg(*micro86_cpu));
+            break;
+        case M86PD_STORE_CODE:
+            CHECK_BOUNDS();
+            m_set_value(micro86_memory, di->operand,
+                    m86_get_acc_reg(*micro86_cpu));
+            m86pd_update(&m->program, di->operand,
+                    m86_get_acc_reg(*micro86_cpu));
+            break;
+        case M86PD_ADD:
+            CHECK_BOUNDS();
+            m86_set_acc_reg(micro86_cpu,
+                    m86_get_acc_reg(*micro86_cpu)
+                    + m_get_value(*micro86_memory, di->operand));
+            break;
+        case M86PD_ADDI:
+            m86_set_acc_reg(micro86_cpu,
+                    m86_get_acc_reg(*micro86_cpu) + di->operand);
+            break;
+        case M86PD_SUB:
+            CHECK_BOUNDS();
+            m86_set_acc_reg(micro86_cpu,
+                    m86_get_acc_reg(*micro86_cpu)
+                    - m_get_value(*micro86_memory, di->operand));
+            break;
+        case M86PD_SUBI:
+            m86_set_acc_reg(micro86_cpu,
+                    m86_get_acc_reg(*micro86_cpu) - di->operand);
+            break;
+        case M86PD_MUL:
+            CHECK_BOUNDS();
+            m86_set_acc_reg(micro86_cpu,
+                    m86_get_acc_reg(*micro86_cpu)
+                    * m_get_value(*micro86_memory, di->operand));
+            break;
+        case M86PD_MULI:
+            m86_set_acc_reg(micro86_cpu,
+                    m86_get_acc_reg(*micro86_cpu) * di->operand);
+            break;
+        case M86PD_DIV:
+            CHECK_BOUNDS();
+            value = m_get_value(*micro86_memory, di->operand);
+            CHECK_DIVISOR(value);
+            m86_set_acc_reg(micro86_cpu,
+                    m86_get_acc_reg(*micro86_cpu) / value);
+            break;
+        case M86PD_DIVI:
+            CHECK_DIVISOR(di->operand);
+            m86_set_acc_reg(micro86_cpu,
+                    m86_get_acc_reg(*micro86_cpu) / di->operand);
+            break;
+        case M86PD_MOD:
+            CHECK_BOUNDS();
+            value = m_get_value(*micro86_memory, di->operand);
+            CHECK_DIVISOR(value);
+            m86_set_acc_reg(micro86_cpu,
+                    m86_get_acc_reg(*micro86_cpu) % value);
+            break;
+        case M86PD_MODI:
+            CHECK_DIVISOR(di->operand);
+            m86_set_acc_reg(micro86_cpu,
+                    m86_get_acc_reg(*micro86_cpu) % di->operand);
+            break;
+        case M86PD_CMP:
+            CHECK_BOUNDS();
+            m86_set_flags_cmp(micro86_cpu,
+                    m86_get_acc_reg(*micro86_cpu)
+                    - m_get_value(*micro86_memory, di->operand));
+            break;
+        case M86PD_CMPI:
+            m86_set_flags_cmp(micro86_cpu,
+                    m86_get_acc_reg(*micro86_cpu) - di->operand);
+            break;
+        case M86PD_JMPI:
+            m86_set_ip_reg(micro86_cpu, di->operand);
+            break;
+        case M86PD_JEI:
+            if (m86_get_flags_cmp(*micro86_cpu) == 0)
+                m86_set_ip_reg(micro86_cpu, di->operand);
+            break;
+        case M86PD_JNEI:
+            if (m86_get_flags_cmp(*micro86_cpu) != 0)
+                m86_set_ip_reg(micro86_cpu, di->operand);
+            break;
+        case M86PD_JLI:
+            if (m86_get_flags_cmp(*micro86_cpu) < 0)
+                m86_set_ip_reg(micro86_cpu, di->operand);
+            break;
+        case M86PD_JLEI:
+            if (m86_get_flags_cmp(*micro86_cpu) <= 0)
+                m86_set_ip_reg(micro86_cpu, di->operand);
+            break;
+        case M86PD_JGI:
+            if (m86_get_flags_cmp(*micro86_cpu) > 0)
+                m86_set_ip_reg(micro86_cpu, di->operand);
+            break;
+        case M86PD_JGEI:
+            if (m86_get_flags_cmp(*micro86_cpu) >= 0)
+                m86_set_ip_reg(micro86_cpu, di->operand);
+            break;
+        case M86PD_IN:
+            if ((value = m86_read_input(m)) == M86_NO_INPUT)
+            {
+                m86_set_ip_reg(micro86_cpu,
+                        m86_get_ip_reg(*micro86_cpu) - 1);
+                return M86_STOP_INPUT;
+            }
+            if (value == EOF)
+            {
+                m86_input_error(m);
+                return M86_STOP_ERROR;
+            }
+            m86_set_acc_reg(micro86_cpu, (unsigned char) value);
+            break;
+        case M86PD_OUT:
+            m86_write_output(m,
+                    (unsigned char) m86_get_acc_reg(*micro86_cpu));
+            break;
+        default:
+            m86_invalid_error(m, di);
+            return M86_STOP_ERROR;
+    }
+    return M86_STOP_NONE;
+
+#undef CHECK_BOUNDS
+#undef CHECK_DIVISOR
+}
+
+/* Fetch the next pre-decoded instruction and update the instruction
+ * pointer and instruction registers accordingly; return NULL if an
+ * error was reported (i.e., the instruction pointer is past the end of
+ * the program).
+ *
+ * Note: the program is never empty here; m86_run() checks for an
+ * empty program before entering the FDE cycle.
+ */
+static const m86_predecoded_instruct *fetch(micro86_machine *m)
+{
+    micro86_proc *micro86_cpu = &m->cpu;
+    const m86_predecoded_program *program = &m->program;
+    unsigned int ip = m86_get_ip_reg(*micro86_cpu);
+    const m86_predecoded_instruct *di =
+        program->code + ((ip < program->size) ? ip : program->size);
+    if (di->handler == M86PD_END)
+    {
+        if (ip >= m->mem_size)
+        {
+            memory_bounds_error(STD_ERR_DEST, ip, 0);
+            m86_error(STD_ERR_DEST, "Micro86 ERROR: memory violation!",
+                    m->error_code, *micro86_cpu, m->mem, m->mem_size);
+            return NULL;
+        }
+        m86_set_ip_reg(micro86_cpu, (ip + 1));
+        m86_error(STD_ERR_DEST,
+                "Micro86 ERROR: program end reached!",
+                m->error_code, *micro86_cpu, m->mem, m->mem_size);
+        return NULL;
+    }
+    m86_set_ip_reg(micro86_cpu, (ip + 1));
+    m86_set_ir_reg(micro86_cpu, di->word);
+    return di;
+}
+
+/* Specialised FDE cycles (see micro86_engine.h); included here as they
+ * rely on the static helpers above.
+ */
+#define M86E_NAME m86_run_checked
+#define M86E_TRACE 0
+#define M86E_CHECKED 1
+#include "micro86_engine.h"
+
+#define M86E_NAME m86_run_verified
+#define M86E_TRACE 0
+#define M86E_CHECKED 0
+#include "micro86_engine.h"
+
+#define M86E_NAME m86_run_traced_checked
+#define M86E_TRACE 1
+#define M86E_CHECKED 1
+#include "micro86_engine.h"
+
+#define M86E_NAME m86_run_traced_verified
+#define M86E_TRACE 1
+#define M86E_CHECKED 0
+#include "micro86_engine.h"
+
+#if M86_HAVE_THREADED
+
+/* Write register values held by the threaded engine back to the cpu.
+ */
+static void m86_threaded_sync(
+        micro86_proc *micro86_cpu,
+        const m86_predecoded_program *program,
+        const m86_predecoded_instruct *di,
+        const int acc,
+        const int cmp)
+{
+    m86_set_acc_reg(micro86_cpu, acc);
+    m86_set_ip_reg(micro86_cpu, (di - program->code) + 1);
+    m86_set_ir_reg(micro86_cpu, di->word);
+    m86_set_flags_cmp(micro86_cpu, cmp);
+    return;
+}
+
+/* Run the FDE cycle using direct-threaded dispatch (GCC labels as
+ * values): every pre-decoded record carries the address of its handler
+ * and each handler ends in its own indirect jump to the next one.
+ * Records starting a fused instruction sequence run the whole sequence
+ * in one handler; return the stop reason (M86_STOP_NONE if the budget
+ * does not cover the next block).
+ *
+ * Note: registers are kept in locals and only written back to the cpu
+ * on stopping; memory is indexed directly, with no bounds checks (see
+ * m86pd_verify()). The budget is charged once
+ * per basic block, recognised loops are run as loop kernels and
+ * divisions by known divisors as multiplications, as in
+ * micro86_engine.h. Tracing is not supported here, m86_run() uses the
+ * loops of micro86_engine.h for traced runs.
+ */
+static unsigned int m86_run_threaded(
+        micro86_machine *m,
+        unsigned long *budget)
+{
+    static const void *const threads[M86PD_NUM_HANDLERS] =
+    {
+        [M86PD_HALT] = &&do_halt,
+        [M86PD_LOAD] = &&do_load,
+        [M86PD_LOADI] = &&do_loadi,
+        [M86PD_STORE] = &&do_store,
+        [M86PD_STORE_CODE] = &&do_store_code,
+        [M86PD_ADD] = &&do_add,
+        [M86PD_ADDI] = &&do_addi,
+        [M86PD_SUB] = &&do_sub,
+        [M86PD_SUBI] = &&do_subi,
+        [M86PD_MUL] = &&do_mul,
+        [M86PD_MULI] = &&do_muli,
+        [M86PD_DIV] = &&do_div,
+        [M86PD_DIVI] = &&do_divi,
+        [M86PD_MOD] = &&do_mod,
+        [M86PD_MODI] = &&do_modi,
+        [M86PD_CMP] = &&do_cmp,
+        [M86PD_CMPI] = &&do_cmpi,
+        [M86PD_JMPI] = &&do_jmpi,
+        [M86PD_JEI] = &&do_jei,
+        [M86PD_JNEI] = &&do_jnei,
+        [M86PD_JLI] = &&do_jli,
+        [M86PD_JLEI] = &&do_jlei,
+        [M86PD_JGI] = &&do_jgi,
+        [M86PD_JGEI] = &&do_jgei,
+        [M86PD_IN] = &&do_in,
+        [M86PD_OUT] = &&do_out,
+        [M86PD_INVALID] = &&do_invalid,
+        [M86PD_END] = &&do_end,
+        [M86PD_CMP_JEI] = &&do_cmp_jei,
+        [M86PD_CMP_JNEI] = &&do_cmp_jnei,
+        [M86PD_CMP_JLI] = &&do_cmp_jli,
+        [M86PD_CMP_JLEI] = &&do_cmp_jlei,
+        [M86PD_CMP_JGI] = &&do_cmp_jgi,
+        [M86PD_CMP_JGEI] = &&do_cmp_jgei,
+        [M86PD_CMPI_JEI] = &&do_cmpi_jei,
+        [M86PD_CMPI_JNEI] = &&do_cmpi_jnei,
+        [M86PD_CMPI_JLI] = &&do_cmpi_jli,
+        [M86PD_CMPI_JLEI] = &&do_cmpi_jlei,
+        [M86PD_CMPI_JGI] = &&do_cmpi_jgi,
+        [M86PD_CMPI_JGEI] = &&do_cmpi_jgei,
+        [M86PD_LOAD_ADD_STORE] = &&do_load_add_store,
+        [M86PD_LOAD_ADDI_STORE] = &&do_load_addi_store,
+        [M86PD_LOAD_SUB_STORE] = &&do_load_sub_store,
+        [M86PD_LOAD_SUBI_STORE] = &&do_load_subi_store,
+        [M86PD_STORE_LOAD] = &&do_store_load
+    };
+    micro86_proc *micro86_cpu = &m->cpu;
+    memory *micro86_memory = &m->mem;
+    const unsigned int mem_size = m->mem_size;
+    m86_predecoded_program *program = &m->program;
+    unsigned int stop = M86_STOP_ERROR;
+    unsigned long steps = *budget;
+    m86pd_thread(program, threads);
+    int *mem = *micro86_memory,
+        acc = m86_get_acc_reg(*micro86_cpu),
+        cmp = m86_get_flags_cmp(*micro86_cpu),
+        value;
+    unsigned int ip = m86_get_ip_reg(*micro86_cpu),
+                 end = ip,
+                 run;
+    const m86_predecoded_instruct *code = program->code,
+          *di;
+    m86_loop_state loop;
+
+/* Dispatch to the record following the current one. */
+#define NEXT() goto *(++di)->thread
+
+/* Charge the block entered at ip to the budget, up to position end. */
+#define CHARGE() \
+    do { \
+        run = code[ip].run; \
+        if (steps < run) goto budget_short; \
+        steps -= run; \
+        end = ip + run; \
+    } while (0)
+
+/* Run whole iterations of the loop headed by the record at ip as a
+ * loop kernel (see micro86_loop.h). */
+#define LOOP() \
+    do { \
+        loop.acc = acc; \
+        loop.cmp = cmp; \
+        loop.ip = ip; \
+        loop.last = di - code; \
+        steps = m86lp_run(&m->loops, program, mem, &loop, steps); \
+        acc = loop.acc; \
+        cmp = loop.cmp; \
+        ip = loop.ip; \
+        di = code + loop.last; \
+        if (ip >= program->size) goto jump_end; \
+    } while (0)
+
+/* Dispatch to the record at the jump target in ip. */
+#define JUMP() \
+    do { \
+        if (ip >= program->size) goto jump_end; \
+        if (code[ip].loop != 0) LOOP(); \
+        CHARGE(); \
+        di = code + ip; \
+        goto *di->thread; \
+    } while (0)
+
+/* Enter the block following the current record and dispatch to it. */
+#define FALL() \
+    do { \
+        ip = (di - code) + 1; \
+        CHARGE(); \
+        NEXT(); \
+    } while (0)
+
+/* Write registers and the number of instructions left back. */
+#define SYNC() \
+    do { \
+        m86_threaded_sync(micro86_cpu, program, di, acc, cmp); \
+        *budget = steps; \
+    } while (0)
+
+/* Fused compare (of acc against operand value x) and conditional
+ * jump, taken if the comparison result satisfies condition. */
+#define CMP_J(x, condition) \
+    do { \
+        cmp = acc - (x); \
+        di++; \
+        if (cmp condition 0) \
+        { \
+            ip = di->operand; \
+            JUMP(); \
+        } \
+        FALL(); \
+    } while (0)
+
+/* Fused LOAD, arithmetic (acc op= operand, or operand value if
+ * from_memory) and STORE. */
+#define LOAD_OP_STORE(op, from_memory) \
+    do { \
+        acc = mem[di->operand]; \
+        di++; \
+        if (from_memory) \
+        { \
+            acc op mem[di->operand]; \
+        } else acc op di->operand; \
+        di++; \
+        mem[di->operand] = acc; \
+        NEXT(); \
+    } while (0)
+
+    if (ip >= program->size)
+    {
+        fetch(m);
+        goto done;
+    }
+    if (steps < code[ip].run)
+    {
+        stop = M86_STOP_NONE;
+        goto done;
+    }
+    steps -= code[ip].run;
+    end = ip + code[ip].run;
+    di = code + ip;
+    goto *di->thread;
+do_halt:
+    SYNC();
+    stop = M86_STOP_HALTED;
+    goto done;
+do_load:
+    acc = mem[di->operand];
+    NEXT();
+do_loadi:
+    acc = di->operand;
+    NEXT();
+do_store:
+    mem[di->operand] = acc;
+    NEXT();
+do_store_code:
+    mem[di->operand] = acc;
+    m86pd_update(program, di->operand, acc);
+    ip = (di - code) + 1;
+    if (((unsigned) di->operand >= ip) &&
+            ((unsigned) di->operand < end))
+    {
+        /* The rest of the block changed; charge it anew. */
+        steps += end - ip;
+        CHARGE();
+    }
+    NEXT();
+do_add:
+    acc += mem[di->operand];
+    NEXT();
+do_addi:
+    acc += di->operand;
+    NEXT();
+do_sub:
+    acc -= mem[di->operand];
+    NEXT();
+do_subi:
+    acc -= di->operand;
+    NEXT();
+do_mul:
+    acc *= mem[di->operand];
+    NEXT();
+do_muli:
+    acc *= di->operand;
+    NEXT();
+do_div:
+    if (di->reciprocal != 0)
+    {
+        acc = M86PD_QUOTIENT(di, acc);
+        NEXT();
+    }
+    if ((value = mem[di->operand]) == 0) goto zero_div_error;
+    acc /= value;
+    NEXT();
+do_divi:
+    if (di->reciprocal != 0)
+    {
+        acc = M86PD_QUOTIENT(di, acc);
+        NEXT();
+    }
+    if (di->operand == 0) goto zero_div_error;
+    acc /= di->operand;
+    NEXT();
+do_mod:
+    if (di->reciprocal != 0)
+    {
+        acc -= M86PD_QUOTIENT(di, acc) * mem[di->operand];
+        NEXT();
+    }
+    if ((value = mem[di->operand]) == 0) goto zero_div_error;
+    acc %= value;
+    NEXT();
+do_modi:
+    if (di->reciprocal != 0)
+    {
+        acc -= M86PD_QUOTIENT(di, acc) * di->operand;
+        NEXT();
+    }
+    if (di->operand == 0) goto zero_div_error;
+    acc %= di->operand;
+    NEXT();
+do_cmp:
+    cmp = acc - mem[di->operand];
+    NEXT();
+do_cmpi:
+    cmp = acc - di->operand;
+    NEXT();
+do_jmpi:
+    ip = di->operand;
+    JUMP();
+do_jei:
+    if (cmp == 0)
+    {
+        ip = di->operand;
+        JUMP();
+    }
+    FALL();
+do_jnei:
+    if (cmp != 0)
+    {
+        ip = di->operand;
+        JUMP();
+    }
+    FALL();
+do_jli:
+    if (cmp < 0)
+    {
+        ip = di->operand;
+        JUMP();
+    }
+    FALL();
+do_jlei:
+    if (cmp <= 0)
+    {
+        ip = di->operand;
+        JUMP();
+    }
+    FALL();
+do_jgi:
+    if (cmp > 0)
+    {
+        ip = di->operand;
+        JUMP();
+    }
+    FALL();
+do_jgei:
+    if (cmp >= 0)
+    {
+        ip = di->operand;
+        JUMP();
+    }
+    FALL();
+do_in:
+    if ((value = m86_read_input(m)) == M86_NO_INPUT)
+    {
+        SYNC();
+        m86_set_ip_reg(micro86_cpu, di - code);
+        stop = M86_STOP_INPUT;
+        goto done;
+    }
+    if (value == EOF)
+    {
+        SYNC();
+        m86_input_error(m);
+        goto done;
+    }
+    acc = (unsigned char) value;
+    NEXT();
+do_out:
+    m86_write_output(m, (unsigned char) acc);
+    NEXT();
+do_invalid:
+    SYNC();
+    m86_invalid_error(m, di);
+    goto done;
+do_cmp_jei:
+    CMP_J(mem[di->operand], ==);
+do_cmp_jnei:
+    CMP_J(mem[di->operand], !=);
+do_cmp_jli:
+    CMP_J(mem[di->operand], <);
+do_cmp_jlei:
+    CMP_J(mem[di->operand], <=);
+do_cmp_jgi:
+    CMP_J(mem[di->operand], >);
+do_cmp_jgei:
+    CMP_J(mem[di->operand], >=);
+do_cmpi_jei:
+    CMP_J(di->operand, ==);
+do_cmpi_jnei:
+    CMP_J(di->operand, !=);
+do_cmpi_jli:
+    CMP_J(di->operand, <);
+do_cmpi_jlei:
+    CMP_J(di->operand, <=);
+do_cmpi_jgi:
+    CMP_J(di->operand, >);
+do_cmpi_jgei:
+    CMP_J(di->operand, >=);
+do_load_add_store:
+    LOAD_OP_STORE(+=, true);
+do_load_addi_store:
+    LOAD_OP_STORE(+=, false);
+do_load_sub_store:
+    LOAD_OP_STORE(-=, true);
+do_load_subi_store:
+    LOAD_OP_STORE(-=, false);
+do_store_load:
+    mem[di->operand] = acc;
+    di++;
+    NEXT();
+do_end:
+    if (di < code + program->size)
+    {
+        /* Reached the breakpoint (see m86pd_break()); give back the
+         * part of the block not run. */
+        steps += end - (di - code);
+        SYNC();
+        m86_set_ip_reg(micro86_cpu, di - code);
+        stop = M86_STOP_BREAK;
+        goto done;
+    }
+    /* Ran past the last instruction of the program; fetch() reports
+     * the error. */
+    di--;
+    SYNC();
+    fetch(m);
+    goto done;
+jump_end:
+    /* Jumped beyond the end of the program. */
+    SYNC();
+    m86_set_ip_reg(micro86_cpu, ip);
+    fetch(m);
+    goto done;
+budget_short:
+    SYNC();
+    m86_set_ip_reg(micro86_cpu, ip);
+    stop = M86_STOP_NONE;
+    goto done;
+zero_div_error:
+    SYNC();
+    m86_check_zero_div_error(0, STD_ERR_DEST, m->error_code,
+            *micro86_cpu, *micro86_memory, mem_size);
+done:
+    m86pd_thread(program, NULL);
+    return stop;
+
+#undef NEXT
+#undef CHARGE
+#undef LOOP
+#undef JUMP
+#undef FALL
+#undef SYNC
+#undef CMP_J
+#undef LOAD_OP_STORE
+}
+
+#endif
+
+/* Execute a single instruction (printing its trace line if needed) and
+ * return the stop reason (M86_STOP_NONE if the machine did not stop).
+ */
+static unsigned int m86_step(micro86_machine *m)
+{
+    unsigned int ip = m86_get_ip_reg(m->cpu);
+    if ((ip < m->program.size) &&
+            (m->program.code[ip].handler == M86PD_END))
+        return M86_STOP_BREAK;
+    const m86_predecoded_instruct *di = fetch(m);
+    if ((di == NULL) || ((m->trace != NULL) &&
+                m86_print_trace(m->trace, m->cpu, m->mem, m->mem_size,
+                    m->error_code)))
+        return M86_STOP_ERROR;
+    return execute(m, di);
+}
+
+/* Copy cpu registers into state used by translated blocks.
+ */
+static void m86_jit_load_state(
+        m86_jit_state *state,
+        const micro86_proc micro86_cpu)
+{
+    state->acc = m86_get_acc_reg(micro86_cpu);
+    state->flags = m86_get_flags_reg(micro86_cpu);
+    state->ip = m86_get_ip_reg(micro86_cpu);
+    state->ir = m86_get_ir_reg(micro86_cpu);
+    return;
+}
+
+/* Copy state used by translated blocks back into cpu registers.
+ */
+static void m86_jit_store_state(
+        micro86_proc *micro86_cpu,
+        const m86_jit_state *state)
+{
+    m86_set_acc_reg(micro86_cpu, state->acc);
+    m86_set_ip_reg(micro86_cpu, state->ip);
+    m86_set_ir_reg(micro86_cpu, state->ir);
+    m86_set_flags_zb(micro86_cpu, (state->flags & ZERO_BIT_TRUE));
+    m86_set_flags_sb(micro86_cpu, (state->flags >> 1) & SIGN_BIT_TRUE);
+    return;
+}
+
+/* Execute a single instruction with execute(), refreshing its record
+ * first, and discard translated blocks that depend on the memory unit
+ * it modifies if it is a STORE into the code region; return the stop
+ * reason (M86_STOP_NONE if the machine did not stop).
+ */
+static unsigned int m86_interpret(micro86_machine *m)
+{
+    m86pd_refresh(&m->program, m->mem, m86_get_ip_reg(m->cpu));
+    const m86_predecoded_instruct *di = fetch(m);
+    if (di == NULL) return M86_STOP_ERROR;
+    /* The STORE may overwrite its own record; translated blocks may
+     * cover code it was not decoded as a STORE into (see
+     * m86pd_init()). */
+    bool store_code = ((di->handler == M86PD_STORE) ||
+            (di->handler == M86PD_STORE_CODE)) &&
+        ((unsigned) di->operand < m->program.size);
+    int operand = di->operand;
+    unsigned int stop = execute(m, di);
+    if (store_code && m->compiler_ready)
+        m86jit_invalidate(&m->compiler, operand);
+    return stop;
+}
+
+/* Run the FDE cycle using natively translated blocks (see
+ * micro86_jit.h); whatever the blocks leave to the interpreter, such as
+ * I/O, halting and all error conditions, goes through execute().
+ */
+static unsigned int m86_run_jit(micro86_machine *m)
+{
+    unsigned int stop = M86_STOP_NONE;
+    m86_jit_state state;
+    m86jit_prepare(&m->compiler, &state);
+    m86_jit_load_state(&state, m->cpu);
+    while (stop == M86_STOP_NONE)
+    {
+        m86_jit_block block =
+            m86jit_get(&m->compiler, &m->program, state.ip);
+        if (block != NULL)
+        {
+            state.interpret = 0;
+            block(&state);
+            if (!state.interpret) continue;
+        }
+        m86_jit_store_state(&m->cpu, &state);
+        stop = m86_interpret(m);
+        m86_jit_load_state(&state, m->cpu);
+    }
+    return stop;
+}
+
+/* Refresh all records of the pre-decoded program (see m86pd_refresh())
+ * after running code that stores into the code region without
+ * updating them.
+ */
+static void m86_refresh_program(micro86_machine *m)
+{
+    unsigned int i;
+    for (i = 0; i < m->program.size; i++)
+        m86pd_refresh(&m->program, m->mem, i);
+    return;
+}
+
+/* Run the FDE cycle using the ahead-of-time translated program (see
+ * micro86_aot.h); whatever it leaves to the interpreter, such as I/O,
+ * halting and all error conditions, goes through execute(). Return
+ * M86_STOP_NONE, after unloading the translated program, once the
+ * program modifies its translated code.
+ */
+static unsigned int m86_run_aot(micro86_machine *m)
+{
+    unsigned int stop = M86_STOP_NONE;
+    const m86_predecoded_instruct *di;
+    m86_aot_state state;
+    state.mem = m->mem;
+    while (stop == M86_STOP_NONE)
+    {
+        state.acc = m86_get_acc_reg(m->cpu);
+        state.cmp = m86_get_flags_cmp(m->cpu);
+        state.ip = m86_get_ip_reg(m->cpu);
+        state.ir = m86_get_ir_reg(m->cpu);
+        m->object.entry(&state);
+        m86_set_acc_reg(&m->cpu, state.acc);
+        m86_set_flags_cmp(&m->cpu, state.cmp);
+        m86_set_ip_reg(&m->cpu, state.ip);
+        m86_set_ir_reg(&m->cpu, state.ir);
+        m86_refresh_program(m);
+        if (state.status == M86AOT_MODIFIED) break;
+        if ((di = fetch(m)) == NULL) return M86_STOP_ERROR;
+        stop = execute(m, di);
+        /* Only reached when entered outside translated code; the
+         * translation may no longer match the program. */
+        if (di->handler == M86PD_STORE_CODE) break;
+    }
+    if (stop == M86_STOP_NONE)
+    {
+        m86aot_kill(&m->object);
+        m->object_ready = false;
+        m->aot = false;
+    }
+    return stop;
+}
+
+/* Discard translated blocks that depend on memory units the block
+ * starting at specified position (run instructions long) may store
+ * into.
+ */
+static void m86_tier_invalidate(
+        micro86_machine *m,
+        const unsigned int start,
+        const unsigned int run)
+{
+    const m86_predecoded_instruct *di = m->program.code + start;
+    unsigned int pos;
+    for (pos = start; (pos < start + run) && (pos < m->program.size);
+            pos++, di++)
+        if ((di->handler == M86PD_STORE) ||
+                (di->handler == M86PD_STORE_CODE))
+            m86jit_invalidate(&m->compiler, di->operand);
+    return;
+}
+
+/* Run the block starting at specified position with the switch-based
+ * engines of micro86_engine.h, or less if it stops (or modifies
+ * itself); return the stop reason.
+ */
+static unsigned int m86_tier_predecoded(
+        micro86_machine *m,
+        const unsigned int start)
+{
+    m86_predecoded_program *program = &m->program;
+    unsigned int pos = start,
+                 stop = M86_STOP_NONE,
+                 run;
+    unsigned long budget;
+    if (m->compiler_ready)
+    {
+        /* Translated blocks store without updating records. */
+        for (; pos < program->size; pos++)
+        {
+            m86pd_refresh(program, m->mem, pos);
+            if ((program->code[pos].handler >= M86PD_JMPI) &&
+                    (program->code[pos].handler <= M86PD_JGEI))
+                break;
+        }
+        m86_tier_invalidate(m, start, program->code[start].run);
+    }
+    budget = run = program->code[start].run;
+    if (program->verified) stop = m86_run_verified(m, &budget);
+    if ((stop == M86_STOP_NONE) && (budget == run))
+        stop = m86_run_checked(m, &budget);
+    if (m->compiler_ready)
+        m86_tier_invalidate(m, start, program->code[start].run);
+    return stop;
+}
+
+/* Run the block starting at specified position as a natively translated
+ * block, which may go on to chained blocks (see micro86_jit.h); return
+ * the stop reason.
+ */
+static unsigned int m86_tier_native(
+        micro86_machine *m,
+        const unsigned int start)
+{
+    m86_jit_state state;
+    m86_jit_block block = m86jit_get(&m->compiler, &m->program, start);
+    if (block == NULL) return m86_interpret(m);
+    m86jit_prepare(&m->compiler, &state);
+    m86_jit_load_state(&state, m->cpu);
+    state.interpret = 0;
+    block(&state);
+    m86_jit_store_state(&m->cpu, &state);
+    return state.interpret ? m86_interpret(m) : M86_STOP_NONE;
+}
+
+/* Run the FDE cycle one block at a time, each in the tier its entry
+ * count calls for (see micro86_machine.h): the plain interpreter, then
+ * the switch-based engines once warm and natively translated blocks
+ * once hot, if available.
+ */
+static unsigned int m86_run_tiered(micro86_machine *m)
+{
+    m86_predecoded_program *program = &m->program;
+    unsigned int stop = M86_STOP_NONE,
+                 ip,
+                 count,
+                 tier,
+                 run;
+    if (m->tier_counts == NULL)
+        m->tier_counts = calloc(program->size, sizeof(unsigned int));
+    if (m->tier_counts == NULL) return M86_STOP_NONE;
+    while (stop == M86_STOP_NONE)
+    {
+        ip = m86_get_ip_reg(m->cpu);
+        /* Past the end of the program; fetch() reports it. */
+        if (ip >= program->size) return m86_interpret(m);
+        count = m->tier_counts[ip];
+        if (count < M86_TIER_HOT) m->tier_counts[ip] = ++count;
+        tier = (count >= M86_TIER_HOT) ? M86_TIER_NATIVE :
+            (count >= M86_TIER_WARM) ? M86_TIER_PREDECODED :
+            M86_TIER_INTERPRETER;
+        if ((tier == M86_TIER_NATIVE) && !m->compiler_ready &&
+                !m->tier_no_native)
+        {
+            m->compiler_ready = m86jit_init(&m->compiler,
+                    program, m->mem, m->mem_size);
+            if (m->compiler_ready) m86jit_load(&m->compiler);
+            else m->tier_no_native = true;
+        }
+        if ((tier == M86_TIER_NATIVE) && m->tier_no_native)
+            tier = M86_TIER_PREDECODED;
+        m->tier_entries[tier]++;
+        switch (tier)
+        {
+            case M86_TIER_INTERPRETER:
+                m86pd_refresh(program, m->mem, ip);
+                for (run = program->code[ip].run;
+                        (run > 0) && (stop == M86_STOP_NONE); run--)
+                    stop = m86_interpret(m);
+                break;
+            case M86_TIER_PREDECODED:
+                stop = m86_tier_predecoded(m, ip);
+                break;
+            default:
+                stop = m86_tier_native(m, ip);
+                break;
+        }
+    }
+    return stop;
+}
+
+/* Initialize machine to run program contained in memory from entry
+ * (see m86_machine_init() and m86_branch()).
+ */
+static bool m86_machine_setup(
+        micro86_machine *m,
+        memory micro86_memory,
+        const unsigned int mem_size,
+        const unsigned int program_size,
+        const unsigned int entry)
+{
+    if ((m == NULL) ||
+            !m86pd_init(&m->program, micro86_memory, program_size))
+        return false;
+    if (entry != 0) m86pd_resume(&m->program, entry);
+    m86pd_verify(&m->program, mem_size);
+    m86lp_init(&m->loops, &m->program, mem_size);
+    m86_proc_init(&m->cpu);
+    m->mem = micro86_memory;
+    m->mem_size = mem_size;
+    m->program_size = program_size;
+    m->compiler_ready = false;
+    m->object_ready = false;
+    m->record_ready = false;
+    m->tier_counts = NULL;
+    memset(m->tier_entries, 0, sizeof(m->tier_entries));
+    m->tier_no_native = !M86_HAVE_JIT;
+    m->state = M86_STOP_BUDGET;
+    m->executed = 0;
+    m->trace = NULL;
+    m->threaded = false;
+    m->jit = false;
+    m->aot = false;
+    m->tiered = false;
+    m->replay = false;
+    m->input = STD_IN_SRC;
+    m->output = STD_OUT_DEST;
+    m->pending_input = M86_NO_INPUT;
+    m->error_code = 0;
+    return true;
+}
+
+/* m86_machine_init: initialize machine to run program contained in
+ * memory.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to micro86_machine variable.
+ * # memory variable containing program (the machine takes it over).
+ * # unsigned value for memory size.
+ * # unsigned value for program size.
+ *
+ * Note: the program is pre-decoded and verified against memory size
+ * (see m86pd_verify()), and its loops are recognised (see
+ * m86lp_init()); the cpu starts with all registers cleared.
+ *
+ * Note: to avoid memory leaks, m86_machine_kill() should be called
+ * once the machine is no longer needed, provided that this function
+ * succeeded; memory is released with the machine.
+ *
+ * Returns: bool value to indicate status of initialization; true =
+ * success, false = failure (i.e., not enough memory).
+ */
+bool m86_machine_init(
+        micro86_machine *m,
+        memory micro86_memory,
+        const unsigned int mem_size,
+        const unsigned int program_size)
+{
+    return m86_machine_setup(m, micro86_memory, mem_size, program_size,
+            0);
+}
+
+/* m86_run: run machine until it halts, stops on an error, waits for
+ * input or has executed a maximum number of instructions.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to micro86_machine variable.
+ * # unsigned long value for maximum number of instructions to execute
+ * (0 = no limit).
+ *
+ * Note: the mnemonic dataset (see micro86_dataset.h) must be
+ * initialized if the execution trace option is set. The trace line of
+ * an IN instruction waiting on input is printed again on resuming.
+ *
+ * Returns: unsigned value for stop reason (one of the M86_STOP_*
+ * values declared in micro86_machine.h).
+ */
+unsigned int m86_run(
+        micro86_machine *m,
+        const unsigned long max_steps)
+{
+    if ((m->state == M86_STOP_HALTED) || (m->state == M86_STOP_ERROR))
+        return m->state;
+    if (m86_check_no_prgm_error(m->program_size, STD_ERR_DEST,
+                m->error_code, m->cpu, m->mem, m->mem_size))
+        return (m->state = M86_STOP_ERROR);
+    unsigned long budget = (max_steps == 0) ? ULONG_MAX : max_steps;
+    unsigned int stop = M86_STOP_NONE;
+    bool unbounded = (max_steps == 0) && (m->trace == NULL) &&
+            !m->program.breaking,
+         native = (m->jit || m->tiered) && unbounded;
+    if (m->replay)
+    {
+        /* Only whole runs are replayed or recorded. */
+        m->replay = false;
+        if (unbounded &&
+                m86rp_init(&m->record, &m->program, m->mem_size))
+        {
+            if (m86rp_load(&m->record, &m->cpu, m->mem, m->mem_size,
+                        m->output))
+            {
+                m86rp_kill(&m->record);
+                m->executed = 0;
+                return (m->state = M86_STOP_HALTED);
+            }
+            if (!(m->record_ready = m86rp_record(&m->record)))
+                m86rp_kill(&m->record);
+        }
+    }
+    if (m->aot && unbounded && !m->object_ready)
+        m->aot = m->object_ready =
+            m86aot_init(&m->object, &m->program, m->mem_size);
+    else if (!unbounded && m->object_ready)
+    {
+        /* Other engines may modify translated code. */
+        m86aot_kill(&m->object);
+        m->object_ready = false;
+    }
+    if (m->object_ready) stop = m86_run_aot(m);
+    if ((stop == M86_STOP_NONE) && m->tiered && unbounded)
+    {
+        stop = m86_run_tiered(m);
+        m86_refresh_program(m);
+    }
+    if ((stop == M86_STOP_NONE) && native && m->jit &&
+            !m->compiler_ready)
+    {
+        m->compiler_ready = m86jit_init(&m->compiler,
+                &m->program, m->mem, m->mem_size);
+        if (m->compiler_ready) m86jit_load(&m->compiler);
+    } else if (!native && m->compiler_ready)
+    {
+        /* Other engines do not invalidate translated blocks. */
+        m86jit_save(&m->compiler, &m->program);
+        m86jit_kill(&m->compiler);
+        m->compiler_ready = false;
+    }
+    if ((stop == M86_STOP_NONE) && native && m->jit &&
+            m->compiler_ready)
+    {
+        stop = m86_run_jit(m);
+        m86_refresh_program(m);
+    }
+#if M86_HAVE_THREADED
+    if ((stop == M86_STOP_NONE) && m->threaded && (m->trace == NULL))
+        stop = m86_run_threaded(m, &budget);
+#endif
+    if ((stop == M86_STOP_NONE) && m->program.verified)
+        stop = (m->trace != NULL) ?
+            m86_run_traced_verified(m, &budget) :
+            m86_run_verified(m, &budget);
+    if (stop == M86_STOP_NONE)
+        stop = (m->trace != NULL) ?
+            m86_run_traced_checked(m, &budget) :
+            m86_run_checked(m, &budget);
+    /* The budget does not cover the next block; step through what is
+     * left of it. */
+    while ((stop == M86_STOP_NONE) && (budget > 0))
+    {
+        stop = m86_step(m);
+        /* The instruction at the breakpoint is yet to be executed. */
+        if (stop != M86_STOP_BREAK) budget--;
+    }
+    if (stop == M86_STOP_NONE) stop = M86_STOP_BUDGET;
+    if (stop == M86_STOP_BREAK) m86pd_unbreak(&m->program);
+    if (m->record_ready)
+    {
+        if (stop == M86_STOP_HALTED)
+            m86rp_save(&m->record, m->cpu, m->mem, m->mem_size);
+        m86rp_kill(&m->record);
+        m->record_ready = false;
+    }
+    m->executed = ((max_steps == 0) ? ULONG_MAX : max_steps) - budget;
+    return (m->state = stop);
+}
+
+/* m86_set_breakpoint: set the breakpoint of machine, clearing any
+ * previous one; m86_run() stops with M86_STOP_BREAK as soon as the
+ * instruction pointer reaches it.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to micro86_machine variable.
+ * # unsigned value for position of breakpoint.
+ *
+ * Note: the breakpoint is not reached again once the machine is
+ * resumed on it, since it is cleared when reached.
+ *
+ * Returns: bool value to indicate whether the breakpoint was set;
+ * false if position is outside the code region.
+ */
+bool m86_set_breakpoint(
+        micro86_machine *m,
+        const unsigned int pos)
+{
+    return m86pd_break(&m->program, pos);
+}
+
+/* m86_clear_breakpoint: clear the breakpoint of machine, if any.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to micro86_machine variable.
+ *
+ * Returns: N/A.
+ */
+void m86_clear_breakpoint(micro86_machine *m)
+{
+    m86pd_unbreak(&m->program);
+    return;
+}
+
+/* m86_provide_input: provide the byte to be read by the next IN
+ * instruction executed.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to micro86_machine variable.
+ * # unsigned char value for input byte.
+ *
+ * Note: a byte provided takes precedence over the input stream of the
+ * machine; providing another byte before it has been read replaces
+ * it.
+ *
+ * Returns: N/A.
+ */
+void m86_provide_input(
+        micro86_machine *m,
+        const unsigned char input)
+{
+    m->pending_input = input;
+    return;
+}
+
+/* m86_machine_kill: release resources held by machine, including its
+ * memory.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to micro86_machine variable.
+ *
+ * Note: passing NULL results in no operation being performed.
+ *
+ * Returns: N/A.
+ */
+void m86_machine_kill(micro86_machine *m)
+{
+    if (m == NULL) return;
+    if (m->compiler_ready)
+    {
+        m86jit_save(&m->compiler, &m->program);
+        m86jit_kill(&m->compiler);
+    }
+    if (m->object_ready) m86aot_kill(&m->object);
+    if (m->record_ready) m86rp_kill(&m->record);
+    m->compiler_ready = m->object_ready = m->record_ready = false;
+    free(m->tier_counts);
+    m->tier_counts = NULL;
+    m86lp_kill(&m->loops);
+    m86pd_kill(&m->program);
+    m_deallocate(&m->mem);
+    return;
+}
+
+/* m86_tier_report: print out tier residency of tiered execution.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to micro86_machine variable.
+ * # pointer to FILE variable for output.
+ *
+ * Note: for each tier, the number of blocks (i.e., positions blocks
+ * were entered at) whose entry count puts them in that tier and the
+ * number of times blocks were entered in it are printed. Natively
+ * translated blocks chained to one another are only counted when
+ * entered from the tiering loop.
+ *
+ * Returns: N/A.
+ */
+void m86_tier_report(
+        const micro86_machine *m,
+        FILE *stream)
+{
+    static const char *const names[M86_NUM_TIERS] =
+    {
+        "Interpreter",
+        "Pre-decoded",
+        "Native"
+    };
+    unsigned long blocks[M86_NUM_TIERS] = { 0 };
+    unsigned int i,
+                 count;
+    for (i = 0; (m->tier_counts != NULL) && (i < m->program_size); i++)
+    {
+        if ((count = m->tier_counts[i]) == 0) continue;
+        if (count < M86_TIER_WARM) blocks[M86_TIER_INTERPRETER]++;
+        else if ((count < M86_TIER_HOT) || m->tier_no_native)
+            blocks[M86_TIER_PREDECODED]++;
+        else blocks[M86_TIER_NATIVE]++;
+    }
+    fprintf(stream, "\n=== TIER RESIDENCY ===\n\n"
+            "%-16s%-16s%s\n", "Tier", "Blocks", "Entries");
+    for (i = 0; i < M86_NUM_TIERS; i++)
+        fprintf(stream, "%-16s%-16lu%lu\n",
+                names[i], blocks[i], m->tier_entries[i]);
+    return;
+}
+
+/* m86_snapshot: take a snapshot of a machine stopped between runs.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to micro86_snapshot variable.
+ * # pointer to micro86_machine variable.
+ *
+ * Note: only the processor, memory and stop reason are saved, memory
+ * in proportion to what it touched if paged (see m_snapshot()); the
+ * machine may keep running or be killed afterwards.
+ *
+ * Note: to avoid resource leaks, m86_snapshot_kill() should be called
+ * once the snapshot is no longer needed, provided that this function
+ * succeeded.
+ *
+ * Returns: bool value to indicate status of snapshot; true = success,
+ * false = failure (i.e., not enough memory).
+ */
+bool m86_snapshot(
+        micro86_snapshot *s,
+        const micro86_machine *m)
+{
+    if ((s == NULL) || (m == NULL) ||
+            !m_snapshot(&s->mem, m->mem, m->mem_size))
+        return false;
+    s->cpu = m->cpu;
+    s->mem_size = m->mem_size;
+    s->program_size = m->program_size;
+    s->state = m->state;
+    s->pending_input = m->pending_input;
+    return true;
+}
+
+/* m86_branch: initialize machine to resume from a snapshot.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to micro86_machine variable.
+ * # pointer to micro86_snapshot variable.
+ *
+ * Note: the machine is initialized as by m86_machine_init(), from
+ * memory branched off the snapshot (see m_branch()), so that machines
+ * branched off one snapshot share the pages they do not write to; it
+ * then takes over the processor and stop reason of the snapshot, and
+ * the program is pre-decoded as it was when the snapshot was taken,
+ * resuming from the instruction pointer (see m86pd_resume()). Options
+ * are left to their defaults, breakpoints cleared.
+ *
+ * Note: to avoid memory leaks, m86_machine_kill() should be called
+ * once the machine is no longer needed, provided that this function
+ * succeeded; the snapshot need not outlive the machine.
+ *
+ * Returns: bool value to indicate status of initialization; true =
+ * success, false = failure (i.e., not enough memory).
+ */
+bool m86_branch(
+        micro86_machine *m,
+        const micro86_snapshot *s)
+{
+    memory micro86_memory;
+    if ((m == NULL) || (s == NULL) ||
+            !m_branch(&s->mem, &micro86_memory))
+        return false;
+    if (!m86_machine_setup(m, micro86_memory, s->mem_size,
+                s->program_size, m86_get_ip_reg(s->cpu)))
+    {
+        m_deallocate(&micro86_memory);
+        return false;
+    }
+    m->cpu = s->cpu;
+    m->state = s->state;
+    m->pending_input = s->pending_input;
+    return true;
+}
+
+/* m86_snapshot_kill: release resources held by a snapshot of a
+ * machine.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to micro86_snapshot variable.
+ *
+ * Note: machines branched off the snapshot keep running. Passing NULL
+ * results in no operation being performed.
+ *
+ * Returns: N/A.
+ */
+void m86_snapshot_kill(micro86_snapshot *s)
+{
+    if (s == NULL) return;
+    m_drop_snapshot(&s->mem);
+    return;
+}
+
+/* EOF. */
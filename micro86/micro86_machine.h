@@ -0,0 +1,495 @@
+/* micro86_machine:
+ *
+ * A resumable micro86 machine: processor, memory and pre-decoded
+ * program, together with the execution engines that run it.
+ *
+ * m86_run() runs a machine for a bounded number of instructions and
+ * returns the reason it stopped, so that a host can time-slice many
+ * programs in one process and resume each of them later on. A program
+ * executing IN on a machine without an input stream stops until the
+ * host provides a byte with m86_provide_input().
+ *
+ * m86_snapshot() saves a machine between runs, and m86_branch() starts
+ * any number of machines from where it was, e.g., to run a program
+ * warmed up once against many inputs; machines branched off one
+ * snapshot share the pages of memory none of them writes to.
+ *
+ * Errors (e.g., memory violations) are reported as in the rest of the
+ * emulator: a message and a post-mortem dump are printed, and the
+ * process exits only if the error code of the machine is EXIT_FAILURE;
+ * otherwise, the machine stops for good with M86_STOP_ERROR.
+ */
+
+#ifndef _STDIO_H
+#include <stdio.h>
+#endif
+
+#ifndef _STDBOOL_H
+#include <stdbool.h>
+#endif
+
+#ifndef MICRO86PROC_H
+#include "micro86_proc.h"
+#endif
+
+#ifndef MEMORY_H
+#include "memory/memory.h"
+#endif
+
+#ifndef MICRO86PREDECODE_H
+#include "micro86_predecode.h"
+#endif
+
+#ifndef MICRO86LOOP_H
+#include "micro86_loop.h"
+#endif
+
+#ifndef MICRO86JIT_H
+#include "micro86_jit.h"
+#endif
+
+#ifndef MICRO86AOT_H
+#include "micro86_aot.h"
+#endif
+
+#ifndef MICRO86REPLAY_H
+#include "micro86_replay.h"
+#endif
+
+#ifndef MICRO86MACHINE_H
+#define MICRO86MACHINE_H
+
+/* Stop reasons returned by m86_run().
+ *
+ * # M86_STOP_HALTED: the program executed HALT.
+ * # M86_STOP_BUDGET: the maximum number of instructions was executed;
+ * the machine can be resumed.
+ * # M86_STOP_INPUT: the program is waiting on IN for a byte to be
+ * provided with m86_provide_input(); the instruction pointer is left
+ * on the IN instruction.
+ * # M86_STOP_ERROR: an error was reported.
+ * # M86_STOP_BREAK: the instruction pointer reached the breakpoint (see
+ * m86_set_breakpoint()), which is cleared; the instruction there is
+ * yet to be executed and the machine can be resumed.
+ *
+ * Note: once a machine stops with M86_STOP_HALTED or M86_STOP_ERROR,
+ * further calls to m86_run() return the same reason straight away.
+ */
+#define M86_STOP_HALTED 0
+#define M86_STOP_BUDGET 1
+#define M86_STOP_INPUT  2
+#define M86_STOP_ERROR  3
+#define M86_STOP_BREAK  4
+
+/* Tiers of tiered execution (see the tiered option below).
+ *
+ * # M86_TIER_INTERPRETER: blocks are run one instruction at a time by
+ * the reference implementation of a cycle.
+ * # M86_TIER_PREDECODED: blocks are run by the switch-based engines of
+ * micro86_engine.h.
+ * # M86_TIER_NATIVE: blocks are translated by the just-in-time compiler
+ * (see micro86_jit.h), if available; otherwise, they stay in the
+ * previous tier.
+ */
+#define M86_TIER_INTERPRETER    0
+#define M86_TIER_PREDECODED     1
+#define M86_TIER_NATIVE         2
+#define M86_NUM_TIERS           3
+
+/* M86_TIER_WARM: number of times a block has to be entered before it
+ * moves to M86_TIER_PREDECODED.
+ */
+#define M86_TIER_WARM 2
+
+/* M86_TIER_HOT: number of times a block has to be entered before it
+ * moves to M86_TIER_NATIVE.
+ */
+#define M86_TIER_HOT 100
+
+/* Type: micro86_machine.
+ *
+ * A micro86 machine consisting of the following:
+ *
+ * # cpu: processor.
+ * # mem: memory (owned by the machine).
+ * # mem_size: memory size.
+ * # program_size: size of code region.
+ * # program: pre-decoded program.
+ * # loops: loops recognised in the program (see micro86_loop.h), run
+ * as loop kernels by untraced runs of the switch-based engines and of
+ * threaded dispatch.
+ * # compiler: just-in-time compiler (see micro86_jit.h), set up the
+ * first time it is needed.
+ * # compiler_ready: whether compiler has been set up.
+ * # object: ahead-of-time translated program (see micro86_aot.h),
+ * loaded the first time it is needed.
+ * # object_ready: whether object has been loaded.
+ * # record: cached result of the program (see micro86_replay.h), set up
+ * when the first run starts.
+ * # record_ready: whether the run is being recorded into record.
+ * # tier_counts: number of times the block starting at each position
+ * of the code region was entered by tiered execution, up to
+ * M86_TIER_HOT (NULL until tiered execution is first used).
+ * # tier_entries: number of times blocks were entered in each tier.
+ * # tier_no_native: whether M86_TIER_NATIVE is unavailable.
+ * # state: reason the machine last stopped.
+ * # executed: number of instructions executed by the latest call to
+ * m86_run() (only counted when none of them ran natively translated,
+ * e.g., in runs with a maximum number of instructions).
+ *
+ * and of the following options, set to their defaults by
+ * m86_machine_init():
+ *
+ * # trace: file stream for the execution trace (default NULL, i.e.,
+ * no trace).
+ * # threaded: whether to use threaded dispatch (default false).
+ * # jit: whether to use native translation (default false).
+ * # aot: whether to use ahead-of-time translation (default false);
+ * cleared if the program cannot be translated, or once it modifies
+ * its translated code.
+ * # tiered: whether to use tiered execution (default false): each
+ * block starts in M86_TIER_INTERPRETER and moves to faster tiers as
+ * it gets entered more often, so that short programs do not pay for
+ * translation while long loops end up translated.
+ * # replay: whether to replay the cached result of the program instead
+ * of running it, or else to record its result, if it never executes
+ * IN (default false); cleared once the machine first runs.
+ * # input: file stream IN reads from (default STD_IN_SRC); NULL makes
+ * IN wait for m86_provide_input().
+ * # output: file stream OUT writes to (default STD_OUT_DEST).
+ * # error_code: error code passed on to errors (default 0, i.e.,
+ * errors are not fatal).
+ *
+ * Note: threaded dispatch and native (just-in-time or ahead-of-time)
+ * translation are only used for untraced runs without an instruction
+ * budget or breakpoint; other runs use the switch-based engines of
+ * micro86_engine.h. Ahead-of-time translation takes precedence over
+ * the others, then tiered execution. Likewise, only a first run that
+ * is untraced and has neither an instruction budget nor a breakpoint
+ * is replayed or recorded; such a run either halts (and is then
+ * saved) or stops on an error.
+ *
+ * Note: traced and untraced runs use distinct engines, so that
+ * untraced ones do not test for tracing on every instruction; the
+ * trace can be switched on and off between calls to m86_run() (e.g.,
+ * once a breakpoint is reached, or every so many instructions).
+ *
+ * # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # #
+ * WARNING: options may be set directly between calls to m86_run(), and
+ * the other fields may be read (e.g., for dumps), but the latter should
+ * only be modified through the functions declared below.
+ * # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # #
+ */
+typedef struct
+{
+    micro86_proc cpu;
+    memory mem;
+    unsigned int mem_size,
+                 program_size;
+    m86_predecoded_program program;
+    m86_loops loops;
+    m86_jit compiler;
+    bool compiler_ready;
+    m86_aot object;
+    bool object_ready;
+    m86_replay record;
+    bool record_ready;
+    unsigned int *tier_counts;
+    unsigned long tier_entries[M86_NUM_TIERS];
+    bool tier_no_native;
+    unsigned int state;
+    unsigned long executed;
+    FILE *trace;
+    bool threaded,
+         jit,
+         aot,
+         tiered,
+         replay;
+    FILE *input,
+         *output;
+    int pending_input,
+        error_code;
+} micro86_machine;
+
+/* m86_machine_init: initialize machine to run program contained in
+ * memory.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to micro86_machine variable.
+ * # memory variable containing program (the machine takes it over).
+ * # unsigned value for memory size.
+ * # unsigned value for program size.
+ *
+ * Note: the program is pre-decoded and verified against memory size
+ * (see m86pd_verify()), and its loops are recognised (see
+ * m86lp_init()); the cpu starts with all registers cleared.
+ *
+ * Note: to avoid memory leaks, m86_machine_kill() should be called
+ * once the machine is no longer needed, provided that this function
+ * succeeded; memory is released with the machine.
+ *
+ * Returns: bool value to indicate status of initialization; true =
+ * success, false = failure (i.e., not enough memory).
+ */
+bool m86_machine_init(
+        micro86_machine*,
+        memory,
+        const unsigned int,
+        const unsigned int);
+
+/* m86_run: run machine until it halts, stops on an error, waits for
+ * input or has executed a maximum number of instructions.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to micro86_machine variable.
+ * # unsigned long value for maximum number of instructions to execute
+ * (0 = no limit).
+ *
+ * Note: the mnemonic dataset (see micro86_dataset.h) must be
+ * initialized if the execution trace option is set. The trace line of
+ * an IN instruction waiting on input is printed again on resuming.
+ *
+ * Returns: unsigned value for stop reason (one of the M86_STOP_*
+ * values above).
+ */
+unsigned int m86_run(
+        micro86_machine*,
+        const unsigned long);
+
+/* m86_set_breakpoint: set the breakpoint of machine, clearing any
+ * previous one; m86_run() stops with M86_STOP_BREAK as soon as the
+ * instruction pointer reaches it.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to micro86_machine variable.
+ * # unsigned value for position of breakpoint.
+ *
+ * Note: the breakpoint is not reached again once the machine is
+ * resumed on it, since it is cleared when reached.
+ *
+ * Returns: bool value to indicate whether the breakpoint was set;
+ * false if position is outside the code region.
+ */
+bool m86_set_breakpoint(
+        micro86_machine*,
+        const unsigned int);
+
+/* m86_clear_breakpoint: clear the breakpoint of machine, if any.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to micro86_machine variable.
+ *
+ * Returns: N/A.
+ */
+void m86_clear_breakpoint(micro86_machine*);
+
+/* m86_provide_input: provide the byte to be read by the next IN
+ * instruction executed.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to micro86_machine variable.
+ * # unsigned char value for input byte.
+ *
+ * Note: a byte provided takes precedence over the input stream of the
+ * machine; providing another byte before it has been read replaces
+ * it.
+ *
+ * Returns: N/A.
+ */
+void m86_provide_input(
+        micro86_machine*,
+        const unsigned char);
+
+/* m86_machine_kill: release resources held by machine, including its
+ * memory.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to micro86_machine variable.
+ *
+ * Note: passing NULL results in no operation being performed.
+ *
+ * Returns: N/A.
+ */
+void m86_machine_kill(micro86_machine*);
+
+/* m86_tier_report: print out tier residency of tiered execution.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to micro86_machine variable.
+ * # pointer to FILE variable for output.
+ *
+ * Note: for each tier, the number of blocks (i.e., positions blocks
+ * were entered at) whose entry count puts them in that tier and the
+ * number of times blocks were entered in it are printed. Natively
+ * translated blocks chained to one another are only counted when
+ * entered from the tiering loop.
+ *
+ * Returns: N/A.
+ */
+void m86_tier_report(
+        const micro86_machine*,
+        FILE*);
+
+/* Type: micro86_snapshot.
+ *
+ * A snapshot of a machine consisting of the following:
+ *
+ * # cpu: micro86_proc variable, as the machine left it.
+ * # mem: snapshot of memory (see mem_snapshot).
+ * # mem_size: memory size.
+ * # program_size: program size.
+ * # state: stop reason of the latest run of the machine.
+ * # pending_input: byte provided for the next IN instruction, if any.
+ *
+ * # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # #
+ * WARNING: micro86_snapshot fields should not be modified directly.
+ * The functions declared below are to be used for such purposes.
+ * # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # #
+ */
+typedef struct
+{
+    micro86_proc cpu;
+    mem_snapshot mem;
+    unsigned int mem_size,
+                 program_size,
+                 state;
+    int pending_input;
+} micro86_snapshot;
+
+/* m86_snapshot: take a snapshot of a machine stopped between runs.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to micro86_snapshot variable.
+ * # pointer to micro86_machine variable.
+ *
+ * Note: only the processor, memory and stop reason are saved, memory
+ * in proportion to what it touched if paged (see m_snapshot()); the
+ * machine may keep running or be killed afterwards.
+ *
+ * Note: to avoid resource leaks, m86_snapshot_kill() should be called
+ * once the snapshot is no longer needed, provided that this function
+ * succeeded.
+ *
+ * Returns: bool value to indicate status of snapshot; true = success,
+ * false = failure (i.e., not enough memory).
+ */
+bool m86_snapshot(
+        micro86_snapshot*,
+        const micro86_machine*);
+
+/* m86_branch: initialize machine to resume from a snapshot.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to micro86_machine variable.
+ * # pointer to micro86_snapshot variable.
+ *
+ * Note: the machine is initialized as by m86_machine_init(), from
+ * memory branched off the snapshot (see m_branch()), so that machines
+ * branched off one snapshot share the pages they do not write to; it
+ * then takes over the processor and stop reason of the snapshot, and
+ * the program is pre-decoded as it was when the snapshot was taken,
+ * resuming from the instruction pointer (see m86pd_resume()). Options
+ * are left to their defaults, breakpoints cleared.
+ *
+ * Note: to avoid memory leaks, m86_machine_kill() should be called
+ * once the machine is no longer needed, provided that this function
+ * succeeded; the snapshot need not outlive the machine.
+ *
+ * Returns: bool value to indicate status of initialization; true =
+ * success, false = failure (i.e., not enough memory).
+ */
+bool m86_branch(
+        micro86_machine*,
+        const micro86_snapshot*);
+
+/* m86_snapshot_kill: release resources held by a snapshot of a
+ * machine.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to micro86_snapshot variable.
+ *
+ * Note: machines branched off the snapshot keep running. Passing NULL
+ * results in no operation being performed.
+ *
+ * Returns: N/A.
+ */
+void m86_snapshot_kill(micro86_snapshot*);
+
+/* m86_postmortem_dump: print out contents of cpu and memory.
+ *
+ * Parameters (in order):
+ *
+ * # micro86_proc variable.
+ * # memory variable.
+ * # unsigned value for memory size.
+ * # pointer to FILE variable for output.
+ *
+ * Returns: N/A.
+ */
+void m86_postmortem_dump(
+        const micro86_proc,
+        const memory,
+        const unsigned int,
+        FILE*);
+
+/* m86_error: print out error message and post-mortem dump, and exit if
+ * error code is EXIT_FAILURE.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to FILE variable for output.
+ * # string for error message.
+ * # integer for error code.
+ * # micro86_proc variable.
+ * # memory variable.
+ * # unsigned value for memory size.
+ *
+ * Returns: N/A.
+ */
+void m86_error(
+        FILE*,
+        const char*,
+        const int,
+        const micro86_proc,
+        const memory,
+        const unsigned int);
+
+/* m86_disassembly: print out disassembled code in memory.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to FILE variable for output.
+ * # micro86_proc variable (for error dumps).
+ * # memory variable.
+ * # unsigned value for memory size.
+ * # unsigned value for program size.
+ * # integer for error code.
+ *
+ * Note: the mnemonic dataset (see micro86_dataset.h) must be
+ * initialized.
+ *
+ * Returns: bool value to indicate whether an error was reported
+ * (i.e., no program or operand out of memory bounds); true = error,
+ * false = no error.
+ */
+bool m86_disassembly(
+        FILE*,
+        const micro86_proc,
+        const memory,
+        const unsigned int,
+        const unsigned int,
+        const int);
+
+#endif
+
+/* EOF. */
@@ -0,0 +1,891 @@
+/* micro86_predecode:
+ *
+ * Pre-decoded program representation for the micro86 emulator.
+ *
+ * A loaded program is decoded once into a dense array of records, one
+ * per memory unit of the program, so that the fetch/execute cycle no
+ * longer has to read, decode or classify instructions on every cycle.
+ * Records are re-decoded individually whenever the program stores
+ * into its own code region.
+ */
+
+#ifndef _STDLIB_H
+#include <stdlib.h>
+#endif
+
+#ifndef MICRO86_H
+#include "micro86.h"
+#endif
+
+#ifndef MICRO86PREDECODE_H
+#include "micro86_predecode.h"
+#endif
+
+/* M86PD_FUSE_LEN: length of the longest fused instruction sequence.
+ */
+#define M86PD_FUSE_LEN 3
+
+/* Return dense handler index for specified opcode.
+ */
+static unsigned int m86pd_handler(const int opcode)
+{
+    switch (opcode)
+    {
+        case HALT:  return M86PD_HALT;
+        case LOAD:  return M86PD_LOAD;
+        case LOADI: return M86PD_LOADI;
+        case STORE: return M86PD_STORE;
+        case ADD:   return M86PD_ADD;
+        case ADDI:  return M86PD_ADDI;
+        case SUB:   return M86PD_SUB;
+        case SUBI:  return M86PD_SUBI;
+        case MUL:   return M86PD_MUL;
+        case MULI:  return M86PD_MULI;
+        case DIV:   return M86PD_DIV;
+        case DIVI:  return M86PD_DIVI;
+        case MOD:   return M86PD_MOD;
+        case MODI:  return M86PD_MODI;
+        case CMP:   return M86PD_CMP;
+        case CMPI:  return M86PD_CMPI;
+        case JMPI:  return M86PD_JMPI;
+        case JEI:   return M86PD_JEI;
+        case JNEI:  return M86PD_JNEI;
+        case JLI:   return M86PD_JLI;
+        case JLEI:  return M86PD_JLEI;
+        case JGI:   return M86PD_JGI;
+        case JGEI:  return M86PD_JGEI;
+        case IN:    return M86PD_IN;
+        case OUT:   return M86PD_OUT;
+        default:    break;
+    }
+    return M86PD_INVALID;
+}
+
+/* Return fused handler index for sequence starting at specified
+ * position of program.
+ */
+static unsigned int m86pd_fused(
+        const m86_predecoded_program *p,
+        const unsigned int pos)
+{
+    const m86_predecoded_instruct *di = p->code + pos;
+    unsigned int left = p->size - pos;
+    if (left < 2) return di->handler;
+    switch (di->handler)
+    {
+        case M86PD_CMP:
+        case M86PD_CMPI:
+            if ((di[1].handler >= M86PD_JEI) &&
+                    (di[1].handler <= M86PD_JGEI))
+                return ((di->handler == M86PD_CMP) ?
+                        M86PD_CMP_JEI : M86PD_CMPI_JEI) +
+                    (di[1].handler - M86PD_JEI);
+            break;
+        case M86PD_LOAD:
+            if ((left < 3) || (di[2].handler != M86PD_STORE)) break;
+            switch (di[1].handler)
+            {
+                case M86PD_ADD:     return M86PD_LOAD_ADD_STORE;
+                case M86PD_ADDI:    return M86PD_LOAD_ADDI_STORE;
+                case M86PD_SUB:     return M86PD_LOAD_SUB_STORE;
+                case M86PD_SUBI:    return M86PD_LOAD_SUBI_STORE;
+                default:            break;
+            }
+            break;
+        case M86PD_STORE:
+            if ((di[1].handler == M86PD_LOAD) &&
+                    (di[1].operand == di->operand))
+                return M86PD_STORE_LOAD;
+            break;
+        default:
+            break;
+    }
+    return di->handler;
+}
+
+/* Recompute fused handler (and thread) of record at specified
+ * position of program.
+ */
+static void m86pd_fuse(
+        m86_predecoded_program *p,
+        const unsigned int pos)
+{
+    p->code[pos].fused = m86pd_fused(p, pos);
+    if (p->threads != NULL)
+        p->code[pos].thread = p->threads[p->code[pos].fused];
+    return;
+}
+
+/* Return true if records with specified handler end a basic block
+ * (i.e., are jumps).
+ */
+static bool m86pd_ends_block(const unsigned int handler)
+{
+    return (handler >= M86PD_JMPI) && (handler <= M86PD_JGEI);
+}
+
+/* Recompute runs of record at specified position of program and of
+ * the records preceding it in the same basic block.
+ */
+static void m86pd_run(
+        m86_predecoded_program *p,
+        const unsigned int pos)
+{
+    unsigned int i = pos + 1;
+    while (i-- > 0)
+    {
+        if (m86pd_ends_block(p->code[i].handler))
+        {
+            if (i < pos) break;
+            p->code[i].run = 1;
+        } else p->code[i].run = p->code[i + 1].run + 1;
+    }
+    return;
+}
+
+/* Return true if records with specified handler have a memory
+ * operand.
+ */
+static bool m86pd_uses_memory(const unsigned int handler)
+{
+    switch (handler)
+    {
+        case M86PD_LOAD:
+        case M86PD_STORE:
+        case M86PD_STORE_CODE:
+        case M86PD_ADD:
+        case M86PD_SUB:
+        case M86PD_MUL:
+        case M86PD_DIV:
+        case M86PD_MOD:
+        case M86PD_CMP:
+            return true;
+        default:
+            break;
+    }
+    return false;
+}
+
+/* Give record the M86PD_INVALID handler if its memory operand lies
+ * beyond the memory size the program was verified against (the same
+ * bounds m86_check_memory_bounds() enforces); return true if so.
+ */
+static bool m86pd_trap(
+        const m86_predecoded_program *p,
+        m86_predecoded_instruct *di)
+{
+    if ((p->mem_size == 0) || !m86pd_uses_memory(di->handler) ||
+            ((di->operand >= 0) &&
+             ((unsigned) di->operand <= p->mem_size)))
+        return false;
+    di->handler = di->fused = M86PD_INVALID;
+    di->loop = 0;
+    di->reciprocal = 0;
+    return true;
+}
+
+/* Return true if memory operand (or jump target) of specified record
+ * is within bounds of memory of specified size (or of the program).
+ */
+static bool m86pd_in_bounds(
+        const m86_predecoded_program *p,
+        const m86_predecoded_instruct *di,
+        const unsigned int mem_size)
+{
+    if (m86pd_uses_memory(di->handler))
+        return ((di->operand >= 0) &&
+                ((unsigned) di->operand < mem_size));
+    switch (di->handler)
+    {
+        case M86PD_JMPI:
+        case M86PD_JEI:
+        case M86PD_JNEI:
+        case M86PD_JLI:
+        case M86PD_JLEI:
+        case M86PD_JGI:
+        case M86PD_JGEI:
+            return ((di->operand >= 0) &&
+                    ((unsigned) di->operand < p->size));
+        default:
+            break;
+    }
+    return true;
+}
+
+/* Work out the reciprocal of specified divisor into record (see
+ * m86_predecoded_instruct), following the signed magic number
+ * algorithm of Warren's Hacker's Delight, 10-1; the reciprocal is left
+ * at 0 for divisors 0, 1 and -1.
+ */
+static void m86pd_reciprocal(
+        m86_predecoded_instruct *di,
+        const int divisor)
+{
+    const unsigned int two31 = 0x80000000U,
+                       ad = (divisor < 0) ?
+                           0U - (unsigned) divisor : (unsigned) divisor,
+                       t = two31 + ((unsigned) divisor >> 31),
+                       anc = t - 1 - t % ad;
+    unsigned int q1 = two31 / anc,
+                 r1 = two31 - q1 * anc,
+                 q2 = two31 / ad,
+                 r2 = two31 - q2 * ad,
+                 p = 31;
+    di->reciprocal = 0;
+    di->shift = 0;
+    if (ad < 2) return;
+    do
+    {
+        p++;
+        q1 *= 2;
+        r1 *= 2;
+        if (r1 >= anc)
+        {
+            q1++;
+            r1 -= anc;
+        }
+        q2 *= 2;
+        r2 *= 2;
+        if (r2 >= ad)
+        {
+            q2++;
+            r2 -= ad;
+        }
+    } while ((q1 < ad - r2) || ((q1 == ad - r2) && (r1 == 0)));
+    /* The magic number is 33 bits wide, sign included. */
+    di->reciprocal = (long long) q2 + 1;
+    if (divisor < 0) di->reciprocal = -di->reciprocal;
+    di->shift = p;
+    return;
+}
+
+/* Drop the reciprocals DIV and MOD records of program hold for the
+ * memory unit at specified position, which is about to be stored into.
+ */
+static void m86pd_forget(
+        m86_predecoded_program *p,
+        const unsigned int pos)
+{
+    if ((p->divisors == NULL) || !p->divisors[pos]) return;
+    unsigned int i;
+    for (i = 0; i < p->size; i++)
+        if (((p->code[i].handler == M86PD_DIV) ||
+                    (p->code[i].handler == M86PD_MOD)) &&
+                ((unsigned) p->code[i].operand == pos))
+            p->code[i].reciprocal = 0;
+    p->divisors[pos] = false;
+    return;
+}
+
+/* Return true if record is a STORE (of either kind) into the code
+ * region of program.
+ */
+static bool m86pd_stores_code(
+        const m86_predecoded_program *p,
+        const m86_predecoded_instruct *di)
+{
+    return ((di->handler == M86PD_STORE) ||
+            (di->handler == M86PD_STORE_CODE)) &&
+        ((unsigned) di->operand < p->size);
+}
+
+/* Give a STORE into the code region of program the M86PD_STORE_CODE
+ * handler if the memory unit it stores into is reachable, or else the
+ * M86PD_STORE one (see m86pd_init()).
+ */
+static void m86pd_classify(
+        const m86_predecoded_program *p,
+        m86_predecoded_instruct *di)
+{
+    if ((p->reachable == NULL) || !m86pd_stores_code(p, di)) return;
+    di->handler = di->fused = p->reachable[di->operand] ?
+        M86PD_STORE_CODE : M86PD_STORE;
+    return;
+}
+
+/* Return the way records with specified handler go on: 0 = nowhere, 1
+ * = to their operand, 2 = either to their operand or to the next
+ * record, 3 = to the next record (see m86pd_reachable()).
+ */
+static unsigned int m86pd_flow(const unsigned int handler)
+{
+    if ((handler == M86PD_HALT) || (handler == M86PD_INVALID)) return 0;
+    if (handler == M86PD_JMPI) return 1;
+    return m86pd_ends_block(handler) ? 2 : 3;
+}
+
+/* Return true if two records may go on to different positions.
+ */
+static bool m86pd_diverts(
+        const m86_predecoded_instruct *a,
+        const m86_predecoded_instruct *b)
+{
+    unsigned int flow = m86pd_flow(a->handler);
+    return (flow != m86pd_flow(b->handler)) ||
+        (((flow == 1) || (flow == 2)) && (a->operand != b->operand));
+}
+
+/* Mark the positions of program that have become reachable, make the
+ * STOREs into them M86PD_STORE_CODE records and re-decode them from
+ * memory, which plain STOREs modify without updating them.
+ */
+static void m86pd_reach(m86_predecoded_program *p)
+{
+    if (p->reachable == NULL) return;
+    bool *grown = m86pd_reachable(p),
+         any = false;
+    m86_predecoded_instruct *di;
+    unsigned int i,
+                 j;
+    for (i = 0; i < p->size; i++)
+    {
+        /* Not enough memory to tell: assume all positions are. */
+        if (grown == NULL) any = p->reachable[i] = true;
+        else if (grown[i] && !p->reachable[i])
+            any = p->reachable[i] = true;
+        else grown[i] = false;
+    }
+    if (!any)
+    {
+        free(grown);
+        return;
+    }
+    for (i = 0; i < p->size; i++)
+    {
+        di = (p->breaking && (i == p->break_pos)) ?
+            &p->break_record : p->code + i;
+        if ((di->handler != M86PD_STORE) ||
+                !m86pd_stores_code(p, di) ||
+                !p->reachable[di->operand])
+            continue;
+        m86pd_classify(p, di);
+        if (di == &p->break_record) continue;
+        j = (i < M86PD_FUSE_LEN - 1) ? 0 : i - (M86PD_FUSE_LEN - 1);
+        for (; j <= i; j++) m86pd_fuse(p, j);
+    }
+    for (i = 0; i < p->size; i++)
+        if ((grown == NULL) || grown[i]) m86pd_refresh(p, p->mem, i);
+    free(grown);
+    return;
+}
+
+/* m86pd_decoded: return encoded instruction in pre-decoded form.
+ *
+ * Parameters (in order):
+ *
+ * # m86_encoded_instruct variable.
+ * # unsigned value for program size (used to tell STOREs into the
+ * code region apart from ordinary ones).
+ *
+ * Note: this function does not require the dataset to be initialized;
+ * words with unknown opcodes are given the M86PD_INVALID handler.
+ *
+ * Returns: m86_predecoded_instruct value containing encoded
+ * instruction in pre-decoded form.
+ */
+m86_predecoded_instruct m86pd_decoded(
+        const m86_encoded_instruct ei,
+        const unsigned int program_size)
+{
+    m86_predecoded_instruct pi;
+    m86_decoded_instruct di = m86_ei_decoded(ei);
+    pi.opcode = di.opcode;
+    pi.operand = di.operand;
+    pi.word = ei;
+    pi.thread = NULL;
+    pi.run = 1;
+    pi.loop = 0;
+    pi.handler = m86pd_handler(di.opcode);
+    if ((pi.handler == M86PD_STORE) &&
+            ((unsigned) pi.operand < program_size))
+        pi.handler = M86PD_STORE_CODE;
+    pi.fused = pi.handler;
+    if ((pi.handler == M86PD_DIVI) || (pi.handler == M86PD_MODI))
+        m86pd_reciprocal(&pi, pi.operand);
+    else
+    {
+        pi.reciprocal = 0;
+        pi.shift = 0;
+    }
+    return pi;
+}
+
+/* m86pd_init: decode program of specified size contained in memory.
+ *
+ * Note: besides decoding, this function recognizes common instruction
+ * sequences and sets the corresponding fused handlers, and works out
+ * the reciprocals of the divisors of DIV and MOD records whose memory
+ * operand no STORE of the program stores into (memory outside the code
+ * region is assumed to be cleared, hence never a valid divisor).
+ *
+ * Note: STOREs into positions of the code region that are not
+ * reachable from position 0 (e.g., variables past the final HALT) are
+ * decoded as plain M86PD_STORE records rather than M86PD_STORE_CODE
+ * ones, so that running them costs no more than storing into data,
+ * and they do not keep the records there up to date. Positions become
+ * reachable, and STOREs into them M86PD_STORE_CODE records, as soon as
+ * re-decoding a reachable record changes where it may go on to; their
+ * records are then re-decoded from memory (see m86pd_update()).
+ *
+ * Parameters (in order):
+ *
+ * # pointer to m86_predecoded_program variable.
+ * # memory variable containing program.
+ * # unsigned value for program size.
+ *
+ * Note: memory must contain at least as many memory units as the
+ * program size. Passing NULL for m86_predecoded_program variable
+ * results in false return value.
+ *
+ * Note: to avoid memory leaks, m86pd_kill() should be called once the
+ * pre-decoded program is no longer needed.
+ *
+ * Returns: bool value to indicate status of decoding; true = success,
+ * false = failure (i.e., not enough memory).
+ */
+bool m86pd_init(
+        m86_predecoded_program *p,
+        const memory m,
+        const unsigned int program_size)
+{
+    if (p == NULL) return false;
+    p->size = program_size;
+    p->threads = NULL;
+    p->verified = false;
+    p->mem_size = 0;
+    p->divisors = NULL;
+    p->breaking = false;
+    p->mem = m;
+    p->reachable = NULL;
+    p->entry = 0;
+    p->code = malloc((program_size + 1)
+            * sizeof(m86_predecoded_instruct));
+    if (p->code == NULL) return false;
+    unsigned int i;
+    for (i = 0; i < program_size; i++)
+        p->code[i] = m86pd_decoded(m_get_value(m, i), program_size);
+    p->reachable = m86pd_reachable(p);
+    for (i = 0; i < program_size; i++) m86pd_classify(p, p->code + i);
+    for (i = 0; i < program_size; i++) m86pd_fuse(p, i);
+    p->code[program_size] = m86pd_decoded(0, program_size);
+    p->code[program_size].handler =
+        p->code[program_size].fused = M86PD_END;
+    p->code[program_size].opcode =
+        p->code[program_size].operand = 0;
+    /* Memory units no STORE stores into keep their values, so DIV and
+     * MOD by them divide by constants. */
+    p->divisors = calloc(program_size + 1, sizeof(bool));
+    bool *stored = calloc(program_size + 1, sizeof(bool));
+    if ((p->divisors != NULL) && (stored != NULL))
+    {
+        for (i = 0; i < program_size; i++)
+            if (m86pd_stores_code(p, p->code + i))
+                stored[p->code[i].operand] = true;
+        for (i = 0; i < program_size; i++)
+        {
+            unsigned int pos = (unsigned) p->code[i].operand;
+            if (((p->code[i].handler != M86PD_DIV) &&
+                        (p->code[i].handler != M86PD_MOD)) ||
+                    (pos >= program_size) || stored[pos])
+                continue;
+            m86pd_reciprocal(p->code + i, m_get_value(m, pos));
+            if (p->code[i].reciprocal != 0) p->divisors[pos] = true;
+        }
+    }
+    free(stored);
+    for (i = program_size; i-- > 0;)
+        p->code[i].run = m86pd_ends_block(p->code[i].handler) ?
+            1 : p->code[i + 1].run + 1;
+    return true;
+}
+
+/* m86pd_verify: check that every memory operand of a pre-decoded
+ * program is within memory bounds and that every jump target is within
+ * the program, and mark the program as verified if so.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to m86_predecoded_program variable.
+ * # unsigned value for memory size.
+ *
+ * Note: records whose memory operand lies beyond memory size are
+ * given the M86PD_INVALID handler from then on, here and whenever
+ * they are re-decoded (see m86pd_trapped()), and do not count against
+ * verification. Operands being static, execution engines never need to
+ * check memory bounds: reaching such a record is the only way to
+ * access memory out of bounds, and they report it as they do invalid
+ * instructions.
+ *
+ * Note: execution engines may skip the remaining checks (i.e., on jump
+ * targets) on verified programs. Re-decoding a record that does not
+ * pass the checks (see m86pd_update()) clears the mark. Passing NULL
+ * for m86_predecoded_program variable results in false return value.
+ *
+ * Returns: bool value to indicate whether program was verified; true =
+ * verified, false = not verified.
+ */
+bool m86pd_verify(
+        m86_predecoded_program *p,
+        const unsigned int mem_size)
+{
+    if (p == NULL) return false;
+    p->mem_size = mem_size;
+    p->verified = (p->size <= mem_size);
+    unsigned int i,
+                 j;
+    for (i = 0; i < p->size; i++)
+    {
+        if (m86pd_trap(p, p->code + i))
+        {
+            j = (i < M86PD_FUSE_LEN - 1) ? 0 : i - (M86PD_FUSE_LEN - 1);
+            for (; j <= i; j++) m86pd_fuse(p, j);
+        }
+        if (p->verified)
+            p->verified = m86pd_in_bounds(p, p->code + i, mem_size);
+    }
+    return p->verified;
+}
+
+/* m86pd_update: re-decode record at specified position after the
+ * memory unit at that position has been modified.
+ *
+ * Note: fused handlers and runs of the record and of the records
+ * preceding it are recomputed as needed; the program stops being
+ * verified if the new record does not pass the checks of
+ * m86pd_verify(). If the new record is a STORE, DIV and MOD records
+ * holding the reciprocal of the memory unit it stores into drop it.
+ * If the record is reachable and no longer goes on to the same
+ * positions, the positions it makes reachable are re-decoded from the
+ * memory the program was decoded from (see m86pd_init()).
+ *
+ * Parameters (in order):
+ *
+ * # pointer to m86_predecoded_program variable.
+ * # unsigned value for position of modified memory unit.
+ * # new m86_encoded_instruct value contained at that position.
+ *
+ * Note: positions outside the code region are ignored, as is passing
+ * NULL for m86_predecoded_program variable.
+ *
+ * Returns: N/A.
+ */
+void m86pd_update(
+        m86_predecoded_program *p,
+        const unsigned int pos,
+        const m86_encoded_instruct ei)
+{
+    if ((p == NULL) || (pos >= p->size)) return;
+    if (p->breaking && (pos == p->break_pos))
+    {
+        /* The breakpoint stays; its runs and neighbours' fusions are
+         * recomputed when it is cleared. */
+        m86_predecoded_instruct replaced = p->break_record;
+        p->break_record = m86pd_decoded(ei, p->size);
+        m86pd_trap(p, &p->break_record);
+        m86pd_classify(p, &p->break_record);
+        p->code[pos].word = ei;
+        if (m86pd_stores_code(p, &p->break_record))
+            m86pd_forget(p, p->break_record.operand);
+        if (p->verified &&
+                !m86pd_in_bounds(p, &p->break_record, p->mem_size))
+            p->verified = false;
+        if ((p->reachable != NULL) && p->reachable[pos] &&
+                m86pd_diverts(&replaced, &p->break_record))
+            m86pd_reach(p);
+        return;
+    }
+    m86_predecoded_instruct old = p->code[pos];
+    p->code[pos] = m86pd_decoded(ei, p->size);
+    m86pd_trap(p, p->code + pos);
+    m86pd_classify(p, p->code + pos);
+    if (m86pd_stores_code(p, p->code + pos))
+        m86pd_forget(p, p->code[pos].operand);
+    if (m86pd_ends_block(old.handler) ==
+            m86pd_ends_block(p->code[pos].handler))
+        p->code[pos].run = old.run;
+    else m86pd_run(p, pos);
+    if (p->verified && !m86pd_in_bounds(p, p->code + pos, p->mem_size))
+        p->verified = false;
+    unsigned int i = (pos < M86PD_FUSE_LEN - 1) ?
+        0 : pos - (M86PD_FUSE_LEN - 1);
+    for (; i <= pos; i++) m86pd_fuse(p, i);
+    if ((p->reachable != NULL) && p->reachable[pos] &&
+            m86pd_diverts(&old, p->code + pos))
+        m86pd_reach(p);
+    return;
+}
+
+/* m86pd_trapped: tell whether a record with the M86PD_INVALID handler
+ * stands for an instruction whose memory operand lies beyond memory
+ * bounds (see m86pd_verify()) rather than for an unknown opcode.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to m86_predecoded_instruct variable.
+ *
+ * Returns: bool value to indicate whether record accesses memory out
+ * of bounds; true = yes, false = no.
+ */
+bool m86pd_trapped(const m86_predecoded_instruct *di)
+{
+    return (di->handler == M86PD_INVALID) &&
+        (m86pd_handler(di->opcode) != M86PD_INVALID);
+}
+
+/* m86pd_refresh: re-decode record at specified position if the memory
+ * unit at that position has been modified since it was decoded.
+ *
+ * Note: this is for execution engines that store into the code region
+ * without calling m86pd_update(); such engines must refresh records
+ * before using them.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to m86_predecoded_program variable.
+ * # memory variable containing program.
+ * # unsigned value for position of memory unit.
+ *
+ * Note: positions outside the code region are ignored, as is passing
+ * NULL for m86_predecoded_program variable.
+ *
+ * Returns: N/A.
+ */
+void m86pd_refresh(
+        m86_predecoded_program *p,
+        const memory m,
+        const unsigned int pos)
+{
+    if ((p == NULL) || (pos >= p->size)) return;
+    m86_encoded_instruct ei = m_get_value(m, pos);
+    if (p->code[pos].word != ei) m86pd_update(p, pos, ei);
+    return;
+}
+
+/* m86pd_reachable: mark the positions of the code region of a
+ * pre-decoded program that are reachable from position 0 or its entry.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to m86_predecoded_program variable.
+ *
+ * Note: conditional jumps are assumed to go either way, and every other
+ * instruction but JMPI, HALT and invalid ones to fall through; the
+ * records of the program must be up to date (see m86pd_refresh()).
+ * The record a breakpoint stands in for is used at its position.
+ *
+ * Note: to avoid memory leaks, the array returned should be freed with
+ * free() once no longer needed.
+ *
+ * Returns: array of (size + 1) bool values, one per position of the
+ * code region (the last one is always false), or NULL if not enough
+ * memory.
+ */
+bool *m86pd_reachable(const m86_predecoded_program *program)
+{
+    const unsigned int size = program->size;
+    bool *reachable = calloc(size + 1, sizeof(bool));
+    unsigned int *pending = malloc((size + 1) * sizeof(unsigned int));
+    unsigned int count = 0,
+                 pos,
+                 target;
+    const m86_predecoded_instruct *di;
+    if ((reachable == NULL) || (pending == NULL))
+    {
+        free(reachable);
+        free(pending);
+        return NULL;
+    }
+
+/* Mark position p as reachable, if within the code region. */
+#define REACH(p) \
+    do { \
+        if (((p) < size) && !reachable[(p)]) \
+        { \
+            reachable[(p)] = true; \
+            pending[count++] = (p); \
+        } \
+    } while (0)
+
+    REACH(0U);
+    REACH(program->entry);
+    while (count > 0)
+    {
+        pos = pending[--count];
+        di = (program->breaking && (pos == program->break_pos)) ?
+            &program->break_record : program->code + pos;
+        target = (unsigned int) di->operand;
+        switch (di->handler)
+        {
+            case M86PD_HALT:
+            case M86PD_INVALID:
+                break;
+            case M86PD_JMPI:
+                REACH(target);
+                break;
+            case M86PD_JEI:
+            case M86PD_JNEI:
+            case M86PD_JLI:
+            case M86PD_JLEI:
+            case M86PD_JGI:
+            case M86PD_JGEI:
+                REACH(target);
+                REACH(pos + 1);
+                break;
+            default:
+                REACH(pos + 1);
+                break;
+        }
+    }
+    free(pending);
+    return reachable;
+
+#undef REACH
+}
+
+/* m86pd_thread: fill in the thread field of all records of a
+ * pre-decoded program from specified table, and keep filling it in for
+ * records re-decoded later on.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to m86_predecoded_program variable.
+ * # table of M86PD_NUM_HANDLERS handler code addresses, indexed by
+ * handler.
+ *
+ * Note: the table must remain valid for as long as the pre-decoded
+ * program is in use. Passing NULL for the table clears the thread
+ * field of all records. Passing NULL for m86_predecoded_program
+ * variable results in no operation being performed.
+ *
+ * Returns: N/A.
+ */
+void m86pd_thread(
+        m86_predecoded_program *p,
+        const void *const *threads)
+{
+    if (p == NULL) return;
+    p->threads = threads;
+    unsigned int i;
+    for (i = 0; i <= p->size; i++)
+        p->code[i].thread = (threads != NULL) ?
+            threads[p->code[i].fused] : NULL;
+    return;
+}
+
+/* m86pd_break: set a breakpoint at specified position of a pre-decoded
+ * program, clearing any previous one.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to m86_predecoded_program variable.
+ * # unsigned value for position of breakpoint.
+ *
+ * Note: the record at the breakpoint is replaced by an M86PD_END
+ * record keeping its word and run, so that execution engines stop
+ * there as they do past the end of the program, and tell the two
+ * apart by position; no superinstruction or loop kernel runs over it.
+ * The record it stands in for is kept up to date by m86pd_update()
+ * and put back by m86pd_unbreak().
+ *
+ * Note: native translations (see micro86_jit.h and micro86_aot.h) do
+ * not know about breakpoints and must not run while one is set.
+ *
+ * Returns: bool value to indicate whether the breakpoint was set;
+ * false if position is outside the code region or NULL is passed for
+ * m86_predecoded_program variable.
+ */
+bool m86pd_break(
+        m86_predecoded_program *p,
+        const unsigned int pos)
+{
+    if ((p == NULL) || (pos >= p->size)) return false;
+    m86pd_unbreak(p);
+    p->breaking = true;
+    p->break_pos = pos;
+    p->break_record = p->code[pos];
+    p->code[pos].handler =
+        p->code[pos].fused = M86PD_END;
+    p->code[pos].loop = 0;
+    if (p->threads != NULL)
+        p->code[pos].thread = p->threads[M86PD_END];
+    unsigned int i = (pos < M86PD_FUSE_LEN - 1) ?
+        0 : pos - (M86PD_FUSE_LEN - 1);
+    for (; i < pos; i++) m86pd_fuse(p, i);
+    return true;
+}
+
+/* m86pd_unbreak: clear the breakpoint of a pre-decoded program, if
+ * any.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to m86_predecoded_program variable.
+ *
+ * Note: passing NULL results in no operation being performed.
+ *
+ * Returns: N/A.
+ */
+void m86pd_unbreak(m86_predecoded_program *p)
+{
+    if ((p == NULL) || !p->breaking) return;
+    unsigned int pos = p->break_pos;
+    p->breaking = false;
+    p->code[pos] = p->break_record;
+    m86pd_run(p, pos);
+    unsigned int i = (pos < M86PD_FUSE_LEN - 1) ?
+        0 : pos - (M86PD_FUSE_LEN - 1);
+    for (; i <= pos; i++) m86pd_fuse(p, i);
+    return;
+}
+
+/* m86pd_resume: set the entry of a pre-decoded program (i.e., the
+ * position execution resumes from, for a program that was running
+ * before it was pre-decoded).
+ *
+ * Parameters (in order):
+ *
+ * # pointer to m86_predecoded_program variable.
+ * # unsigned value for position of entry.
+ *
+ * Note: positions reachable from the entry are marked reachable, and
+ * STOREs into them made M86PD_STORE_CODE records, from then on (stores
+ * into code may have left them unreachable from position 0). Passing
+ * NULL for m86_predecoded_program variable results in no operation
+ * being performed.
+ *
+ * Returns: N/A.
+ */
+void m86pd_resume(
+        m86_predecoded_program *p,
+        const unsigned int pos)
+{
+    if (p == NULL) return;
+    p->entry = pos;
+    m86pd_reach(p);
+    return;
+}
+
+/* m86pd_kill: release resources held by a pre-decoded program.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to m86_predecoded_program variable.
+ *
+ * Note: passing NULL results in no operation being performed.
+ *
+ * Returns: N/A.
+ */
+void m86pd_kill(m86_predecoded_program *p)
+{
+    if (p == NULL) return;
+    free(p->code);
+    free(p->divisors);
+    free(p->reachable);
+    p->code = NULL;
+    p->divisors = NULL;
+    p->reachable = NULL;
+    p->size = 0;
+    return;
+}
+
+/* EOF. */
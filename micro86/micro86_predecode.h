@@ -0,0 +1,474 @@
+/* micro86_predecode:
+ *
+ * Pre-decoded program representation for the micro86 emulator.
+ *
+ * A loaded program is decoded once into a dense array of records, one
+ * per memory unit of the program, so that the fetch/execute cycle no
+ * longer has to read, decode or classify instructions on every cycle.
+ * Records are re-decoded individually whenever the program stores
+ * into its own code region.
+ */
+
+#ifndef _STDBOOL_H
+#include <stdbool.h>
+#endif
+
+#ifndef MEMORY_H
+#include "memory/memory.h"
+#endif
+
+#ifndef MICRO86COMMON_H
+#include "micro86_common.h"
+#endif
+
+#ifndef MICRO86PREDECODE_H
+#define MICRO86PREDECODE_H
+
+/* Handler indices: dense replacements for the sparse opcodes defined
+ * in micro86.h.
+ *
+ * Note: M86PD_STORE_CODE is a STORE whose operand lies within the code
+ * region of the program and is reachable from position 0 (see
+ * m86pd_init()); M86PD_INVALID is any word that does not
+ * decode to a known opcode, or that decodes to an instruction whose
+ * memory operand lies beyond memory bounds (see m86pd_trapped());
+ * M86PD_END marks the position just past the end of the program.
+ */
+#define M86PD_HALT          0
+#define M86PD_LOAD          1
+#define M86PD_LOADI         2
+#define M86PD_STORE         3
+#define M86PD_STORE_CODE    4
+#define M86PD_ADD           5
+#define M86PD_ADDI          6
+#define M86PD_SUB           7
+#define M86PD_SUBI          8
+#define M86PD_MUL           9
+#define M86PD_MULI          10
+#define M86PD_DIV           11
+#define M86PD_DIVI          12
+#define M86PD_MOD           13
+#define M86PD_MODI          14
+#define M86PD_CMP           15
+#define M86PD_CMPI          16
+#define M86PD_JMPI          17
+#define M86PD_JEI           18
+#define M86PD_JNEI          19
+#define M86PD_JLI           20
+#define M86PD_JLEI          21
+#define M86PD_JGI           22
+#define M86PD_JGEI          23
+#define M86PD_IN            24
+#define M86PD_OUT           25
+#define M86PD_INVALID       26
+#define M86PD_END           27
+
+/* Fused handler indices: superinstructions standing for a short
+ * sequence of instructions starting at the record they are set on.
+ *
+ * # M86PD_CMP_J*, M86PD_CMPI_J*: CMP or CMPI followed by a conditional
+ * jump.
+ * # M86PD_LOAD_*_STORE: LOAD, ADD/ADDI/SUB/SUBI and (plain) STORE.
+ * # M86PD_STORE_LOAD: (plain) STORE followed by LOAD of the same
+ * address.
+ *
+ * Note: fused handlers are only ever found in the fused field of a
+ * record; the records following the first one of a sequence keep
+ * their own handlers so that jumps into the middle of a sequence work.
+ */
+#define M86PD_CMP_JEI           28
+#define M86PD_CMP_JNEI          29
+#define M86PD_CMP_JLI           30
+#define M86PD_CMP_JLEI          31
+#define M86PD_CMP_JGI           32
+#define M86PD_CMP_JGEI          33
+#define M86PD_CMPI_JEI          34
+#define M86PD_CMPI_JNEI         35
+#define M86PD_CMPI_JLI          36
+#define M86PD_CMPI_JLEI         37
+#define M86PD_CMPI_JGI          38
+#define M86PD_CMPI_JGEI         39
+#define M86PD_LOAD_ADD_STORE    40
+#define M86PD_LOAD_ADDI_STORE   41
+#define M86PD_LOAD_SUB_STORE    42
+#define M86PD_LOAD_SUBI_STORE   43
+#define M86PD_STORE_LOAD        44
+#define M86PD_NUM_HANDLERS      45
+
+/* Type: m86_predecoded_instruct.
+ *
+ * A single pre-decoded micro86 instruction consisting of the
+ * following:
+ *
+ * # handler: dense handler index (one of the M86PD_* values above).
+ * # fused: handler index to use when running superinstructions; either
+ * one of the fused handler indices above or the same as handler.
+ * # opcode: decoded opcode, as in m86_decoded_instruct.
+ * # operand: decoded operand, as in m86_decoded_instruct.
+ * # word: the original encoded instruction (i.e., the value to load
+ * into the instruction register when executing it).
+ * # thread: address of handler code for threaded execution engines
+ * (NULL until such an engine fills it in).
+ * # run: number of instructions from this one up to and including the
+ * next jump (or the M86PD_END record), i.e., the rest of its basic
+ * block; engines use it to charge instruction budgets once per block.
+ * # loop: index plus one of the loop headed by this record (see
+ * micro86_loop.h), or 0 if none; cleared when the record is
+ * re-decoded.
+ * # reciprocal, shift: for DIV, DIVI, MOD and MODI records whose
+ * divisor is known when decoding, magic number and shift such that
+ * the quotient can be worked out with a multiplication and shifts
+ * instead of a division (see M86PD_QUOTIENT()); reciprocal is 0 if
+ * the divisor is unknown, or is 0, 1 or -1, in which case the divisor
+ * has to be checked for zero as usual. The divisor of DIVI and MODI is
+ * their operand; that of DIV and MOD is the memory unit at their
+ * operand, which is only known if it lies within the code region and
+ * no STORE of the program stores into it (see m86pd_init()).
+ */
+typedef struct
+{
+    unsigned int handler,
+                 fused,
+                 run,
+                 loop;
+    int opcode,
+        operand;
+    m86_encoded_instruct word;
+    unsigned int shift;
+    long long reciprocal;
+    const void *thread;
+} m86_predecoded_instruct;
+
+/* M86PD_QUOTIENT: quotient of an int value by the divisor of a record
+ * whose reciprocal is not 0, rounded towards zero as by the /
+ * operator.
+ *
+ * Note: the product of any int value by a reciprocal fits in 64 bits;
+ * subtracting its sign bit rounds negative quotients towards zero.
+ */
+#define M86PD_QUOTIENT(di, value) \
+    ((int) ((((long long) (value) * (di)->reciprocal) >> \
+                (di)->shift) - \
+            (((long long) (value) * (di)->reciprocal) >> 63)))
+
+/* Type: m86_predecoded_program.
+ *
+ * A pre-decoded program consisting of the following:
+ *
+ * # code: array of (size + 1) pre-decoded instructions; the last one
+ * is always an M86PD_END record, which is also the record to execute
+ * for any instruction pointer value at or beyond the end of the
+ * program.
+ * # size: program size (i.e., number of memory units in code region).
+ * # threads: table of handler code addresses, indexed by fused
+ * handler, used to fill in the thread field of records (NULL if
+ * none).
+ * # verified: whether every memory operand of the program is known to
+ * be within memory bounds and every jump target within the program
+ * (see m86pd_verify()).
+ * # mem_size: memory size the program was verified against (0 until
+ * verified), beyond which memory operands are trapped.
+ * # divisors: array of size flags, one per position of the code
+ * region, telling whether DIV or MOD records hold the reciprocal of
+ * the memory unit at that position (NULL if not enough memory).
+ * # breaking: whether a breakpoint is set (see m86pd_break()).
+ * # break_pos: position of the breakpoint, if set.
+ * # break_record: record the breakpoint stands in for, if set.
+ * # mem: memory variable containing program.
+ * # reachable: array of size flags, one per position of the code
+ * region, telling whether it may be reachable from position 0 or the
+ * entry (see m86pd_reachable()); flags are only ever set, as stores
+ * into code make more of it reachable (NULL if not enough memory).
+ * # entry: position execution resumes from (see m86pd_resume()); 0
+ * unless set.
+ *
+ * # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # #
+ * WARNING: execution engines may read records directly for speed but
+ * should only modify a program through the functions declared below.
+ * # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # #
+ */
+typedef struct
+{
+    m86_predecoded_instruct *code;
+    unsigned int size;
+    const void *const *threads;
+    bool verified;
+    unsigned int mem_size;
+    bool *divisors;
+    bool breaking;
+    unsigned int break_pos;
+    m86_predecoded_instruct break_record;
+    memory mem;
+    bool *reachable;
+    unsigned int entry;
+} m86_predecoded_program;
+
+/* m86pd_decoded: return encoded instruction in pre-decoded form.
+ *
+ * Parameters (in order):
+ *
+ * # m86_encoded_instruct variable.
+ * # unsigned value for program size (used to tell STOREs into the
+ * code region apart from ordinary ones).
+ *
+ * Note: this function does not require the dataset to be initialized;
+ * words with unknown opcodes are given the M86PD_INVALID handler.
+ *
+ * Note: the record returned is not fused with any following ones
+ * (i.e., its fused field is the same as its handler field).
+ *
+ * Returns: m86_predecoded_instruct value containing encoded
+ * instruction in pre-decoded form.
+ */
+m86_predecoded_instruct m86pd_decoded(
+        const m86_encoded_instruct,
+        const unsigned int);
+
+/* m86pd_init: decode program of specified size contained in memory.
+ *
+ * Note: besides decoding, this function recognizes common instruction
+ * sequences and sets the corresponding fused handlers, and works out
+ * the reciprocals of the divisors of DIV and MOD records whose memory
+ * operand no STORE of the program stores into (memory outside the code
+ * region is assumed to be cleared, hence never a valid divisor).
+ *
+ * Note: STOREs into positions of the code region that are not
+ * reachable from position 0 (e.g., variables past the final HALT) are
+ * decoded as plain M86PD_STORE records rather than M86PD_STORE_CODE
+ * ones, so that running them costs no more than storing into data,
+ * and they do not keep the records there up to date. Positions become
+ * reachable, and STOREs into them M86PD_STORE_CODE records, as soon as
+ * re-decoding a reachable record changes where it may go on to; their
+ * records are then re-decoded from memory (see m86pd_update()).
+ *
+ * Parameters (in order):
+ *
+ * # pointer to m86_predecoded_program variable.
+ * # memory variable containing program.
+ * # unsigned value for program size.
+ *
+ * Note: memory must contain at least as many memory units as the
+ * program size. Passing NULL for m86_predecoded_program variable
+ * results in false return value.
+ *
+ * Note: to avoid memory leaks, m86pd_kill() should be called once the
+ * pre-decoded program is no longer needed.
+ *
+ * Returns: bool value to indicate status of decoding; true = success,
+ * false = failure (i.e., not enough memory).
+ */
+bool m86pd_init(
+        m86_predecoded_program*,
+        const memory,
+        const unsigned int);
+
+/* m86pd_verify: check that every memory operand of a pre-decoded
+ * program is within memory bounds and that every jump target is within
+ * the program, and mark the program as verified if so.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to m86_predecoded_program variable.
+ * # unsigned value for memory size.
+ *
+ * Note: records whose memory operand lies beyond memory size are
+ * given the M86PD_INVALID handler from then on, here and whenever
+ * they are re-decoded (see m86pd_trapped()), and do not count against
+ * verification. Operands being static, execution engines never need to
+ * check memory bounds: reaching such a record is the only way to
+ * access memory out of bounds, and they report it as they do invalid
+ * instructions.
+ *
+ * Note: execution engines may skip the remaining checks (i.e., on jump
+ * targets) on verified programs. Re-decoding a record that does not
+ * pass the checks (see m86pd_update()) clears the mark. Passing NULL
+ * for m86_predecoded_program variable results in false return value.
+ *
+ * Returns: bool value to indicate whether program was verified; true =
+ * verified, false = not verified.
+ */
+bool m86pd_verify(
+        m86_predecoded_program*,
+        const unsigned int);
+
+/* m86pd_update: re-decode record at specified position after the
+ * memory unit at that position has been modified.
+ *
+ * Note: fused handlers and runs of the record and of the records
+ * preceding it are recomputed as needed; the program stops being
+ * verified if the new record does not pass the checks of
+ * m86pd_verify(). If the new record is a STORE, DIV and MOD records
+ * holding the reciprocal of the memory unit it stores into drop it.
+ * If the record is reachable and no longer goes on to the same
+ * positions, the positions it makes reachable are re-decoded from the
+ * memory the program was decoded from (see m86pd_init()).
+ *
+ * Parameters (in order):
+ *
+ * # pointer to m86_predecoded_program variable.
+ * # unsigned value for position of modified memory unit.
+ * # new m86_encoded_instruct value contained at that position.
+ *
+ * Note: positions outside the code region are ignored, as is passing
+ * NULL for m86_predecoded_program variable.
+ *
+ * Returns: N/A.
+ */
+void m86pd_update(
+        m86_predecoded_program*,
+        const unsigned int,
+        const m86_encoded_instruct);
+
+/* m86pd_trapped: tell whether a record with the M86PD_INVALID handler
+ * stands for an instruction whose memory operand lies beyond memory
+ * bounds (see m86pd_verify()) rather than for an unknown opcode.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to m86_predecoded_instruct variable.
+ *
+ * Returns: bool value to indicate whether record accesses memory out
+ * of bounds; true = yes, false = no.
+ */
+bool m86pd_trapped(const m86_predecoded_instruct*);
+
+/* m86pd_refresh: re-decode record at specified position if the memory
+ * unit at that position has been modified since it was decoded.
+ *
+ * Note: this is for execution engines that store into the code region
+ * without calling m86pd_update(); such engines must refresh records
+ * before using them.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to m86_predecoded_program variable.
+ * # memory variable containing program.
+ * # unsigned value for position of memory unit.
+ *
+ * Note: positions outside the code region are ignored, as is passing
+ * NULL for m86_predecoded_program variable.
+ *
+ * Returns: N/A.
+ */
+void m86pd_refresh(
+        m86_predecoded_program*,
+        const memory,
+        const unsigned int);
+
+/* m86pd_reachable: mark the positions of the code region of a
+ * pre-decoded program that are reachable from position 0 or its entry.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to m86_predecoded_program variable.
+ *
+ * Note: conditional jumps are assumed to go either way, and every other
+ * instruction but JMPI, HALT and invalid ones to fall through; the
+ * records of the program must be up to date (see m86pd_refresh()).
+ * The record a breakpoint stands in for is used at its position.
+ *
+ * Note: to avoid memory leaks, the array returned should be freed with
+ * free() once no longer needed.
+ *
+ * Returns: array of (size + 1) bool values, one per position of the
+ * code region (the last one is always false), or NULL if not enough
+ * memory.
+ */
+bool *m86pd_reachable(const m86_predecoded_program*);
+
+/* m86pd_thread: fill in the thread field of all records of a
+ * pre-decoded program from specified table, and keep filling it in for
+ * records re-decoded later on.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to m86_predecoded_program variable.
+ * # table of M86PD_NUM_HANDLERS handler code addresses, indexed by
+ * fused handler.
+ *
+ * Note: the table must remain valid for as long as the pre-decoded
+ * program is in use. Passing NULL for the table clears the thread
+ * field of all records. Passing NULL for m86_predecoded_program
+ * variable results in no operation being performed.
+ *
+ * Returns: N/A.
+ */
+void m86pd_thread(
+        m86_predecoded_program*,
+        const void *const*);
+
+/* m86pd_break: set a breakpoint at specified position of a pre-decoded
+ * program, clearing any previous one.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to m86_predecoded_program variable.
+ * # unsigned value for position of breakpoint.
+ *
+ * Note: the record at the breakpoint is replaced by an M86PD_END
+ * record keeping its word and run, so that execution engines stop
+ * there as they do past the end of the program, and tell the two
+ * apart by position; no superinstruction or loop kernel runs over it.
+ * The record it stands in for is kept up to date by m86pd_update()
+ * and put back by m86pd_unbreak().
+ *
+ * Note: native translations (see micro86_jit.h and micro86_aot.h) do
+ * not know about breakpoints and must not run while one is set.
+ *
+ * Returns: bool value to indicate whether the breakpoint was set;
+ * false if position is outside the code region or NULL is passed for
+ * m86_predecoded_program variable.
+ */
+bool m86pd_break(
+        m86_predecoded_program*,
+        const unsigned int);
+
+/* m86pd_unbreak: clear the breakpoint of a pre-decoded program, if
+ * any.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to m86_predecoded_program variable.
+ *
+ * Note: passing NULL results in no operation being performed.
+ *
+ * Returns: N/A.
+ */
+void m86pd_unbreak(m86_predecoded_program*);
+
+/* m86pd_resume: set the entry of a pre-decoded program (i.e., the
+ * position execution resumes from, for a program that was running
+ * before it was pre-decoded).
+ *
+ * Parameters (in order):
+ *
+ * # pointer to m86_predecoded_program variable.
+ * # unsigned value for position of entry.
+ *
+ * Note: positions reachable from the entry are marked reachable, and
+ * STOREs into them made M86PD_STORE_CODE records, from then on (stores
+ * into code may have left them unreachable from position 0). Passing
+ * NULL for m86_predecoded_program variable results in no operation
+ * being performed.
+ *
+ * Returns: N/A.
+ */
+void m86pd_resume(
+        m86_predecoded_program*,
+        const unsigned int);
+
+/* m86pd_kill: release resources held by a pre-decoded program.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to m86_predecoded_program variable.
+ *
+ * Note: passing NULL results in no operation being performed.
+ *
+ * Returns: N/A.
+ */
+void m86pd_kill(m86_predecoded_program*);
+
+#endif
+
+/* EOF. */
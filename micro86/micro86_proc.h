@@ -45,6 +45,14 @@
  * The flags register is used for comparison operations. It consists
  * of a zero bit (rightmost) and a sign bit (second to rightmost).
  *
+ * # cmp: result of the latest comparison.
+ * # lazy: whether the flags register is to be worked out from cmp.
+ *
+ * Comparisons only record their result; the zero and sign bits are
+ * worked out from it when they are read (e.g., by a conditional jump
+ * or a dump), and stored in the flags register when either of them is
+ * set on its own.
+ *
  * # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # #
  * WARNING: micro86_proc registers should not be accessed or modified
  * directly. The functions declared below are to be used for such
@@ -57,6 +65,8 @@ typedef struct
     unsigned int ir,
                  ip,
                  flags;
+    int cmp;
+    bool lazy;
 } micro86_proc;
 
 /* m86_proc_init: initialize micro86_proc registers with default value
@@ -272,6 +282,43 @@ void m86_set_flags_sb(
         micro86_proc*,
         bool);
 
+/* m86_get_flags_cmp: return a comparison result that sets the flags
+ * register to the value it contains.
+ *
+ * Parameters (in order):
+ *
+ * # micro86_proc variable.
+ *
+ * Note: this is the result of the latest comparison, unless either
+ * bit has been set on its own since, in which case it is 0 if the
+ * zero bit is set, -1 if the sign bit is set and 1 if neither is.
+ *
+ * Returns: value of comparison result.
+ */
+int m86_get_flags_cmp(const micro86_proc);
+
+/* m86_set_flags_cmp: set zero and sign bits of value contained in
+ * flags register from a comparison result.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to micro86_proc variable.
+ * # value of comparison result (i.e., the difference between the
+ * values compared).
+ *
+ * Note: passing NULL for micro86_proc variable parameter results in
+ * no operation being performed.
+ *
+ * Note: the zero bit is set to ZERO_BIT_TRUE if the result is zero
+ * and the sign bit to SIGN_BIT_TRUE if it is negative; both bits are
+ * only worked out when read.
+ *
+ * Returns: N/A.
+ */
+void m86_set_flags_cmp(
+        micro86_proc*,
+        const int);
+
 /* m86_print_proc: print processor (i.e., registers and their values)
  * to specified file stream.
  *
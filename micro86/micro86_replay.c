@@ -0,0 +1,286 @@
+/* micro86_replay:
+ *
+ * Cached results of input-free micro86 programs.
+ *
+ * A cache file holds a header, the processor, the words of the program,
+ * the memory and the transcript of the output stream, in that order.
+ */
+
+#ifndef _STDIO_H
+#include <stdio.h>
+#endif
+
+#ifndef _STDLIB_H
+#include <stdlib.h>
+#endif
+
+#ifndef _STRING_H
+#include <string.h>
+#endif
+
+#ifndef MICRO86_H
+#include "micro86.h"
+#endif
+
+#ifndef MICRO86REPLAY_H
+#include "micro86_replay.h"
+#endif
+
+/* M86RP_CACHE_MAGIC: first bytes of a cache file.
+ */
+#define M86RP_CACHE_MAGIC "M86R"
+
+/* Type: m86rp_cache_header.
+ *
+ * Header of a cache file.
+ */
+typedef struct
+{
+    char magic[4];
+    unsigned int format,
+                 mem_size,
+                 program_size,
+                 entry;
+    size_t output;
+} m86rp_cache_header;
+
+/* m86rp_init: set up the cached result of a pre-decoded program, if it
+ * never executes IN.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to m86_replay variable.
+ * # pointer to m86_predecoded_program variable.
+ * # unsigned value for memory size.
+ *
+ * Note: records of the pre-decoded program must be up to date (see
+ * m86pd_refresh()) and describe the program as loaded, before it ran.
+ *
+ * Note: to avoid resource leaks, m86rp_kill() should be called once the
+ * cached result is no longer needed, provided that this function
+ * succeeded.
+ *
+ * Returns: bool value to indicate status of initialization; true =
+ * success, false = failure (i.e., the program may execute IN, a
+ * breakpoint is set, or not enough memory).
+ */
+bool m86rp_init(
+        m86_replay *rp,
+        const m86_predecoded_program *program,
+        const unsigned int mem_size)
+{
+    unsigned int i;
+    if ((rp == NULL) || (program == NULL) ||
+            (program->reachable == NULL) || program->breaking)
+        return false;
+    /* No STORE into reachable code means no IN can appear later. */
+    for (i = 0; i < program->size; i++)
+        if (program->reachable[i] &&
+                ((program->code[i].handler == M86PD_IN) ||
+                 (program->code[i].handler == M86PD_STORE_CODE)))
+            return false;
+    rp->image = malloc((program->size + 1) *
+            sizeof(m86_encoded_instruct));
+    if (rp->image == NULL) return false;
+    for (i = 0; i < program->size; i++)
+        rp->image[i] = program->code[i].word;
+    rp->program_size = program->size;
+    rp->entry = program->entry;
+    m86cache_key(rp->key, program, mem_size, M86RP_CACHE_FORMAT);
+    rp->transcript = NULL;
+    return true;
+}
+
+/* m86rp_load: replay the cached result of the program, if any.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to m86_replay variable.
+ * # pointer to micro86_proc variable.
+ * # memory variable.
+ * # unsigned value for memory size.
+ * # pointer to FILE variable for output.
+ *
+ * Note: what the program wrote with OUT is written to the output
+ * stream, and the processor and memory are left as the program left
+ * them when it halted.
+ *
+ * Note: a cache file is only replayed if it was saved for the same
+ * words of the program, and its instruction pointer follows a HALT of
+ * the program; otherwise, the program is run and the file is replaced
+ * once its result is saved.
+ *
+ * Returns: bool value to indicate whether the result was replayed;
+ * true = replayed, false = not cached (or unusable), in which case
+ * nothing is modified.
+ */
+bool m86rp_load(
+        const m86_replay *rp,
+        micro86_proc *cpu,
+        memory mem,
+        const unsigned int mem_size,
+        FILE *output)
+{
+    char path[M86CACHE_PATH_SIZE];
+    m86rp_cache_header header;
+    micro86_proc saved;
+    m86_encoded_instruct *image = NULL;
+    int *contents = NULL;
+    char *text = NULL;
+    /* Everything but the transcript, whose length is what is left. */
+    const size_t fixed = sizeof(header) + sizeof(saved) +
+        rp->program_size * sizeof(m86_encoded_instruct) +
+        (size_t) mem_size * sizeof(int);
+    long length;
+    unsigned int ip;
+    FILE *file;
+    bool loaded;
+    if (!m86cache_path(path, rp->key, ".run") ||
+            ((file = fopen(path, "rb")) == NULL))
+        return false;
+    /* HALT leaves the instruction pointer past it. */
+    loaded = (fseek(file, 0, SEEK_END) == 0) &&
+        ((length = ftell(file)) >= 0) &&
+        ((size_t) length >= fixed) &&
+        (fseek(file, 0, SEEK_SET) == 0) &&
+        (fread(&header, sizeof(header), 1, file) == 1) &&
+        (memcmp(header.magic, M86RP_CACHE_MAGIC, 4) == 0) &&
+        (header.format == M86RP_CACHE_FORMAT) &&
+        (header.mem_size == mem_size) &&
+        (header.program_size == rp->program_size) &&
+        (header.entry == rp->entry) &&
+        (header.output == (size_t) length - fixed) &&
+        (fread(&saved, sizeof(saved), 1, file) == 1) &&
+        ((ip = m86_get_ip_reg(saved)) >= 1) &&
+        (ip <= rp->program_size) &&
+        (m86_ei_decoded_opcode(rp->image[ip - 1]) == HALT);
+    if (loaded)
+    {
+        image = malloc((rp->program_size + 1) *
+                sizeof(m86_encoded_instruct));
+        contents = malloc(mem_size * sizeof(int) + 1);
+        text = malloc(header.output + 1);
+        loaded = (image != NULL) && (contents != NULL) &&
+            (text != NULL) &&
+            (fread(image, sizeof(m86_encoded_instruct),
+                   rp->program_size, file) == rp->program_size) &&
+            (memcmp(image, rp->image, rp->program_size *
+                    sizeof(m86_encoded_instruct)) == 0) &&
+            (fread(contents, sizeof(int), mem_size, file) ==
+             mem_size) &&
+            (fread(text, 1, header.output, file) == header.output) &&
+            (fgetc(file) == EOF);
+    }
+    fclose(file);
+    if (loaded)
+    {
+        fwrite(text, 1, header.output, output);
+        *cpu = saved;
+        m_copy_arr(contents, 0, mem_size, &mem, 0, mem_size);
+    }
+    free(image);
+    free(contents);
+    free(text);
+    return loaded;
+}
+
+/* m86rp_record: start recording a run of the program, so that its
+ * result can be saved once it halts.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to m86_replay variable.
+ *
+ * Note: everything the run writes to its output stream has to be
+ * written to the transcript field as well.
+ *
+ * Returns: bool value to indicate status; true = recording, false =
+ * failure (i.e., no temporary file).
+ */
+bool m86rp_record(m86_replay *rp)
+{
+    if (rp->transcript == NULL) rp->transcript = tmpfile();
+    return (rp->transcript != NULL);
+}
+
+/* m86rp_save: save the result of a recorded run of the program to the
+ * cache.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to m86_replay variable.
+ * # micro86_proc variable.
+ * # memory variable.
+ * # unsigned value for memory size.
+ *
+ * Note: the run must have halted (i.e., not stopped on an error).
+ * Failures (e.g., no cache directory) are silently ignored.
+ *
+ * Returns: N/A.
+ */
+void m86rp_save(
+        const m86_replay *rp,
+        const micro86_proc cpu,
+        const memory mem,
+        const unsigned int mem_size)
+{
+    char path[M86CACHE_PATH_SIZE],
+         temp[M86CACHE_PATH_SIZE],
+         chunk[BUFSIZ];
+    m86rp_cache_header header;
+    long length;
+    size_t count;
+    FILE *file;
+    bool saved;
+    if ((rp->transcript == NULL) ||
+            ((length = ftell(rp->transcript)) < 0) ||
+            ferror(rp->transcript) ||
+            !m86cache_path(path, rp->key, ".run") ||
+            !m86cache_temp_path(temp, path, ".tmp") ||
+            ((file = fopen(temp, "wb")) == NULL))
+        return;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, M86RP_CACHE_MAGIC, 4);
+    header.format = M86RP_CACHE_FORMAT;
+    header.mem_size = mem_size;
+    header.program_size = rp->program_size;
+    header.entry = rp->entry;
+    header.output = (size_t) length;
+    saved = (fwrite(&header, sizeof(header), 1, file) == 1) &&
+        (fwrite(&cpu, sizeof(cpu), 1, file) == 1) &&
+        (fwrite(rp->image, sizeof(m86_encoded_instruct),
+                rp->program_size, file) == rp->program_size) &&
+        (fwrite(mem, sizeof(int), mem_size, file) == mem_size);
+    rewind(rp->transcript);
+    while (saved &&
+            ((count = fread(chunk, 1, sizeof(chunk), rp->transcript))
+             > 0))
+        saved = (fwrite(chunk, 1, count, file) == count);
+    saved = saved && !ferror(rp->transcript);
+    saved = (fclose(file) == 0) && saved && (rename(temp, path) == 0);
+    if (!saved) remove(temp);
+    return;
+}
+
+/* m86rp_kill: release resources held by the cached result of a
+ * program.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to m86_replay variable.
+ *
+ * Note: passing NULL results in no operation being performed.
+ *
+ * Returns: N/A.
+ */
+void m86rp_kill(m86_replay *rp)
+{
+    if (rp == NULL) return;
+    if (rp->transcript != NULL) fclose(rp->transcript);
+    free(rp->image);
+    rp->transcript = NULL;
+    rp->image = NULL;
+    return;
+}
+
+/* EOF. */
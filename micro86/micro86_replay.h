@@ -0,0 +1,184 @@
+/* micro86_replay:
+ *
+ * Cached results of input-free micro86 programs.
+ *
+ * A program that never executes IN computes the same thing on every
+ * run of the same image with the same memory size. The first time such
+ * a program halts, its result (the final processor state, the final
+ * contents of memory and everything it wrote with OUT) is saved in the
+ * cache (see micro86_cache.h); later runs replay it instead of running
+ * the program again.
+ *
+ * Whether a program may execute IN is decided statically, from the
+ * positions reachable from position 0 (see m86pd_reachable()): no IN
+ * may be reachable, nor any STORE into reachable code (which could
+ * write one). Runs that stop on an error are not saved.
+ */
+
+#ifndef _STDIO_H
+#include <stdio.h>
+#endif
+
+#ifndef _STDBOOL_H
+#include <stdbool.h>
+#endif
+
+#ifndef MICRO86PROC_H
+#include "micro86_proc.h"
+#endif
+
+#ifndef MEMORY_H
+#include "memory/memory.h"
+#endif
+
+#ifndef MICRO86PREDECODE_H
+#include "micro86_predecode.h"
+#endif
+
+#ifndef MICRO86CACHE_H
+#include "micro86_cache.h"
+#endif
+
+#ifndef MICRO86REPLAY_H
+#define MICRO86REPLAY_H
+
+/* M86RP_CACHE_FORMAT: version of the format of cache files; part of
+ * the cache key, so it has to be bumped whenever what is saved
+ * changes (including micro86_proc).
+ */
+#define M86RP_CACHE_FORMAT 2
+
+/* Type: m86_replay.
+ *
+ * The cached result of a program consisting of the following:
+ *
+ * # key: cache key of the program (see m86cache_key()).
+ * # image: words of the program as loaded, which cache files are
+ * checked against (the cache key is only a hash of them).
+ * # program_size: number of words in image.
+ * # entry: entry of the program (see m86pd_resume()).
+ * # transcript: temporary file stream holding everything written to
+ * the output stream so far, while the run is recorded (NULL
+ * otherwise).
+ *
+ * # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # #
+ * WARNING: m86_replay fields should not be modified directly. The
+ * functions declared below are to be used for such purposes.
+ * # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # # #
+ */
+typedef struct
+{
+    char key[M86CACHE_KEY_SIZE];
+    m86_encoded_instruct *image;
+    unsigned int program_size,
+                 entry;
+    FILE *transcript;
+} m86_replay;
+
+/* m86rp_init: set up the cached result of a pre-decoded program, if it
+ * never executes IN.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to m86_replay variable.
+ * # pointer to m86_predecoded_program variable.
+ * # unsigned value for memory size.
+ *
+ * Note: records of the pre-decoded program must be up to date (see
+ * m86pd_refresh()) and describe the program as loaded, before it ran.
+ *
+ * Note: to avoid resource leaks, m86rp_kill() should be called once the
+ * cached result is no longer needed, provided that this function
+ * succeeded.
+ *
+ * Returns: bool value to indicate status of initialization; true =
+ * success, false = failure (i.e., the program may execute IN, a
+ * breakpoint is set, or not enough memory).
+ */
+bool m86rp_init(
+        m86_replay*,
+        const m86_predecoded_program*,
+        const unsigned int);
+
+/* m86rp_load: replay the cached result of the program, if any.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to m86_replay variable.
+ * # pointer to micro86_proc variable.
+ * # memory variable.
+ * # unsigned value for memory size.
+ * # pointer to FILE variable for output.
+ *
+ * Note: what the program wrote with OUT is written to the output
+ * stream, and the processor and memory are left as the program left
+ * them when it halted.
+ *
+ * Note: a cache file is only replayed if it was saved for the same
+ * words of the program, and its instruction pointer follows a HALT of
+ * the program; otherwise, the program is run and the file is replaced
+ * once its result is saved.
+ *
+ * Returns: bool value to indicate whether the result was replayed;
+ * true = replayed, false = not cached (or unusable), in which case
+ * nothing is modified.
+ */
+bool m86rp_load(
+        const m86_replay*,
+        micro86_proc*,
+        memory,
+        const unsigned int,
+        FILE*);
+
+/* m86rp_record: start recording a run of the program, so that its
+ * result can be saved once it halts.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to m86_replay variable.
+ *
+ * Note: everything the run writes to its output stream has to be
+ * written to the transcript field as well.
+ *
+ * Returns: bool value to indicate status; true = recording, false =
+ * failure (i.e., no temporary file).
+ */
+bool m86rp_record(m86_replay*);
+
+/* m86rp_save: save the result of a recorded run of the program to the
+ * cache.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to m86_replay variable.
+ * # micro86_proc variable.
+ * # memory variable.
+ * # unsigned value for memory size.
+ *
+ * Note: the run must have halted (i.e., not stopped on an error).
+ * Failures (e.g., no cache directory) are silently ignored.
+ *
+ * Returns: N/A.
+ */
+void m86rp_save(
+        const m86_replay*,
+        const micro86_proc,
+        const memory,
+        const unsigned int);
+
+/* m86rp_kill: release resources held by the cached result of a
+ * program.
+ *
+ * Parameters (in order):
+ *
+ * # pointer to m86_replay variable.
+ *
+ * Note: passing NULL results in no operation being performed.
+ *
+ * Returns: N/A.
+ */
+void m86rp_kill(m86_replay*);
+
+#endif
+
+/* EOF. */
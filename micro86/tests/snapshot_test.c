@@ -0,0 +1,221 @@
+/* snapshot_test:
+ *
+ * Checks of m86_snapshot(), m86_branch() and m86_snapshot_kill(): a
+ * machine is stopped on IN and snapshotted, machines branched off the
+ * snapshot are given different input and run to HALT, and each of
+ * them (and the machine the snapshot was taken of) must only see what
+ * it wrote itself. This is done for heap memory and for paged memory
+ * (at least MEM_MAP_THRESHOLD bytes), whose branches share pages
+ * copy-on-write.
+ *
+ * Built with the emulator sources except micro86.c, and run from the
+ * micro86 directory, where the instruction dataset is read from (see
+ * README). Exits with EXIT_SUCCESS if all checks pass.
+ */
+
+#ifndef _STDIO_H
+#include <stdio.h>
+#endif
+
+#ifndef _STDLIB_H
+#include <stdlib.h>
+#endif
+
+#ifndef MEMORY_H
+#include "../memory/memory.h"
+#endif
+
+#ifndef MICRO86DATASET_H
+#include "../micro86_dataset.h"
+#endif
+
+#ifndef MICRO86MACHINE_H
+#include "../micro86_machine.h"
+#endif
+
+#ifndef MICRO86_H
+#include "../micro86.h"
+#endif
+
+/* Instruction with opcode and operand.
+ */
+#define T_INSTRUCT(opcode, operand) (((opcode) << 16) | (operand))
+
+/* Size of the test program; NEAR_ADDR is the word right after it (on
+ * the same page as the code), and the far address is the last word of
+ * memory.
+ */
+#define PRGM_SIZE 6
+#define NEAR_ADDR PRGM_SIZE
+
+/* Value stored at the far address before the snapshot is taken.
+ */
+#define START_VAL 7
+
+/* Number of failed checks.
+ */
+static unsigned int failures = 0;
+
+/* Report a failed check unless cond holds.
+ */
+static void check(
+        const bool cond,
+        const char *what,
+        const unsigned int mem_size)
+{
+    if (cond) return;
+    fprintf(stderr, "FAILED (memory size %u): %s\n", mem_size, what);
+    failures++;
+    return;
+}
+
+/* Initialize machine with memory of specified size holding the test
+ * program, which stores START_VAL at the far address, then stores the
+ * byte read by IN at both the far and the near address and halts.
+ */
+static bool load(
+        micro86_machine *m,
+        const unsigned int mem_size)
+{
+    const unsigned int far = mem_size - 1;
+    const int program[PRGM_SIZE] = {
+        T_INSTRUCT(LOADI, START_VAL),
+        T_INSTRUCT(STORE, far),
+        T_INSTRUCT(IN, 0),
+        T_INSTRUCT(STORE, far),
+        T_INSTRUCT(STORE, NEAR_ADDR),
+        T_INSTRUCT(HALT, 0)
+    };
+    memory mem;
+    unsigned int i;
+    if (!m_allocate_init(&mem, mem_size, M86_INIT_MEM_VAL))
+        return false;
+    for (i = 0; i < PRGM_SIZE; i++) m_set_value(&mem, i, program[i]);
+    if (!m86_machine_init(m, mem, mem_size, PRGM_SIZE))
+    {
+        m_deallocate(&mem);
+        return false;
+    }
+    m->input = NULL;
+    return true;
+}
+
+/* Whether machine holds the test program and far and near values as
+ * specified, and 0s everywhere else.
+ */
+static bool holds(
+        const micro86_machine *m,
+        const int far_val,
+        const int near_val)
+{
+    const unsigned int far = m->mem_size - 1;
+    unsigned int i;
+    for (i = PRGM_SIZE + 1; i < far; i++)
+        if (m_get_value(m->mem, i) != M86_INIT_MEM_VAL) return false;
+    return (m_get_value(m->mem, far) == far_val) &&
+        (m_get_value(m->mem, NEAR_ADDR) == near_val) &&
+        (m_get_value(m->mem, 2) == T_INSTRUCT(IN, 0));
+}
+
+/* Provide machine with byte and run it to HALT.
+ */
+static bool finish(
+        micro86_machine *m,
+        const unsigned char byte)
+{
+    m86_provide_input(m, byte);
+    return m86_run(m, 0) == M86_STOP_HALTED;
+}
+
+/* Run the checks with memory of specified size.
+ */
+static void test_branches(const unsigned int mem_size)
+{
+    micro86_machine origin, a, b, c;
+    micro86_snapshot s;
+    if (!load(&origin, mem_size))
+    {
+        check(false, "machine set up", mem_size);
+        return;
+    }
+    check(m86_run(&origin, 0) == M86_STOP_INPUT, "stops on IN",
+            mem_size);
+    check(m86_get_ip_reg(origin.cpu) == 2, "ip left on IN", mem_size);
+    if (!m86_snapshot(&s, &origin))
+    {
+        check(false, "snapshot taken", mem_size);
+        m86_machine_kill(&origin);
+        return;
+    }
+    if (!m86_branch(&a, &s) || !m86_branch(&b, &s))
+    {
+        check(false, "machines branched", mem_size);
+        exit(EXIT_FAILURE);
+    }
+    a.input = b.input = NULL;
+    check(a.state == M86_STOP_INPUT, "branch keeps stop reason",
+            mem_size);
+    check(holds(&a, START_VAL, 0) && holds(&b, START_VAL, 0),
+            "branches start from snapshot", mem_size);
+
+    /* Diverge both branches, then the machine snapshotted. */
+    check(finish(&a, 'a'), "first branch halts", mem_size);
+    check(holds(&a, 'a', 'a'), "first branch sees its writes",
+            mem_size);
+    check(holds(&b, START_VAL, 0),
+            "second branch unaffected by first", mem_size);
+    check(holds(&origin, START_VAL, 0),
+            "machine snapshotted unaffected by branch", mem_size);
+    check(finish(&b, 'b'), "second branch halts", mem_size);
+    check(holds(&b, 'b', 'b'), "second branch sees its writes",
+            mem_size);
+    check(holds(&a, 'a', 'a'), "first branch unaffected by second",
+            mem_size);
+    check(finish(&origin, 'o'), "machine snapshotted halts",
+            mem_size);
+    check(holds(&origin, 'o', 'o'),
+            "machine snapshotted sees its writes", mem_size);
+    check(holds(&a, 'a', 'a') && holds(&b, 'b', 'b'),
+            "branches unaffected by machine snapshotted", mem_size);
+
+    /* The snapshot itself must not have been written through. */
+    if (!m86_branch(&c, &s))
+    {
+        check(false, "machine branched late", mem_size);
+        exit(EXIT_FAILURE);
+    }
+    c.input = NULL;
+    check(holds(&c, START_VAL, 0), "late branch starts from snapshot",
+            mem_size);
+    m86_snapshot_kill(&s);
+    m86_machine_kill(&origin);
+    check(finish(&c, 'c'), "branch outlives snapshot", mem_size);
+    check(holds(&c, 'c', 'c'), "late branch sees its writes",
+            mem_size);
+    check(holds(&a, 'a', 'a') && holds(&b, 'b', 'b'),
+            "branches unaffected by late branch", mem_size);
+    m86_machine_kill(&a);
+    m86_machine_kill(&b);
+    m86_machine_kill(&c);
+    return;
+}
+
+int main(void)
+{
+    const unsigned int sizes[] = {
+        M86_DEF_MEM_SIZE,
+        MEM_MAP_THRESHOLD / sizeof(int) - 1,
+        MEM_MAP_THRESHOLD / sizeof(int),
+        M86_MAX_MEM_SIZE
+    };
+    unsigned int i;
+    m86ds_init();
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+        test_branches(sizes[i]);
+    m86ds_kill();
+    if (failures > 0) return EXIT_FAILURE;
+    printf("snapshot_test: all checks passed\n");
+    return EXIT_SUCCESS;
+}
+
+/* EOF. */